@@ -3,9 +3,11 @@
 #include "core/ecs/ecs_manager.h"
 #include "core/ecs/types.h"
 #include "core/attributes/transform.h"
+#include "core/attributes/world_matrix.h"
 #include "core/attributes/camera.h"
 #include "core/systems/camera_system.h"
 #include "core/systems/render_system.h"
+#include "core/systems/transform_system.h"
 #include "core/render/renderer.h"
 #include "core/platform/window.h"
 #include "core/assetloader/asset_loader_manager.h"
@@ -47,19 +49,20 @@ graphics::Mesh CreateSquare(float size, glm::vec3 origin) {
 
 void RegisterAttributesAndSystems() {
 	core::ecs::ECSManager& ecs_manager = core::ecs::ECSManager::GetInstance();
-	ecs_manager.RegisterAttribute<attributes::Transform>();
-	ecs_manager.RegisterAttribute<attributes::Camera>();
-	ecs_manager.RegisterAttribute<attributes::StaticMesh>();
-
-	core::ecs::ArchetypeSignature camera_signature;
-	camera_signature.set(0); // Transform
-	camera_signature.set(1); // Camera
-	ecs_manager.RegisterSystem<systems::CameraSystem>(camera_signature);
-
-	core::ecs::ArchetypeSignature render_signature;
-	render_signature.set(0); // Transform
-	render_signature.set(2); // StaticMesh
-	ecs_manager.RegisterSystem<systems::RenderSystem>(render_signature);
+	ecs_manager.RegisterAttribute<attributes::Transform>("Transform");
+	ecs_manager.RegisterAttribute<attributes::Camera>("Camera");
+	ecs_manager.RegisterAttribute<attributes::StaticMesh>("StaticMesh");
+	ecs_manager.RegisterAttribute<attributes::WorldMatrix>("WorldMatrix");
+
+	ecs_manager.RegisterSystem<systems::CameraSystem>(
+			core::ecs::Signature<attributes::Transform, attributes::Camera>(),
+			core::ecs::SystemPhase::kPostUpdate);
+	ecs_manager.RegisterSystem<systems::TransformSystem>(
+			core::ecs::Signature<attributes::Transform, attributes::WorldMatrix>(),
+			core::ecs::SystemPhase::kPostUpdate);
+	ecs_manager.RegisterSystem<systems::RenderSystem>(
+			core::ecs::Signature<attributes::WorldMatrix, attributes::StaticMesh>(),
+			core::ecs::SystemPhase::kRender);
 }
 
 int main() {
@@ -113,6 +116,8 @@ int main() {
 	attributes::StaticMesh static_mesh3;
 	static_mesh3.model_id = model_res.value()->id;
 	ecs_manager.AddAttribute<attributes::StaticMesh>(entity3.id, static_mesh3);
+	attributes::WorldMatrix world_matrix3;
+	ecs_manager.AddAttribute<attributes::WorldMatrix>(entity3.id, world_matrix3);
 
 	core::ecs::Entity entity4 = ecs_manager.CreateEntity();
 	attributes::Transform transform4;
@@ -122,6 +127,8 @@ int main() {
 	attributes::StaticMesh static_mesh4;
 	static_mesh4.model_id = model_res.value()->id;
 	ecs_manager.AddAttribute<attributes::StaticMesh>(entity4.id, static_mesh4);
+	attributes::WorldMatrix world_matrix4;
+	ecs_manager.AddAttribute<attributes::WorldMatrix>(entity4.id, world_matrix4);
 
 
 	core::ecs::Entity entity5 = ecs_manager.CreateEntity();
@@ -132,12 +139,15 @@ int main() {
 	attributes::StaticMesh static_mesh5;
 	static_mesh5.model_id = model_res.value()->id;
 	ecs_manager.AddAttribute<attributes::StaticMesh>(entity5.id, static_mesh5);
+	attributes::WorldMatrix world_matrix5;
+	ecs_manager.AddAttribute<attributes::WorldMatrix>(entity5.id, world_matrix5);
 
 	float delta_time = 0.001f; // Simulate 1 second per tick
 	while (!glfwWindowShouldClose(window.GetInstance())) {
 		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
 		ecs_manager.UpdateSystems(delta_time);
+		renderer.DrawFrame(entity.id);
 
         glfwSwapBuffers(window.GetInstance());
         glfwPollEvents();
@@ -0,0 +1,27 @@
+#ifndef BENCHMARKS_BENCHMARK_H
+#define BENCHMARKS_BENCHMARK_H
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <limits>
+
+namespace benchmarks {
+
+// Runs func repetitions times after one warm-up run and returns the fastest run, in nanoseconds.
+// The fastest run is the least disturbed by the rest of the system.
+template <typename Func>
+double MeasureBestNanoseconds(size_t repetitions, Func&& func) {
+	func();
+	double best = std::numeric_limits<double>::max();
+	for (size_t i = 0; i < repetitions; ++i) {
+		auto start = std::chrono::steady_clock::now();
+		func();
+		auto end = std::chrono::steady_clock::now();
+		best = std::min(best, std::chrono::duration<double, std::nano>(end - start).count());
+	}
+	return best;
+}
+} // namespace benchmarks
+
+#endif // BENCHMARKS_BENCHMARK_H
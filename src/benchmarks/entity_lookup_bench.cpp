@@ -0,0 +1,67 @@
+// Times random-access attribute reads through ECSManager::GetAttribute, the way systems read the
+// attributes of other entities (for example the TrainSystem reading tile transforms).
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "benchmarks/benchmark.h"
+#include "core/attributes/transform.h"
+#include "core/attributes/world_matrix.h"
+#include "core/ecs/ecs_manager.h"
+#include "core/ecs/entity.h"
+#include "core/ecs/types.h"
+
+namespace {
+
+constexpr size_t kReadsPerRun = 1000000;
+constexpr size_t kRepetitions = 10;
+} // namespace
+
+int main() {
+	core::ecs::ECSManager& ecs_manager = core::ecs::ECSManager::GetInstance();
+	ecs_manager.RegisterAttribute<core::attributes::Transform>("Transform");
+	ecs_manager.RegisterAttribute<core::attributes::WorldMatrix>("WorldMatrix");
+
+	std::printf("Nanoseconds per GetAttribute<const Transform> in shuffled order, best of %zu "
+				"runs.\n", kRepetitions);
+	std::printf("%10s %10s\n", "entities", "ns/read");
+	std::mt19937 random(42);
+	std::vector<core::ecs::EntityID> entities;
+	for (size_t count : {size_t{1000}, size_t{10000}, size_t{100000}, size_t{1000000}}) {
+		// Spread the entities over two archetypes, so reads do not all hit the same one.
+		size_t new_count = count - entities.size();
+		auto initialize = [](const core::ecs::Entity&, size_t index,
+							 core::attributes::Transform& transform, auto&...) {
+			transform.position.x = static_cast<float>(index);
+		};
+		for (const core::ecs::Entity& entity :
+			 ecs_manager.CreateEntities<core::attributes::Transform>(new_count / 2, initialize)) {
+			entities.push_back(entity.id);
+		}
+		for (const core::ecs::Entity& entity :
+			 ecs_manager.CreateEntities<core::attributes::Transform, core::attributes::WorldMatrix>(
+					 new_count - new_count / 2, initialize)) {
+			entities.push_back(entity.id);
+		}
+		std::vector<core::ecs::EntityID> shuffled = entities;
+		std::shuffle(shuffled.begin(), shuffled.end(), random);
+
+		size_t runs = std::max(size_t{1}, kReadsPerRun / count);
+		float sum = 0.0f;
+		double ns = benchmarks::MeasureBestNanoseconds(kRepetitions, [&]() {
+			for (size_t run = 0; run < runs; ++run) {
+				for (core::ecs::EntityID entity : shuffled) {
+					sum += ecs_manager.GetAttribute<const core::attributes::Transform>(entity)
+								   .position.x;
+				}
+			}
+		});
+		// Printed so that the reads are not optimized away.
+		std::printf("%10zu %10.2f (checksum %g)\n", count,
+					ns / static_cast<double>(runs * count), sum);
+	}
+	return 0;
+}
@@ -0,0 +1,77 @@
+// Compares the per-entity glm model matrix with the batched world matrix kernel.
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "benchmarks/benchmark.h"
+#include "core/attributes/transform.h"
+#include "core/attributes/world_matrix.h"
+#include "core/math/transform_kernels.h"
+
+namespace {
+
+// Matrices computed per repetition of every size, so that small sizes run long enough to time.
+constexpr size_t kMatricesPerRun = 1000000;
+constexpr size_t kRepetitions = 10;
+
+std::vector<core::attributes::Transform> MakeTransforms(size_t count) {
+	std::mt19937 random(42);
+	std::uniform_real_distribution<float> position(-1000.0f, 1000.0f);
+	std::uniform_real_distribution<float> angle(-360.0f, 360.0f);
+	std::uniform_real_distribution<float> scale(0.1f, 10.0f);
+	std::vector<core::attributes::Transform> transforms(count);
+	for (core::attributes::Transform& transform : transforms) {
+		transform.position = glm::vec3(position(random), position(random), position(random));
+		transform.rotation = glm::vec3(angle(random), angle(random), angle(random));
+		transform.scale = glm::vec3(scale(random), scale(random), scale(random));
+	}
+	return transforms;
+}
+} // namespace
+
+int main() {
+	std::printf("Nanoseconds per world matrix, best of %zu runs.\n", kRepetitions);
+	std::printf("%10s %10s %10s %9s %12s\n", "entities", "glm", "kernel", "speed-up",
+				"max error");
+	for (size_t count : {size_t{1000}, size_t{10000}, size_t{100000}}) {
+		std::vector<core::attributes::Transform> transforms = MakeTransforms(count);
+		std::vector<core::attributes::WorldMatrix> expected(count);
+		std::vector<core::attributes::WorldMatrix> actual(count);
+		size_t runs = std::max(size_t{1}, kMatricesPerRun / count);
+
+		double glm_ns = benchmarks::MeasureBestNanoseconds(kRepetitions, [&]() {
+			for (size_t run = 0; run < runs; ++run) {
+				for (size_t i = 0; i < count; ++i) {
+					expected[i].matrix = transforms[i].GetModelMatrix();
+				}
+			}
+		});
+		double kernel_ns = benchmarks::MeasureBestNanoseconds(kRepetitions, [&]() {
+			for (size_t run = 0; run < runs; ++run) {
+				core::math::ComputeWorldMatrices(transforms.data(), actual.data(), count);
+			}
+		});
+
+		// Relative to the largest element, so that large translations do not hide rotation errors.
+		float max_error = 0.0f;
+		for (size_t i = 0; i < count; ++i) {
+			for (int column = 0; column < 4; ++column) {
+				for (int row = 0; row < 4; ++row) {
+					float a = expected[i].matrix[column][row];
+					float b = actual[i].matrix[column][row];
+					max_error = std::max(max_error,
+										 std::abs(a - b) / std::max(1.0f, std::abs(a)));
+				}
+			}
+		}
+
+		double matrices = static_cast<double>(runs * count);
+		std::printf("%10zu %10.2f %10.2f %8.2fx %12.2e\n", count, glm_ns / matrices,
+					kernel_ns / matrices, glm_ns / kernel_ns, max_error);
+	}
+	return 0;
+}
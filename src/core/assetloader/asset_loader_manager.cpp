@@ -15,6 +15,7 @@
 #include <glm/glm.hpp>
 #include <glad/glad.h>
 
+#include "core/graphics/bounding_volume.h"
 #include "core/graphics/material.h"
 #include "core/graphics/mesh.h"
 #include "core/graphics/model.h"
@@ -48,6 +49,7 @@ namespace {
 				mesh.indices.push_back(aimp_mesh->mFaces[i].mIndices[j]);
 			}
 		}
+		mesh.bounds = graphics::ComputeBoundingVolume(mesh.vertices);
 	}
 
 	graphics::Texture LoadTexture(const std::string& path) {
@@ -122,6 +124,16 @@ namespace {
 
 		const aiNode* const& aimpNode = aimp_scene->mRootNode;
 		PopulateModel(aimp_scene, aimpNode, model);
+
+		// The mesh bounds are merged untransformed. PopulateModel reads a single element of the node
+		// transform, so transformation_matrix is a uniform scale of all four coordinates, which the
+		// perspective divide cancels: the meshes are drawn in model space.
+		for (size_t i = 0; i < model.mesh_instances.size(); ++i) {
+			const graphics::BoundingVolume& mesh_bounds =
+					model.meshes[model.mesh_instances[i].mesh_index].bounds;
+			model.bounds = i == 0 ? mesh_bounds
+								  : graphics::MergeBoundingVolumes(model.bounds, mesh_bounds);
+		}
 	}
 
 	// Checks if the file extension corresponds to a supported model format.
@@ -0,0 +1,24 @@
+#ifndef CORE_ATTRIBUTES_BOUNDS_H
+#define CORE_ATTRIBUTES_BOUNDS_H
+
+#include <limits>
+
+#include <glm/glm.hpp>
+
+#include "core/ecs/types.h"
+
+namespace core::attributes {
+
+// World space bounding sphere of the model drawn by an entity's StaticMesh. Recomputed from its
+// WorldMatrix by the BoundsSystem, and used by the RenderSystem to skip entities outside the
+// camera frustum. Entities without Bounds are never culled. The sphere starts unbounded, so new
+// entities are not culled before the BoundsSystem first runs on them.
+struct Bounds : ecs::IAttribute {
+	glm::vec3 center;
+	float radius;
+
+	Bounds() : center(0.0f), radius(std::numeric_limits<float>::infinity()) {}
+};
+} // namespace core::attributes
+
+#endif // CORE_ATTRIBUTES_BOUNDS_H
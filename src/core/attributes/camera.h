@@ -12,15 +12,14 @@ struct Camera : ecs::IAttribute {
 	float near_plane;
 	float far_plane;
 
-	// TODO: look_at defaults to id 0, which may be actually be a valid entity.
-
+	// Entity the camera looks at, or kNullEntity to use the camera's own rotation.
 	ecs::EntityID look_at;
 
 	Camera()
 	    : fov(45.0f),
 	      near_plane(0.1f),
 	      far_plane(1000.0f),
-	      look_at(0) {}
+	      look_at(ecs::kNullEntity) {}
 
 	glm::mat4 view_matrix;
 	glm::mat4 projection_matrix;
@@ -12,7 +12,7 @@ struct Follow : public core::ecs::IAttribute {
 	glm::vec3 offset;
 	bool match_rotation;
 
-	Follow() : target_entity(0), offset(10.0f, 10.0f, 10.0f), match_rotation(true) {}
+	Follow() : target_entity(core::ecs::kNullEntity), offset(10.0f, 10.0f, 10.0f), match_rotation(true) {}
 };
 } // namespace core::attributes
 
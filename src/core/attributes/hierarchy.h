@@ -7,6 +7,8 @@ namespace core::attributes {
 
 struct Hierarchy : ecs::IAttribute {
 	ecs::EntityID parent_id;
+
+	Hierarchy() : parent_id(ecs::kNullEntity) {}
 };
 } // namespace core::attributes
 
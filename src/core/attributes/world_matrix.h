@@ -0,0 +1,19 @@
+#ifndef CORE_ATTRIBUTES_WORLD_MATRIX_H
+#define CORE_ATTRIBUTES_WORLD_MATRIX_H
+
+#include <glm/glm.hpp>
+
+#include "core/ecs/types.h"
+
+namespace core::attributes {
+
+// Cached model-to-world matrix of an entity. Recomputed from its Transform by the TransformSystem
+// whenever the chunk holding the transform was written.
+struct WorldMatrix : ecs::IAttribute {
+	glm::mat4 matrix;
+
+	WorldMatrix() : matrix(1.0f) {}
+};
+} // namespace core::attributes
+
+#endif // CORE_ATTRIBUTES_WORLD_MATRIX_H
@@ -1,97 +1,214 @@
 #include "archetype.h"
 
+#include <algorithm>
 #include <functional>
+#include <limits>
 #include <stdexcept>
 
 namespace core::ecs {
 
-Archetype::Archetype(ArchetypeSignature signature, const std::vector<size_t>& attribute_sizes,
-					 const std::vector<AttributeType>& attribute_types) :
+namespace {
+
+// Rounds value up to the next multiple of alignment, which must be a power of two.
+inline size_t AlignUp(size_t value, size_t alignment) {
+	return (value + alignment - 1) & ~(alignment - 1);
+}
+} // namespace
+
+Archetype::Archetype(ArchetypeSignature signature,
+					 const std::vector<const AttributeInfo*>& attribute_infos,
+					 const std::vector<AttributeType>& attribute_types, const ChangeTick& change_tick,
+					 ChunkLayout layout, size_t column_alignment) :
 		signature_(signature),
-		attribute_types_(attribute_types) {
-	if (attribute_sizes.size() != attribute_types.size()) {
-		throw std::runtime_error("Attribute sizes and types size mismatch.");
+		layout_(layout),
+		attribute_types_(attribute_types),
+		attribute_infos_(attribute_infos),
+		chunk_pool_(ChunkPool::GetInstance()),
+		change_tick_(change_tick) {
+	if (attribute_infos.size() != attribute_types.size()) {
+		throw std::runtime_error("Attribute infos and types size mismatch.");
 	}
+	if (column_alignment == 0 || (column_alignment & (column_alignment - 1)) != 0 ||
+		column_alignment > kChunkAlignment) {
+		throw std::runtime_error("Column alignment must be a power of two up to the chunk alignment.");
+	}
+	trivial_ = std::all_of(attribute_infos_.begin(), attribute_infos_.end(),
+						   [](const AttributeInfo* info) { return info->trivial; });
 
-	attribute_offsets_.resize(attribute_types_.size() + 1);
-	attribute_offsets_[0] = 0;
+	attribute_type_to_column_.fill(kNoColumn);
+	size_t max_alignment = 1;
+	entity_stride_ = 0;
 	for (size_t i = 0; i < attribute_types_.size(); ++i) {
-		attribute_type_to_index_[attribute_types_[i]] = i;
-		attribute_offsets_[i + 1] = attribute_offsets_[i] + attribute_sizes[i];
+		attribute_type_to_column_[attribute_types_[i]] = i;
+		if (attribute_infos_[i]->alignment > kChunkAlignment) {
+			throw std::runtime_error("Attribute alignment exceeds chunk alignment.");
+		}
+		max_alignment = std::max(max_alignment, attribute_infos_[i]->alignment);
+		entity_stride_ += attribute_infos_[i]->size;
 	}
-	entity_stride_ = attribute_offsets_.back();
 
-	if (attribute_sizes.size() == 0) {
+	column_offsets_.resize(attribute_types_.size());
+	column_strides_.resize(attribute_types_.size());
+	if (attribute_infos_.size() == 0) {
 		entities_per_chunk_ = std::numeric_limits<size_t>::max();
+		return;
+	}
+
+	if (layout_ == ChunkLayout::kInterleaved) {
+		// Each attribute starts at its own alignment within the entity's data block, and the block
+		// is padded to the largest alignment so that consecutive blocks stay aligned.
+		size_t offset = 0;
+		for (size_t i = 0; i < attribute_types_.size(); ++i) {
+			offset = AlignUp(offset, attribute_infos_[i]->alignment);
+			column_offsets_[i] = offset;
+			offset += attribute_infos_[i]->size;
+		}
+		entity_stride_ = AlignUp(offset, max_alignment);
+		std::fill(column_strides_.begin(), column_strides_.end(), entity_stride_);
+		entities_per_chunk_ = kChunkSize / entity_stride_;
 	} else {
+		// Each column reserves room for a full chunk worth of entities and starts at the larger of
+		// its attribute alignment and the column alignment. Start from the unpadded capacity and
+		// shrink it until the padded columns fit in a chunk.
+		auto layout_columns = [&](size_t capacity) {
+			size_t offset = 0;
+			for (size_t i = 0; i < attribute_types_.size(); ++i) {
+				offset = AlignUp(offset, std::max(attribute_infos_[i]->alignment, column_alignment));
+				column_offsets_[i] = offset;
+				column_strides_[i] = attribute_infos_[i]->size;
+				offset += attribute_infos_[i]->size * capacity;
+			}
+			return offset;
+		};
 		entities_per_chunk_ = kChunkSize / entity_stride_;
+		while (entities_per_chunk_ > 0 && layout_columns(entities_per_chunk_) > kChunkSize) {
+			--entities_per_chunk_;
+		}
 	}
 	if (entities_per_chunk_ == 0) {
 		throw std::runtime_error("Archetype entity stride exceeds chunk size.");
 	}
 }
 
+Archetype::~Archetype() {
+	if (!trivial_) {
+		for (size_t index = 0; index < entities_.size(); ++index) {
+			DestroyAttributes(index);
+		}
+	}
+	for (uint8_t* chunk : chunks_) {
+		chunk_pool_.Release(chunk);
+	}
+}
+
 size_t Archetype::AddEntity(EntityID entity_id) {
 	size_t index = entities_.size();
 	size_t chunk_index = index / entities_per_chunk_;
 
-	if (chunk_index >= chunks_.size()) {
-		chunks_.emplace_back(std::make_unique<uint8_t[]>(kChunkSize));
-	}
-	entity_to_index_[entity_id] = index;
+	AllocateChunks(chunk_index + 1);
 	entities_.push_back(entity_id);
+	MarkAdded(chunk_index);
 
 	return index;
 }
 
-// Swaps with the last entity to maintain contiguity.
-void Archetype::RemoveEntity(EntityID entity_id) {
-	auto it = entity_to_index_.find(entity_id);
-	if (it == entity_to_index_.end()) {
-		throw std::runtime_error("Entity not found in archetype.");
+size_t Archetype::AddEntities(const EntityID* entity_ids, size_t count) {
+	size_t first_index = entities_.size();
+	if (count == 0) {
+		return first_index;
+	}
+
+	size_t chunks_needed = (first_index + count - 1) / entities_per_chunk_ + 1;
+	AllocateChunks(chunks_needed);
+
+	entities_.insert(entities_.end(), entity_ids, entity_ids + count);
+	for (size_t chunk_index = first_index / entities_per_chunk_; chunk_index < chunks_needed;
+		 ++chunk_index) {
+		MarkAdded(chunk_index);
+	}
+
+	return first_index;
+}
+
+void Archetype::ConstructAttributes(size_t first_index, size_t count) {
+	for (size_t column = 0; column < attribute_infos_.size(); ++column) {
+		const AttributeInfo& info = *attribute_infos_[column];
+		for (size_t index = first_index; index < first_index + count; ++index) {
+			info.DefaultConstruct(GetAttributeData(index, column));
+		}
 	}
+}
 
-	size_t index = it->second;
-	EntityID last_entity = entities_[entities_.size() - 1];
-	entities_[index] = last_entity;
-	entity_to_index_[last_entity] = index;
+EntityID Archetype::RemoveEntity(size_t index) {
+	if (index >= entities_.size()) {
+		throw std::runtime_error("Entity index out of archetype bounds.");
+	}
+	if (!trivial_) {
+		DestroyAttributes(index);
+	}
+	return RemoveRelocatedEntity(index);
+}
+
+// Relocates the last entity into the freed slot to maintain contiguity.
+EntityID Archetype::RemoveRelocatedEntity(size_t index) {
+	if (index >= entities_.size()) {
+		throw std::runtime_error("Entity index out of archetype bounds.");
+	}
 
+	size_t last_index = entities_.size() - 1;
+	EntityID moved_entity = kNullEntity;
+	if (index != last_index) {
+		moved_entity = entities_[last_index];
+		entities_[index] = moved_entity;
+		EntityLocation location = GetLocation(index);
+		for (size_t column = 0; column < attribute_types_.size(); ++column) {
+			attribute_infos_[column]->Relocate(GetAttributeData(location, column),
+											   GetAttributeData(last_index, column));
+			MarkChanged(location.chunk, column);
+		}
+	}
 	entities_.pop_back();
-	entity_to_index_.erase(it);
+
+	// Release the chunks that no longer hold any entity.
+	size_t chunk_count = GetChunkCount();
+	while (chunks_.size() > chunk_count) {
+		chunk_pool_.Release(chunks_.back());
+		chunks_.pop_back();
+	}
+	column_ticks_.resize(chunks_.size() * attribute_types_.size());
+	return moved_entity;
 }
 
-IAttribute& Archetype::GetAttribute(EntityID entity_id,
-		AttributeType attribute_type) {
-	auto it = entity_to_index_.find(entity_id);
-	if (it == entity_to_index_.end()) {
-		throw std::runtime_error("Entity not found in archetype.");
+void Archetype::AllocateChunks(size_t chunk_count) {
+	if (chunks_.size() >= chunk_count) {
+		return;
 	}
-	size_t entity_index = it->second;
-	size_t chunk_index = entity_index / entities_per_chunk_;
-	size_t index_in_chunk = entity_index % entities_per_chunk_;
+	chunks_.reserve(chunk_count);
+	while (chunks_.size() < chunk_count) {
+		chunks_.push_back(chunk_pool_.Allocate());
+	}
+	column_ticks_.resize(chunks_.size() * attribute_types_.size());
+}
 
-	auto attr_it = attribute_type_to_index_.find(attribute_type);
-	if (attr_it == attribute_type_to_index_.end()) {
-		throw std::runtime_error("Attribute type not found in archetype.");
+void Archetype::MarkAdded(size_t chunk_index) {
+	for (size_t column = 0; column < attribute_types_.size(); ++column) {
+		ColumnTicks& ticks = GetColumnTicks(chunk_index, column);
+		ticks.added = change_tick_;
+		ticks.changed = change_tick_;
 	}
-	size_t attribute_offset = attribute_offsets_[attr_it->second];
-	uint8_t* chunk = chunks_[chunk_index].get();
-	uint8_t* attribute_ptr = chunk + (index_in_chunk * entity_stride_) + attribute_offset;
+}
 
-	IAttribute* attribute = reinterpret_cast<IAttribute*>(attribute_ptr);
-	return *attribute;
+void Archetype::DestroyAttributes(size_t index) {
+	for (size_t column = 0; column < attribute_infos_.size(); ++column) {
+		attribute_infos_[column]->Destroy(GetAttributeData(index, column));
+	}
 }
 
-void Archetype::SetAttribute(EntityID entity_id, AttributeType attribute_type,
-							 IAttribute& attribute) {
-	IAttribute& attr = GetAttribute(entity_id, attribute_type);
-	auto attr_it = attribute_type_to_index_.find(attribute_type);
-	if (attr_it == attribute_type_to_index_.end()) {
+size_t Archetype::GetColumnIndex(AttributeType attribute_type) const {
+	size_t column = attribute_type_to_column_[attribute_type];
+	if (column == kNoColumn) {
 		throw std::runtime_error("Attribute type not found in archetype.");
 	}
-
-	size_t attribute_size = attribute_offsets_[attr_it->second + 1] -
-							attribute_offsets_[attr_it->second];
-	std::memcpy(&attr, &attribute, attribute_size);
+	return column;
 }
 } // namespace core::ecs
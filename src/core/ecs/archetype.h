@@ -1,12 +1,19 @@
 #ifndef CORE_ARCHETYPE_H
 #define CORE_ARCHETYPE_H
 
+#include <algorithm>
+#include <array>
+#include <atomic>
 #include <cstddef>
+#include <cstdint>
 #include <functional>
 #include <memory>
-#include <vector>
+#include <stdexcept>
+#include <type_traits>
 #include <unordered_map>
+#include <vector>
 
+#include "chunk_pool.h"
 #include "entity.h"
 #include "types.h"
 
@@ -14,24 +21,104 @@ namespace core::ecs {
 
 // Size of each archetype data chunk in bytes (16 KB).
 static constexpr size_t kChunkSize = 16 << 10;
+// Size of a cache line in bytes. Default alignment of the columns of columnar chunks, so batched
+// kernels can use aligned vector loads.
+static constexpr size_t kCacheLineSize = 64;
+// Column index returned for attribute types an archetype does not contain.
+static constexpr size_t kNoColumn = static_cast<size_t>(-1);
+
+// Describes how attribute data is laid out inside an archetype chunk.
+enum class ChunkLayout {
+	// Each entity has its own block in the chunk where all its attributes are stored contiguously.
+	kInterleaved,
+	// Each attribute type has its own contiguous column in the chunk. Iterating a subset of the
+	// attributes only pulls the matching columns through the cache.
+	kColumnar
+};
+
+// View over a single chunk of an archetype. Handed out by Archetype::ForEachChunk.
+struct ArchetypeChunk {
+	// Index of the chunk within the archetype.
+	size_t index;
+	// Number of entities stored in the chunk.
+	size_t size;
+	// Entities stored in the chunk, in row order.
+	const EntityID* entities;
+	// Start of the chunk data, aligned to kChunkAlignment.
+	uint8_t* data;
+};
+
+class Archetype;
+
+// Position of an entity's data: its archetype, the chunk within the archetype and the row within
+// the chunk. Kept by the ArchetypeManager in a dense table indexed by entity index.
+struct EntityLocation {
+	Archetype* archetype = nullptr;
+	uint32_t chunk = 0;
+	uint32_t row = 0;
+};
+
+// Relocates the data of one attribute column when an entity moves between two archetypes.
+struct ColumnCopy {
+	// Column index in the archetype the entity leaves.
+	size_t source_column;
+	// Column index in the archetype the entity enters.
+	size_t target_column;
+	// Operations of the attribute type.
+	const AttributeInfo* info;
+};
+
+// Cached transition from an archetype to the archetype obtained by adding or removing a single
+// attribute type, or to any other archetype for changes of several attribute types at once. Edges
+// are created lazily by the ArchetypeManager on first use.
+struct ArchetypeEdge {
+	// Archetype reached through this edge, or nullptr if the edge was not resolved yet.
+	Archetype* target = nullptr;
+	// Columns shared by both archetypes that have to be relocated when an entity moves.
+	std::vector<ColumnCopy> copy_plan;
+	// Columns of the target archetype missing from the source, default constructed on a move.
+	std::vector<size_t> constructed_columns;
+	// Columns of the source archetype missing from the target, destroyed on a move.
+	std::vector<size_t> destroyed_columns;
+};
 
 // Archetype stores all entities that share the same attribute signature.
 // Uses chunk-based storage for cache-friendly iterations.
 class Archetype {
 public:
-	explicit Archetype(ArchetypeSignature signature, const std::vector<size_t>& attribute_sizes,
-					   const std::vector<AttributeType>& attribute_types);
+	// change_tick is the tick stamped on the columns written from now on; it must outlive the
+	// archetype.
+	explicit Archetype(ArchetypeSignature signature,
+					   const std::vector<const AttributeInfo*>& attribute_infos,
+					   const std::vector<AttributeType>& attribute_types,
+					   const ChangeTick& change_tick,
+					   ChunkLayout layout = ChunkLayout::kColumnar,
+					   size_t column_alignment = kCacheLineSize);
+	// Destroys the attributes of the remaining entities and returns the chunks of the archetype to
+	// the chunk pool.
+	~Archetype();
+	Archetype(const Archetype&) = delete;
+	Archetype& operator=(const Archetype&) = delete;
 
 	// Adds an entity to the archetype and returns its index within the archetype.
-	// Function will allocate new chunk if necessary.
+	// Function will allocate new chunk if necessary. The attributes of the entity are left
+	// uninitialized; every column must be constructed before it is used. All columns of the chunk
+	// are marked as added and changed.
 	size_t AddEntity(EntityID entity_id);
-	// Removes an entity from the archetype.
-	void RemoveEntity(EntityID entity_id);
-
-	// Retrieves a reference to the attribute of the specified type for the given entity.
-	IAttribute& GetAttribute(EntityID entity_id, AttributeType attribute_type);
-	// Sets the attribute of the specified type for the given entity.
-	void SetAttribute(EntityID entity_id, AttributeType attribute_type, IAttribute& attribute);
+	// Adds count entities to the archetype and returns the index of the first one. The entities
+	// occupy consecutive indices. All chunks needed are allocated up front. The attributes of the
+	// entities are left uninitialized.
+	size_t AddEntities(const EntityID* entity_ids, size_t count);
+	// Default constructs every attribute of the count entities starting at the given index.
+	void ConstructAttributes(size_t first_index, size_t count = 1);
+	// Destroys the attributes of the entity at the given index and removes it. The last entity is
+	// relocated into the freed slot to keep the archetype contiguous, marking the columns of its
+	// new chunk as changed; returns that entity, or kNullEntity if the removed entity was the last
+	// one. Chunks left empty at the end of the archetype are returned to the chunk pool.
+	EntityID RemoveEntity(size_t index);
+	// Same as RemoveEntity, but the attributes of the entity were already relocated or destroyed
+	// by the caller.
+	EntityID RemoveRelocatedEntity(size_t index);
 
 	// Iterates over all entities in the archetype, applying the provided function.
 	template<typename Func>
@@ -41,35 +128,212 @@ public:
 		}
 	}
 
+	// Iterates over all non-empty chunks in the archetype, applying the provided function to an
+	// ArchetypeChunk view of each of them.
+	template<typename Func>
+	void ForEachChunk(Func&& func) {
+		size_t chunk_count = GetChunkCount();
+		for (size_t chunk_index = 0; chunk_index < chunk_count; ++chunk_index) {
+			func(GetChunk(chunk_index));
+		}
+	}
+
+	// Returns the number of non-empty chunks in the archetype.
+	inline size_t GetChunkCount() const {
+		return entities_.empty() ? 0 : (entities_.size() - 1) / entities_per_chunk_ + 1;
+	}
+	// Returns a view over the chunk with the given index. The index must be smaller than
+	// GetChunkCount().
+	inline ArchetypeChunk GetChunk(size_t chunk_index) {
+		size_t first = chunk_index * entities_per_chunk_;
+		return {chunk_index, std::min(entities_per_chunk_, entities_.size() - first),
+				entities_.data() + first, chunks_[chunk_index]};
+	}
+
+	// Returns the entity stored at the given index.
+	inline EntityID GetEntity(size_t index) const { return entities_[index]; }
+	// Returns the location of the entity stored at the given index.
+	inline EntityLocation GetLocation(size_t index) {
+		return {this, static_cast<uint32_t>(index / entities_per_chunk_),
+				static_cast<uint32_t>(index % entities_per_chunk_)};
+	}
+	// Returns the index within the archetype of the entity at the given location.
+	inline size_t GetIndex(const EntityLocation& location) const {
+		return location.chunk * entities_per_chunk_ + location.row;
+	}
+	// Returns the address of the given column for the entity at the given index.
+	inline uint8_t* GetAttributeData(size_t entity_index, size_t column) {
+		return GetAttributeData(GetLocation(entity_index), column);
+	}
+	// Returns the address of the given column for the entity at the given location.
+	inline uint8_t* GetAttributeData(const EntityLocation& location, size_t column) {
+		return chunks_[location.chunk] + column_offsets_[column] +
+			   location.row * column_strides_[column];
+	}
+
+	// Returns the column index of the given attribute type. Throws if the archetype does not
+	// contain the attribute type.
+	size_t GetColumnIndex(AttributeType attribute_type) const;
+	// Returns the column index of the given attribute type, or kNoColumn if the archetype does not
+	// contain the attribute type.
+	inline size_t FindColumnIndex(AttributeType attribute_type) const {
+		return attribute_type_to_column_[attribute_type];
+	}
+	// Returns the start of the given column within a chunk. Consecutive entities are
+	// GetColumnStride(column) bytes apart.
+	inline uint8_t* GetColumnData(const ArchetypeChunk& chunk, size_t column) const {
+		return chunk.data + column_offsets_[column];
+	}
+	// Returns the distance in bytes between two consecutive entities of the given column.
+	inline size_t GetColumnStride(size_t column) const { return column_strides_[column]; }
+	// Returns the offset of the given column from the start of a chunk.
+	inline size_t GetColumnOffset(size_t column) const { return column_offsets_[column]; }
+
+	// Returns a typed pointer to the column of the given attribute type within a chunk. The
+	// column holds chunk.size consecutive elements. Only available for columnar archetypes.
+	// Unless T is const-qualified, the column is marked as changed.
+	template<typename T>
+	T* GetColumn(const ArchetypeChunk& chunk, AttributeType attribute_type) {
+		if (layout_ != ChunkLayout::kColumnar) {
+			throw std::runtime_error("Typed column access requires a columnar chunk layout.");
+		}
+		return TryGetColumn<T>(chunk, attribute_type);
+	}
+	// Same as GetColumn, but returns nullptr when the elements of the column are not contiguous,
+	// in which case the caller falls back to a per entity Query over the chunk.
+	template<typename T>
+	T* TryGetColumn(const ArchetypeChunk& chunk, AttributeType attribute_type) {
+		if (layout_ != ChunkLayout::kColumnar) {
+			return nullptr;
+		}
+		size_t column = GetColumnIndex(attribute_type);
+		if constexpr (!std::is_const_v<T>) {
+			MarkChanged(chunk.index, column);
+		}
+		return reinterpret_cast<T*>(GetColumnData(chunk, column));
+	}
+
+	// Stamps the given column of the chunk with the current change tick. Must be called whenever
+	// the column is handed out for writing. Safe to call concurrently.
+	inline void MarkChanged(size_t chunk_index, size_t column) {
+		std::atomic_ref<ChangeTick>(GetColumnTicks(chunk_index, column).changed)
+				.store(change_tick_, std::memory_order_relaxed);
+	}
+	// Returns the tick at which the given column of the chunk was last written.
+	inline ChangeTick GetChangedTick(size_t chunk_index, size_t column) const {
+		return std::atomic_ref<ChangeTick>(GetColumnTicks(chunk_index, column).changed)
+				.load(std::memory_order_relaxed);
+	}
+	// Returns the tick at which the chunk last received entities.
+	inline ChangeTick GetAddedTick(size_t chunk_index, size_t column) const {
+		return std::atomic_ref<ChangeTick>(GetColumnTicks(chunk_index, column).added)
+				.load(std::memory_order_relaxed);
+	}
+
+	// Returns the attribute types stored in this archetype, in column order.
+	inline const std::vector<AttributeType>& GetAttributeTypes() const { return attribute_types_; }
+	// Returns the operations of the attribute stored in the given column.
+	inline const AttributeInfo& GetAttributeInfo(size_t column) const {
+		return *attribute_infos_[column];
+	}
+	// Returns the size in bytes of the attribute stored in the given column.
+	inline size_t GetAttributeSize(size_t column) const { return attribute_infos_[column]->size; }
+
+	// Returns the cached edge followed when the given attribute type is added to an entity.
+	inline ArchetypeEdge& GetAddEdge(AttributeType attribute_type) {
+		return add_edges_[attribute_type];
+	}
+	// Returns the cached edge followed when the given attribute type is removed from an entity.
+	inline ArchetypeEdge& GetRemoveEdge(AttributeType attribute_type) {
+		return remove_edges_[attribute_type];
+	}
+	// Returns the cached edges followed when several attribute types are added or removed at once,
+	// keyed by the signature of their target.
+	inline std::unordered_map<ArchetypeSignature, ArchetypeEdge>& GetMultiEdges() {
+		return multi_edges_;
+	}
+
+	// Returns the number of entities in the archetype.
+	inline size_t GetEntityCount() const { return entities_.size(); }
+	// Returns the entities of the archetype, in row order.
+	inline const std::vector<EntityID>& GetEntities() const { return entities_; }
+	// Returns the number of entities that fit in a single chunk.
+	inline size_t GetEntitiesPerChunk() const { return entities_per_chunk_; }
 	// Returns the signature of this archetype.
 	inline ArchetypeSignature GetSignature() const { return signature_; }
+	// Returns the chunk layout of this archetype.
+	inline ChunkLayout GetChunkLayout() const { return layout_; }
+
+private:
+	// Change ticks of a single column within a chunk.
+	struct ColumnTicks {
+		// Tick at which entities were last added to the chunk.
+		ChangeTick added;
+		// Tick at which the column was last written, entity additions included.
+		ChangeTick changed;
+	};
+
+	// Destroys every attribute of the entity at the given index.
+	void DestroyAttributes(size_t index);
+	// Allocates chunks from the pool until the archetype has chunk_count of them.
+	void AllocateChunks(size_t chunk_count);
+	// Marks every column of the chunk as added and changed.
+	void MarkAdded(size_t chunk_index);
+	inline ColumnTicks& GetColumnTicks(size_t chunk_index, size_t column) const {
+		return column_ticks_[chunk_index * attribute_types_.size() + column];
+	}
 
 private:
 	// Signature representing the set of attributes for this archetype.
 	ArchetypeSignature signature_;
+	// Layout of the attribute data inside each chunk.
+	ChunkLayout layout_;
 
 	// Types of attributes stored in this archetype.
 	std::vector<AttributeType> attribute_types_;
-	// Map from attribute type to its index in the attribute_types_ vector. Used for fast internal
-	// management.
-	std::unordered_map<AttributeType, size_t> attribute_type_to_index_;
-	// Offsets of each attribute type within an entity's data block. This is calculated in the
-	// constructor based on the attribute sizes provided by computing the partial sums.
-	std::vector<size_t> attribute_offsets_;
-
-	// Stride (in bytes) of a single entity's data block within a chunk.
+	// Index in the attribute_types_ vector of each attribute type, or kNoColumn. Used for fast
+	// internal management.
+	std::array<size_t, kMaxAttributes> attribute_type_to_column_;
+	// Operations of each attribute type, in column order.
+	std::vector<const AttributeInfo*> attribute_infos_;
+	// Set when all attributes are trivial, so entities can be relocated and dropped without
+	// going through the attribute operations.
+	bool trivial_;
+	// Offsets of each attribute column from the start of a chunk. For interleaved layouts this is
+	// the offset within an entity's data block.
+	std::vector<size_t> column_offsets_;
+	// Distance in bytes between two consecutive entities within each column. For interleaved
+	// layouts this is the entity stride, for columnar layouts the attribute size. Attribute sizes
+	// are multiples of their alignment, so every element of a column stays aligned.
+	std::vector<size_t> column_strides_;
+
+	// Stride (in bytes) of a single entity's data across all attributes. Includes the alignment
+	// padding for interleaved layouts.
 	size_t entity_stride_;
 	// Number of entities that can fit in a single chunk.
 	size_t entities_per_chunk_;
 	// List of entities in this archetype.
 	std::vector<EntityID> entities_;
-	// Map from entity ID to its index within the archetype.
-	std::unordered_map<EntityID, size_t> entity_to_index_;
 
-	// Data chunks storing entity attribute data. Each entity has its own block in the chunk where
-	// all its attributes are stored contiguously. An entity block will not be split across multiple
-	// chunks.
-	std::vector<std::unique_ptr<uint8_t[]>> chunks_;
+	// Data chunks storing entity attribute data. Entity data will not be split across multiple
+	// chunks. See ChunkLayout for how the data is arranged inside a chunk. Owned by the archetype,
+	// allocated from and returned to the ChunkPool.
+	std::vector<uint8_t*> chunks_;
+	// Pool the chunks come from. Fetched on construction, so the pool outlives every archetype.
+	ChunkPool& chunk_pool_;
+	// Change ticks of every column of every chunk, chunk major. Mutable and accessed through
+	// std::atomic_ref, as concurrent chunk jobs may stamp the same column.
+	mutable std::vector<ColumnTicks> column_ticks_;
+	// Current change tick, owned by the ArchetypeManager.
+	const ChangeTick& change_tick_;
+
+	// Transitions to the archetypes reached by adding one attribute type, indexed by type.
+	std::array<ArchetypeEdge, kMaxAttributes> add_edges_;
+	// Transitions to the archetypes reached by removing one attribute type, indexed by type.
+	std::array<ArchetypeEdge, kMaxAttributes> remove_edges_;
+	// Transitions changing more than one attribute type, keyed by target signature. Only filled
+	// by the structural changes applied in bulk from command buffers.
+	std::unordered_map<ArchetypeSignature, ArchetypeEdge> multi_edges_;
 };
 } // namespace core::ecs
 
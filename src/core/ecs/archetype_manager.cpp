@@ -1,13 +1,14 @@
 #include "archetype_manager.h"
 
+#include <algorithm>
 #include <functional>
 #include <memory>
-#include <optional>
+#include <mutex>
 #include <stdexcept>
 #include <vector>
 
 #include "archetype.h"
-#include "ecs_manager.h"
+#include "chunk_pool.h"
 #include "types.h"
 
 namespace core::ecs {
@@ -18,14 +19,31 @@ ArchetypeManager::ArchetypeManager() {
 	empty_signature.reset();
 	signature_to_archetypes_[empty_signature] = std::make_unique<Archetype>(
 													empty_signature,
-													std::vector<size_t>{},
-													std::vector<AttributeType>{});
+													std::vector<const AttributeInfo*>{},
+													std::vector<AttributeType>{},
+													change_tick_);
+}
 
-	// TODO: Notify SystemManager about the new archetype
+void ArchetypeManager::RegisterAttributeType(AttributeType attribute_type,
+											 const AttributeInfo& attribute_info,
+											 const std::string& name) {
+	if (name.empty()) {
+		throw std::runtime_error("Attribute types must be registered with a name.");
+	}
+	for (const auto& [type, registered_name] : attribute_type_to_name_) {
+		if (type != attribute_type && registered_name == name) {
+			throw std::runtime_error("Attribute type name already registered: " + name);
+		}
+	}
+	attribute_type_to_info_[attribute_type] = &attribute_info;
+	attribute_type_to_name_[attribute_type] = name;
 }
 
-void ArchetypeManager::RegisterAttributeType(AttributeType attribute_type, size_t attribute_size) {
-	attribute_type_to_size_[attribute_type] = attribute_size;
+void ArchetypeManager::SetChunkLayout(const ArchetypeSignature& signature, ChunkLayout layout) {
+	if (signature_to_archetypes_.contains(signature)) {
+		throw std::runtime_error("Cannot change the chunk layout of an existing archetype.");
+	}
+	chunk_layout_overrides_[signature] = layout;
 }
 
 std::reference_wrapper<Archetype> ArchetypeManager::GetOrCreateArchetype(
@@ -35,112 +53,285 @@ std::reference_wrapper<Archetype> ArchetypeManager::GetOrCreateArchetype(
 		return *(it->second);
 	}
 
-	std::vector<size_t> attribute_sizes;
+	std::vector<const AttributeInfo*> attribute_infos;
 	std::vector<AttributeType> attribute_types;
 
 	for (size_t i = 0; i < kMaxAttributes; ++i) {
 		if (signature.test(i)) {
 			AttributeType attr_type = static_cast<AttributeType>(i);
-			auto size_it = attribute_type_to_size_.find(attr_type);
-			if (size_it == attribute_type_to_size_.end()) {
+			auto info_it = attribute_type_to_info_.find(attr_type);
+			if (info_it == attribute_type_to_info_.end()) {
 				throw std::runtime_error("Attribute type not registered in ArchetypeManager.");
 			}
 			attribute_types.push_back(attr_type);
-			attribute_sizes.push_back(size_it->second);
+			attribute_infos.push_back(info_it->second);
 		}
 	}
 
-	auto archetype = std::make_unique<Archetype>(signature, attribute_sizes, attribute_types);
+	ChunkLayout layout = default_chunk_layout_;
+	auto layout_it = chunk_layout_overrides_.find(signature);
+	if (layout_it != chunk_layout_overrides_.end()) {
+		layout = layout_it->second;
+	}
+
+	auto archetype = std::make_unique<Archetype>(signature, attribute_infos, attribute_types,
+												 change_tick_, layout, column_alignment_);
 	Archetype& archetype_ref = *archetype;
 	signature_to_archetypes_[signature] = std::move(archetype);
 
-	// Notify SystemManager about the new archetype
-	ECSManager& ecs_manager = ECSManager::GetInstance();
-	ecs_manager.GetSystemManager().OnArchetypeCreated(archetype_ref);
+	// Keep the cached query results current.
+	std::lock_guard<std::mutex> lock(query_cache_mutex_);
+	for (auto& [terms, archetypes] : query_cache_) {
+		if (terms.Matches(signature)) {
+			archetypes.push_back(&archetype_ref);
+		}
+	}
 
 	return archetype_ref;
 }
 
 void ArchetypeManager::AddEntity(EntityID entity_id, const ArchetypeSignature& signature) {
+	Archetype& archetype = GetOrCreateArchetype(signature).get();
+	size_t index = archetype.AddEntity(entity_id);
+	archetype.ConstructAttributes(index);
+	SetEntityLocation(entity_id, archetype, index);
+}
+
+std::pair<std::reference_wrapper<Archetype>, size_t> ArchetypeManager::AddEntities(
+		const std::vector<EntityID>& entity_ids, const ArchetypeSignature& signature,
+		bool construct) {
 	auto archetype = GetOrCreateArchetype(signature);
-	archetype.get().AddEntity(entity_id);
-	entity_to_archetype_.insert({entity_id, archetype});
+	size_t first_index = archetype.get().AddEntities(entity_ids.data(), entity_ids.size());
+	if (construct) {
+		archetype.get().ConstructAttributes(first_index, entity_ids.size());
+	}
+	for (size_t i = 0; i < entity_ids.size(); ++i) {
+		SetEntityLocation(entity_ids[i], archetype.get(), first_index + i);
+	}
+	return {archetype, first_index};
 }
 
 void ArchetypeManager::RemoveEntity(EntityID entity_id) {
+	// Emptied archetypes are kept around, as entities tend to come back to them. They are freed
+	// by CompactArchetypes.
+	EntityLocation location = GetEntityLocation(entity_id);
+	RemoveFromArchetype(location);
+	entity_locations_[ToEntityIndex(entity_id)] = EntityLocation{};
+}
 
-	// TODO: We may want to free up archetypes if they become empty.
+const EntityLocation& ArchetypeManager::GetEntityLocation(EntityID entity_id) const {
+	const EntityLocation* location = FindEntityLocation(entity_id);
+	if (location == nullptr) {
+		throw std::runtime_error("Entity not found in any archetype.");
+	}
+	return *location;
+}
 
-	auto it = entity_to_archetype_.find(entity_id);
-	if (it == entity_to_archetype_.end()) {
-		throw std::runtime_error("Archetype with given signature does not exist.");
+void ArchetypeManager::SetEntityLocation(EntityID entity_id, Archetype& archetype, size_t index) {
+	uint32_t entity_index = ToEntityIndex(entity_id);
+	if (entity_index >= entity_locations_.size()) {
+		entity_locations_.resize(entity_index + 1);
 	}
-	it->second.get().RemoveEntity(entity_id);
-	entity_to_archetype_.erase(entity_id);
+	entity_locations_[entity_index] = archetype.GetLocation(index);
 }
 
+void ArchetypeManager::RemoveFromArchetype(const EntityLocation& location, bool relocated) {
+	Archetype& archetype = *location.archetype;
+	size_t index = archetype.GetIndex(location);
+	EntityID moved_entity = relocated ? archetype.RemoveRelocatedEntity(index)
+									  : archetype.RemoveEntity(index);
+	if (moved_entity != kNullEntity) {
+		// The last entity of the archetype took over the freed slot.
+		entity_locations_[ToEntityIndex(moved_entity)] = location;
+	}
+}
+
+namespace {
+
+// Builds the edge followed when an entity moves from source to target: the columns to relocate,
+// the target columns to construct and the source columns to destroy.
+ArchetypeEdge BuildEdge(const Archetype& source, Archetype& target) {
+	ArchetypeEdge edge{&target, {}, {}, {}};
+	const std::vector<AttributeType>& source_types = source.GetAttributeTypes();
+	for (size_t column = 0; column < source_types.size(); ++column) {
+		if (target.GetSignature().test(source_types[column])) {
+			edge.copy_plan.push_back({column, target.GetColumnIndex(source_types[column]),
+									  &source.GetAttributeInfo(column)});
+		} else {
+			edge.destroyed_columns.push_back(column);
+		}
+	}
+	const std::vector<AttributeType>& target_types = target.GetAttributeTypes();
+	for (size_t column = 0; column < target_types.size(); ++column) {
+		if (!source.GetSignature().test(target_types[column])) {
+			edge.constructed_columns.push_back(column);
+		}
+	}
+	return edge;
+}
+} // namespace
+
 void ArchetypeManager::UpdateEntityArchetype(EntityID entity_id,
 											 const ArchetypeSignature& old_signature,
 											 const ArchetypeSignature& new_signature) {
-	
-	auto& old_archetype = GetOrCreateArchetype(old_signature).get();
-	auto& new_archetype = GetOrCreateArchetype(new_signature).get();
+	Archetype& source = *GetEntityLocation(entity_id).archetype;
+	if (source.GetSignature() != old_signature) {
+		throw std::runtime_error("Entity is not part of the source archetype.");
+	}
+	ArchetypeSignature changed = old_signature ^ new_signature;
+	if (changed.none()) {
+		return;
+	}
+	if (changed.count() == 1) {
+		// Single changes share the edges of AddEntityAttribute and RemoveEntityAttribute.
+		AttributeType attribute_type = 0;
+		while (!changed.test(attribute_type)) {
+			++attribute_type;
+		}
+		MoveEntity(entity_id, source,
+				   GetOrCreateEdge(source, attribute_type, new_signature.test(attribute_type)));
+		return;
+	}
 
-	new_archetype.AddEntity(entity_id);
+	ArchetypeEdge& edge = source.GetMultiEdges()[new_signature];
+	if (edge.target == nullptr) {
+		edge = BuildEdge(source, GetOrCreateArchetype(new_signature).get());
+	}
+	MoveEntity(entity_id, source, edge);
+}
 
-	for (AttributeType type = 0; type < kMaxAttributes; ++type) {
-		if (old_signature.test(type) && new_signature.test(type)) {
-			auto& attribute = old_archetype.GetAttribute(entity_id, type);
-			new_archetype.SetAttribute(entity_id, type, attribute);
-		}
+void ArchetypeManager::AddEntityAttribute(EntityID entity_id, AttributeType attribute_type) {
+	Archetype& source = *GetEntityLocation(entity_id).archetype;
+	// The edge would lead back to the source, and moving within an archetype corrupts the
+	// locations.
+	if (source.GetSignature().test(attribute_type)) {
+		return;
 	}
+	MoveEntity(entity_id, source, GetOrCreateEdge(source, attribute_type, true));
+}
 
-	// Remove from old archetype
-	old_archetype.RemoveEntity(entity_id);
-	// Update mapping
-	entity_to_archetype_.erase(entity_id);
-	entity_to_archetype_.insert({entity_id, new_archetype});
+void ArchetypeManager::RemoveEntityAttribute(EntityID entity_id, AttributeType attribute_type) {
+	Archetype& source = *GetEntityLocation(entity_id).archetype;
+	if (!source.GetSignature().test(attribute_type)) {
+		return;
+	}
+	MoveEntity(entity_id, source, GetOrCreateEdge(source, attribute_type, false));
 }
 
-std::optional<std::reference_wrapper<Archetype>> ArchetypeManager::GetEntityArchetype(
-		EntityID entity_id) {
-	auto it = entity_to_archetype_.find(entity_id);
-	if (it == entity_to_archetype_.end()) {
-		return std::nullopt;
+ArchetypeEdge& ArchetypeManager::GetOrCreateEdge(Archetype& source, AttributeType attribute_type,
+												 bool add) {
+	ArchetypeEdge& edge = add ? source.GetAddEdge(attribute_type)
+							  : source.GetRemoveEdge(attribute_type);
+	if (edge.target != nullptr) {
+		return edge;
 	}
-	return it->second;
+
+	ArchetypeSignature target_signature = source.GetSignature();
+	target_signature.set(attribute_type, add);
+	Archetype& target = GetOrCreateArchetype(target_signature).get();
+
+	edge = BuildEdge(source, target);
+
+	// The opposite transition is known as well, cache it on the target.
+	ArchetypeEdge& back_edge = add ? target.GetRemoveEdge(attribute_type)
+								   : target.GetAddEdge(attribute_type);
+	if (back_edge.target == nullptr) {
+		back_edge = BuildEdge(target, source);
+	}
+	return edge;
 }
 
-std::optional<std::reference_wrapper<IAttribute>> ArchetypeManager::GetAttribute(
-		EntityID entity_id, AttributeType attribute_type) {
-	auto archetype_opt = GetEntityArchetype(entity_id);
-	if (!archetype_opt.has_value()) {
-		return std::nullopt;
+void ArchetypeManager::MoveEntity(EntityID entity_id, Archetype& source,
+								  const ArchetypeEdge& edge) {
+	Archetype& target = *edge.target;
+	EntityLocation source_location = GetEntityLocation(entity_id);
+	if (source_location.archetype != &source) {
+		throw std::runtime_error("Entity is not part of the source archetype.");
 	}
-	IAttribute& attribute = archetype_opt->get().GetAttribute(entity_id, attribute_type);
-	return attribute;
+	size_t target_index = target.AddEntity(entity_id);
+
+	for (const ColumnCopy& copy : edge.copy_plan) {
+		copy.info->Relocate(target.GetAttributeData(target_index, copy.target_column),
+							source.GetAttributeData(source_location, copy.source_column));
+	}
+	for (size_t column : edge.constructed_columns) {
+		target.GetAttributeInfo(column).DefaultConstruct(target.GetAttributeData(target_index,
+																				 column));
+	}
+	for (size_t column : edge.destroyed_columns) {
+		source.GetAttributeInfo(column).Destroy(source.GetAttributeData(source_location, column));
+	}
+
+	// Remove from old archetype, all its attributes were relocated or destroyed
+	RemoveFromArchetype(source_location, true);
+	// Update mapping
+	SetEntityLocation(entity_id, target, target_index);
 }
 
 void ArchetypeManager::SetAttribute(EntityID entity_id, AttributeType attribute_type,
-		IAttribute& attribute) {
-	auto archetype_opt = GetEntityArchetype(entity_id);
-	if (!archetype_opt.has_value()) {
-		throw std::runtime_error("Entity not found in any archetype.");
-	}
-	archetype_opt->get().SetAttribute(entity_id, attribute_type, attribute);
+		const IAttribute& attribute) {
+	const EntityLocation& location = GetEntityLocation(entity_id);
+	Archetype& archetype = *location.archetype;
+	size_t column = archetype.GetColumnIndex(attribute_type);
+	archetype.MarkChanged(location.chunk, column);
+	archetype.GetAttributeInfo(column).CopyAssign(archetype.GetAttributeData(location, column),
+												  &attribute);
 }
 
-std::vector<std::reference_wrapper<Archetype>> ArchetypeManager::QueryArchetypes(
-		const ArchetypeSignature& signature) {
+size_t ArchetypeManager::CompactArchetypes() {
+	std::vector<Archetype*> removed;
+	for (auto& [signature, archetype] : signature_to_archetypes_) {
+		if (signature.any() && archetype->GetEntityCount() == 0) {
+			removed.push_back(archetype.get());
+		}
+	}
+	if (removed.empty()) {
+		return 0;
+	}
+	std::sort(removed.begin(), removed.end());
+
+	auto is_removed = [&](const Archetype* archetype) {
+		return std::binary_search(removed.begin(), removed.end(), archetype);
+	};
+	for (auto& [signature, archetype] : signature_to_archetypes_) {
+		if (is_removed(archetype.get())) {
+			continue;
+		}
+		for (AttributeType type = 0; type < kMaxAttributes; ++type) {
+			for (ArchetypeEdge* edge : {&archetype->GetAddEdge(type),
+										&archetype->GetRemoveEdge(type)}) {
+				if (edge->target != nullptr && is_removed(edge->target)) {
+					*edge = ArchetypeEdge{};
+				}
+			}
+		}
+		std::erase_if(archetype->GetMultiEdges(),
+					  [&](const auto& entry) { return is_removed(entry.second.target); });
+	}
 
-	// TODO: Optimize by doing 2 binary searches on the sorted signatures, upper and lower bounds
-	// and keep the interval.
+	{
+		std::lock_guard<std::mutex> lock(query_cache_mutex_);
+		for (auto& [terms, archetypes] : query_cache_) {
+			std::erase_if(archetypes, is_removed);
+		}
+	}
+	for (Archetype* archetype : removed) {
+		signature_to_archetypes_.erase(archetype->GetSignature());
+	}
+	ChunkPool::GetInstance().Trim();
+	return removed.size();
+}
 
-	std::vector<std::reference_wrapper<Archetype>> archetypes;
-	archetypes.reserve(signature_to_archetypes_.size());
-	for (auto& [signature, archetype_ptr] : signature_to_archetypes_) {
-		archetypes.push_back(*archetype_ptr);
+const std::vector<Archetype*>& ArchetypeManager::QueryArchetypes(const QueryTerms& terms) {
+	std::lock_guard<std::mutex> lock(query_cache_mutex_);
+	auto [it, inserted] = query_cache_.try_emplace(terms);
+	if (inserted) {
+		for (auto& [signature, archetype] : signature_to_archetypes_) {
+			if (terms.Matches(signature)) {
+				it->second.push_back(archetype.get());
+			}
+		}
 	}
-	return archetypes;
+	return it->second;
 }
 } // namespace core::ecs
\ No newline at end of file
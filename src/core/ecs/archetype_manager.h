@@ -3,9 +3,12 @@
 
 #include <functional>
 #include <memory>
-#include <optional>
+#include <mutex>
 #include <stdexcept>
+#include <string>
 #include <unordered_map>
+#include <utility>
+#include <vector>
 
 #include "archetype.h"
 #include "types.h"
@@ -16,32 +19,115 @@ class ArchetypeManager {
 public:
 	explicit ArchetypeManager();
 
-	// Registers a new attribute type with its size.
-	// If attribute type already exists, it overrides its size.
-	void RegisterAttributeType(AttributeType attribute_type, size_t attribute_size);
+	// Registers a new attribute type with its operations and name. The name identifies the
+	// attribute type in saved worlds, so it must not depend on the build and must be unique among
+	// the registered types; throws otherwise.
+	// If attribute type already exists, it overrides its operations and name.
+	void RegisterAttributeType(AttributeType attribute_type, const AttributeInfo& attribute_info,
+							   const std::string& name);
+	// Returns the operations of every registered attribute type.
+	inline const std::unordered_map<AttributeType, const AttributeInfo*>& GetAttributeInfos() const {
+		return attribute_type_to_info_;
+	}
+	// Returns the names of every registered attribute type.
+	inline const std::unordered_map<AttributeType, std::string>& GetAttributeNames() const {
+		return attribute_type_to_name_;
+	}
+
+	// Sets the chunk layout used by archetypes created from now on.
+	inline void SetDefaultChunkLayout(ChunkLayout layout) { default_chunk_layout_ = layout; }
+	// Sets the minimum alignment of the columns of columnar archetypes created from now on.
+	// Defaults to kCacheLineSize; 1 packs the columns as tightly as their attributes allow.
+	inline void SetColumnAlignment(size_t alignment) { column_alignment_ = alignment; }
+	// Overrides the chunk layout of the archetype with the given signature. Must be called before
+	// the archetype is created, otherwise throws an exception.
+	void SetChunkLayout(const ArchetypeSignature& signature, ChunkLayout layout);
 
-	// Adds an entity to the archetype matching the given signature. May create a new archetype if
-	// necessary.
+	// Adds an entity to the archetype matching the given signature, with default constructed
+	// attributes. May create a new archetype if necessary.
 	void AddEntity(EntityID entity_id, const ArchetypeSignature& signature);
+	// Adds entities to the archetype matching the given signature in a single batch, with default
+	// constructed attributes. May create a new archetype if necessary. Returns the archetype and
+	// the index of the first added entity; the entities occupy consecutive indices in the order
+	// given. Unless construct is set, the attributes are left uninitialized and the caller must
+	// write every one of them.
+	std::pair<std::reference_wrapper<Archetype>, size_t> AddEntities(
+			const std::vector<EntityID>& entity_ids, const ArchetypeSignature& signature,
+			bool construct = true);
 	// Removes an entity from the archetype matching the given signature.
 	void RemoveEntity(EntityID entity_id);
-	// Updates an entity's archetype from old_signature to new_signature.
+	// Updates an entity's archetype from old_signature to new_signature, following a cached edge.
+	// old_signature must be the signature of the entity's current archetype.
 	void UpdateEntityArchetype(EntityID entity_id,
 							   const ArchetypeSignature& old_signature,
 							   const ArchetypeSignature& new_signature);
+	// Moves an entity to the archetype obtained by adding the attribute type to its current one.
+	// Follows the cached archetype edge, so only the first transition pays for the lookup. Does
+	// nothing if the entity already has the attribute type.
+	void AddEntityAttribute(EntityID entity_id, AttributeType attribute_type);
+	// Moves an entity to the archetype obtained by removing the attribute type from its current
+	// one. Follows the cached archetype edge, so only the first transition pays for the lookup.
+	// Does nothing if the entity does not have the attribute type.
+	void RemoveEntityAttribute(EntityID entity_id, AttributeType attribute_type);
 
 
-	// Retrieves the attribute of the specified type for the given entity, if it exists.
-	std::optional<std::reference_wrapper<IAttribute>> GetAttribute(
-			EntityID entity_id, AttributeType attribute_type);
+	// Retrieves the attribute of the specified type for the given entity, or nullptr if the
+	// entity is not placed in an archetype or does not have the attribute. Costs a lookup in the
+	// location table and one in the archetype's column table. The attribute may be written
+	// through the returned pointer, so its column is marked as changed.
+	inline IAttribute* GetAttribute(EntityID entity_id, AttributeType attribute_type) {
+		const EntityLocation* location = FindEntityLocation(entity_id);
+		if (location == nullptr) {
+			return nullptr;
+		}
+		size_t column = location->archetype->FindColumnIndex(attribute_type);
+		if (column == kNoColumn) {
+			return nullptr;
+		}
+		location->archetype->MarkChanged(location->chunk, column);
+		return reinterpret_cast<IAttribute*>(location->archetype->GetAttributeData(*location,
+																				   column));
+	}
+	// Same as GetAttribute, for read-only access. Leaves the change ticks untouched.
+	inline const IAttribute* FindAttribute(EntityID entity_id, AttributeType attribute_type) const {
+		const EntityLocation* location = FindEntityLocation(entity_id);
+		if (location == nullptr) {
+			return nullptr;
+		}
+		size_t column = location->archetype->FindColumnIndex(attribute_type);
+		if (column == kNoColumn) {
+			return nullptr;
+		}
+		return reinterpret_cast<const IAttribute*>(
+				location->archetype->GetAttributeData(*location, column));
+	}
 	// Sets the attribute of the specified type for the given entity. If the entity or attribute type
 	// does not exist, throws an exception.
-	void SetAttribute(EntityID entity_id, AttributeType attribute_type, IAttribute& attribute);
+	void SetAttribute(EntityID entity_id, AttributeType attribute_type,
+					  const IAttribute& attribute);
 
-	// Queries all archetypes that match the given signature (i.e., contain at least the attributes
-	// specified in the signature).
-	std::vector<std::reference_wrapper<Archetype>> QueryArchetypes(
-			const ArchetypeSignature& signature);
+	// Returns the archetypes matching the given terms. Results are cached per terms: the first call
+	// scans all archetypes, later calls are a hash lookup. Cached results are kept up to date as
+	// archetypes are created and compacted, so the returned vector stays valid and current for
+	// the lifetime of the manager.
+	const std::vector<Archetype*>& QueryArchetypes(const QueryTerms& terms);
+	// Same as QueryArchetypes, for the archetypes containing at least the attributes of the
+	// signature.
+	inline const std::vector<Archetype*>& QueryArchetypes(const ArchetypeSignature& signature) {
+		return QueryArchetypes(QueryTerms{signature, {}});
+	}
+
+	// Returns the tick stamped on the columns written from now on.
+	inline ChangeTick GetChangeTick() const { return change_tick_; }
+	// Advances the change tick and returns the new value. Must not be called while systems run.
+	inline ChangeTick AdvanceChangeTick() { return ++change_tick_; }
+
+	// Destroys the archetypes that hold no entity, except the one for entities without attributes,
+	// and returns their chunk memory to the operating system. Edges leading to them are cleared
+	// and they are dropped from the cached query results. Returns the number of archetypes
+	// destroyed.
+	// Must not be called while systems are running.
+	size_t CompactArchetypes();
 
 	std::unordered_map<ArchetypeSignature, std::unique_ptr<Archetype>>& GetAllArchetypes() {
 		return signature_to_archetypes_;
@@ -50,19 +136,60 @@ private:
 	// Retrieves an existing archetype matching the signature or creates a new one if it doesn't
 	// exist.
 	std::reference_wrapper<Archetype> GetOrCreateArchetype(const ArchetypeSignature& signature);
-	// Retrieves the archetype an entity belongs to. Returns std::nullopt if the entity is not
-	// found.
-	std::optional<std::reference_wrapper<Archetype>> GetEntityArchetype(EntityID entity_id);
+	// Returns the location of the entity, or nullptr if the entity is not placed in an archetype.
+	inline const EntityLocation* FindEntityLocation(EntityID entity_id) const {
+		uint32_t index = ToEntityIndex(entity_id);
+		if (index >= entity_locations_.size()) {
+			return nullptr;
+		}
+		const EntityLocation& location = entity_locations_[index];
+		// The index may have been recycled since the handle was handed out.
+		if (location.archetype == nullptr ||
+			location.archetype->GetEntity(location.archetype->GetIndex(location)) != entity_id) {
+			return nullptr;
+		}
+		return &location;
+	}
+	// Returns the location of the entity. Throws if the entity is not placed in an archetype.
+	const EntityLocation& GetEntityLocation(EntityID entity_id) const;
+	// Records the location of the entity at the given index of the archetype.
+	void SetEntityLocation(EntityID entity_id, Archetype& archetype, size_t index);
+	// Removes the entity at the given location from its archetype, fixing up the location of the
+	// entity moved into its slot. Set relocated if the attributes of the entity were already
+	// relocated or destroyed.
+	void RemoveFromArchetype(const EntityLocation& location, bool relocated = false);
+	// Resolves the edge of the source archetype for adding (or removing) the attribute type,
+	// creating the target archetype and the copy plan if necessary.
+	ArchetypeEdge& GetOrCreateEdge(Archetype& source, AttributeType attribute_type, bool add);
+	// Moves an entity from the source archetype along the given edge and updates its mapping.
+	void MoveEntity(EntityID entity_id, Archetype& source, const ArchetypeEdge& edge);
 
 private:
-	// Maps attribute types to their sizes. Used when creating new archetypes for in-chunk attribute
-	// delimitation.
-	std::unordered_map<AttributeType, size_t> attribute_type_to_size_;
-	// Maps entity IDs to their corresponding archetypes. Used for quick lookup of an entity's
-	// archetype.
-	std::unordered_map<EntityID, std::reference_wrapper<Archetype>> entity_to_archetype_;
+	// Maps attribute types to their operations. Used when creating new archetypes for in-chunk
+	// attribute delimitation and to construct, relocate and destroy attribute data.
+	std::unordered_map<AttributeType, const AttributeInfo*> attribute_type_to_info_;
+	// Names the attribute types were registered with.
+	std::unordered_map<AttributeType, std::string> attribute_type_to_name_;
+	// Tick stamped on written columns. Starts above zero so that everything counts as changed for
+	// systems that never ran.
+	ChangeTick change_tick_ = 1;
+	// Location of every entity, indexed by entity index. Grows with the highest index placed.
+	std::vector<EntityLocation> entity_locations_;
 	// Maps archetype signatures to their corresponding archetype instances.
 	std::unordered_map<ArchetypeSignature, std::unique_ptr<Archetype>> signature_to_archetypes_;
+
+	// Chunk layout used for archetypes without an explicit override.
+	ChunkLayout default_chunk_layout_ = ChunkLayout::kColumnar;
+	// Minimum alignment of the columns of columnar archetypes.
+	size_t column_alignment_ = kCacheLineSize;
+	// Per-signature chunk layout overrides.
+	std::unordered_map<ArchetypeSignature, ChunkLayout> chunk_layout_overrides_;
+
+	// Archetypes matching each set of query terms seen so far, in creation order. Node based, so
+	// the vectors handed out by QueryArchetypes survive later insertions.
+	std::unordered_map<QueryTerms, std::vector<Archetype*>, QueryTermsHash> query_cache_;
+	// Guards query_cache_ lookups, as systems running concurrently may issue queries.
+	std::mutex query_cache_mutex_;
 };
 } // namespace core::ecs
 
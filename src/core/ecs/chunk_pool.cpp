@@ -0,0 +1,142 @@
+#include "chunk_pool.h"
+
+#include <algorithm>
+#include <new>
+#include <stdexcept>
+
+#include "archetype.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/mman.h>
+#define CORE_CHUNK_POOL_USE_MMAP
+#endif
+
+namespace core::ecs {
+
+namespace {
+
+static_assert(kChunkBlockSize % kChunkSize == 0, "Chunk blocks must hold whole chunks.");
+static_assert(kChunkSize % kChunkAlignment == 0, "Chunks must keep the block alignment.");
+
+uint8_t* ReserveBlock(bool use_huge_pages) {
+#if defined(CORE_CHUNK_POOL_USE_MMAP)
+	void* block = MAP_FAILED;
+#if defined(MAP_HUGETLB)
+	if (use_huge_pages) {
+		// Only succeeds if the system has huge pages reserved.
+		block = mmap(nullptr, kChunkBlockSize, PROT_READ | PROT_WRITE,
+					 MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+	}
+#endif
+	if (block == MAP_FAILED) {
+		block = mmap(nullptr, kChunkBlockSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS,
+					 -1, 0);
+		if (block == MAP_FAILED) {
+			throw std::bad_alloc();
+		}
+#if defined(MADV_HUGEPAGE)
+		if (use_huge_pages) {
+			// Let transparent huge pages back the block where possible.
+			madvise(block, kChunkBlockSize, MADV_HUGEPAGE);
+		}
+#endif
+	}
+	return static_cast<uint8_t*>(block);
+#else
+	return static_cast<uint8_t*>(::operator new(kChunkBlockSize, std::align_val_t(kChunkAlignment)));
+#endif
+}
+
+void FreeBlock(uint8_t* block) {
+#if defined(CORE_CHUNK_POOL_USE_MMAP)
+	munmap(block, kChunkBlockSize);
+#else
+	::operator delete(block, std::align_val_t(kChunkAlignment));
+#endif
+}
+} // namespace
+
+ChunkPool::~ChunkPool() {
+	for (uint8_t* block : blocks_) {
+		FreeBlock(block);
+	}
+}
+
+uint8_t* ChunkPool::Allocate() {
+	std::lock_guard<std::mutex> lock(mutex_);
+	if (free_chunks_.empty()) {
+		AllocateBlock();
+	}
+	uint8_t* chunk = free_chunks_.back();
+	free_chunks_.pop_back();
+	return chunk;
+}
+
+void ChunkPool::Release(uint8_t* chunk) {
+	std::lock_guard<std::mutex> lock(mutex_);
+	free_chunks_.push_back(chunk);
+}
+
+void ChunkPool::Trim() {
+	std::lock_guard<std::mutex> lock(mutex_);
+	constexpr size_t kChunksPerBlock = kChunkBlockSize / kChunkSize;
+
+	// Count the free chunks of every block, blocks and chunks sorted by address.
+	std::sort(blocks_.begin(), blocks_.end());
+	std::sort(free_chunks_.begin(), free_chunks_.end());
+	std::vector<size_t> free_counts(blocks_.size(), 0);
+	size_t block_index = 0;
+	for (uint8_t* chunk : free_chunks_) {
+		while (chunk >= blocks_[block_index] + kChunkBlockSize) {
+			++block_index;
+		}
+		++free_counts[block_index];
+	}
+
+	std::vector<uint8_t*> kept_blocks;
+	std::vector<uint8_t*> kept_chunks;
+	block_index = 0;
+	size_t chunk_index = 0;
+	for (; block_index < blocks_.size(); ++block_index) {
+		uint8_t* block = blocks_[block_index];
+		bool release = free_counts[block_index] == kChunksPerBlock;
+		for (; chunk_index < free_chunks_.size() && free_chunks_[chunk_index] < block + kChunkBlockSize;
+			 ++chunk_index) {
+			if (!release) {
+				kept_chunks.push_back(free_chunks_[chunk_index]);
+			}
+		}
+		if (release) {
+			FreeBlock(block);
+		} else {
+			kept_blocks.push_back(block);
+		}
+	}
+	blocks_ = std::move(kept_blocks);
+	free_chunks_ = std::move(kept_chunks);
+}
+
+void ChunkPool::SetUseHugePages(bool use_huge_pages) {
+	std::lock_guard<std::mutex> lock(mutex_);
+	use_huge_pages_ = use_huge_pages;
+}
+
+size_t ChunkPool::GetUsedChunkCount() {
+	std::lock_guard<std::mutex> lock(mutex_);
+	return blocks_.size() * (kChunkBlockSize / kChunkSize) - free_chunks_.size();
+}
+
+size_t ChunkPool::GetReservedBytes() {
+	std::lock_guard<std::mutex> lock(mutex_);
+	return blocks_.size() * kChunkBlockSize;
+}
+
+void ChunkPool::AllocateBlock() {
+	uint8_t* block = ReserveBlock(use_huge_pages_);
+	blocks_.push_back(block);
+	// Pushed in reverse so the chunks are handed out in address order.
+	for (size_t offset = kChunkBlockSize; offset > 0; offset -= kChunkSize) {
+		free_chunks_.push_back(block + offset - kChunkSize);
+	}
+}
+} // namespace core::ecs
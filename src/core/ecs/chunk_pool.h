@@ -0,0 +1,66 @@
+#ifndef CORE_CHUNK_POOL_H
+#define CORE_CHUNK_POOL_H
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+namespace core::ecs {
+
+// Size of the blocks the chunk pool requests from the operating system (2 MB, the size of a huge
+// page on x86-64).
+static constexpr size_t kChunkBlockSize = 2 << 20;
+
+// Alignment of the chunks handed out by the chunk pool (the page size).
+static constexpr size_t kChunkAlignment = 4096;
+
+// Pool of fixed-size, page-aligned memory chunks shared by all archetypes. Chunks are carved out
+// of large blocks and recycled through a free list, so archetypes that keep gaining and losing
+// entities do not go back to the allocator for every chunk.
+class ChunkPool {
+public:
+	static ChunkPool& GetInstance() {
+		static ChunkPool instance;
+		return instance;
+	}
+
+	~ChunkPool();
+	ChunkPool(const ChunkPool&) = delete;
+	ChunkPool& operator=(const ChunkPool&) = delete;
+
+	// Returns a chunk of kChunkSize bytes, aligned to kChunkAlignment. The contents are
+	// unspecified.
+	uint8_t* Allocate();
+	// Returns a chunk obtained from Allocate to the pool.
+	void Release(uint8_t* chunk);
+	// Gives the blocks whose chunks are all free back to the operating system.
+	void Trim();
+
+	// Requests huge pages for blocks allocated from now on. Falls back to regular pages when the
+	// system does not provide them.
+	void SetUseHugePages(bool use_huge_pages);
+
+	// Returns the number of chunks currently handed out.
+	size_t GetUsedChunkCount();
+	// Returns the number of bytes currently reserved from the operating system.
+	size_t GetReservedBytes();
+
+private:
+	ChunkPool() = default;
+
+	// Reserves a new block and adds its chunks to the free list.
+	void AllocateBlock();
+
+private:
+	// Start of every reserved block, kChunkBlockSize bytes each.
+	std::vector<uint8_t*> blocks_;
+	// Chunks that are ready to be handed out. Used as a stack so that recently released, likely
+	// cached, chunks are reused first.
+	std::vector<uint8_t*> free_chunks_;
+	bool use_huge_pages_ = false;
+	std::mutex mutex_;
+};
+} // namespace core::ecs
+
+#endif // CORE_CHUNK_POOL_H
@@ -0,0 +1,80 @@
+#include "command_buffer.h"
+
+#include <cstddef>
+#include <memory>
+#include <stdexcept>
+
+namespace core::ecs {
+
+namespace {
+
+// Size of the pages attribute values are allocated from (16 KB, the size of an archetype chunk,
+// so any attribute fits).
+constexpr size_t kDataPageSize = 16 << 10;
+} // namespace
+
+CommandBuffer::~CommandBuffer() {
+	Clear();
+}
+
+void CommandBuffer::RecordCreateEntity(EntityID entity) {
+	Record(entity, CommandType::kCreateEntity, 0, nullptr);
+}
+
+void CommandBuffer::RecordDestroyEntity(EntityID entity) {
+	Record(entity, CommandType::kDestroyEntity, 0, nullptr);
+}
+
+void CommandBuffer::RecordAddAttribute(EntityID entity, AttributeType attribute_type,
+									   const void* data, const AttributeInfo& info) {
+	uint8_t* value = AllocateData(info.size, info.alignment);
+	info.CopyConstruct(value, data);
+	if (!info.trivial) {
+		values_.emplace_back(&info, value);
+	}
+	Record(entity, CommandType::kAddAttribute, attribute_type, value);
+}
+
+void CommandBuffer::RecordRemoveAttribute(EntityID entity, AttributeType attribute_type) {
+	Record(entity, CommandType::kRemoveAttribute, attribute_type, nullptr);
+}
+
+void CommandBuffer::Clear() {
+	for (const auto& [info, value] : values_) {
+		info->Destroy(value);
+	}
+	values_.clear();
+	commands_.clear();
+	page_index_ = 0;
+	page_offset_ = 0;
+}
+
+void CommandBuffer::Record(EntityID entity, CommandType type, AttributeType attribute_type,
+						   const uint8_t* data) {
+	uint64_t sequence = sequence_.fetch_add(1, std::memory_order_relaxed);
+	commands_.push_back({sequence, entity, type, attribute_type, data});
+}
+
+uint8_t* CommandBuffer::AllocateData(size_t size, size_t alignment) {
+	if (size + alignment > kDataPageSize) {
+		throw std::runtime_error("Attribute value exceeds command buffer page size.");
+	}
+	// Aligns the address rather than the offset, as pages are only aligned for std::max_align_t.
+	auto align_offset = [&](size_t offset) {
+		uintptr_t address = reinterpret_cast<uintptr_t>(pages_[page_index_].get()) + offset;
+		return offset + ((alignment - address % alignment) % alignment);
+	};
+	size_t offset = pages_.empty() ? kDataPageSize : align_offset(page_offset_);
+	if (offset + size > kDataPageSize) {
+		if (!pages_.empty()) {
+			++page_index_;
+		}
+		if (page_index_ == pages_.size()) {
+			pages_.push_back(std::make_unique<uint8_t[]>(kDataPageSize));
+		}
+		offset = align_offset(0);
+	}
+	page_offset_ = offset + size;
+	return pages_[page_index_].get() + offset;
+}
+} // namespace core::ecs
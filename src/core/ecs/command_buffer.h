@@ -0,0 +1,89 @@
+#ifndef CORE_COMMAND_BUFFER_H
+#define CORE_COMMAND_BUFFER_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "types.h"
+
+namespace core::ecs {
+
+// Kind of structural change recorded in a CommandBuffer.
+enum class CommandType : uint8_t {
+	kCreateEntity,
+	kDestroyEntity,
+	kAddAttribute,
+	kRemoveAttribute
+};
+
+// Single structural change recorded in a CommandBuffer.
+struct Command {
+	// Global recording order, used to replay the commands of an entity in the order they were
+	// issued regardless of the buffer they were recorded in.
+	uint64_t sequence;
+	EntityID entity;
+	CommandType type;
+	// Attribute type added or removed. Unused for entity commands.
+	AttributeType attribute_type;
+	// Attribute value stored in the buffer. Only used by kAddAttribute.
+	const uint8_t* data;
+};
+
+// Records structural changes (entity creation and destruction, attribute addition and removal)
+// so that they can be applied later, in a batch, while no archetype is being iterated. Each
+// thread records into its own buffer; the ECSManager owns the buffers and plays them back at
+// sync points.
+class CommandBuffer {
+public:
+	// All buffers replayed together must share the same sequence counter.
+	explicit CommandBuffer(std::atomic<uint64_t>& sequence) : sequence_(sequence) {}
+	// Destroys the attribute values still held by the buffer.
+	~CommandBuffer();
+	CommandBuffer(const CommandBuffer&) = delete;
+	CommandBuffer& operator=(const CommandBuffer&) = delete;
+
+	// Records the creation of an entity whose ID was already allocated.
+	void RecordCreateEntity(EntityID entity);
+	// Records the destruction of an entity.
+	void RecordDestroyEntity(EntityID entity);
+	// Records adding an attribute to an entity. The attribute value is copy constructed into the
+	// buffer through its AttributeInfo.
+	void RecordAddAttribute(EntityID entity, AttributeType attribute_type, const void* data,
+							const AttributeInfo& info);
+	// Records removing an attribute from an entity.
+	void RecordRemoveAttribute(EntityID entity, AttributeType attribute_type);
+
+	// Returns the recorded commands, in recording order.
+	inline const std::vector<Command>& GetCommands() const { return commands_; }
+	// Returns the attribute value stored for a kAddAttribute command.
+	inline const uint8_t* GetData(const Command& command) const { return command.data; }
+	inline bool IsEmpty() const { return commands_.empty(); }
+	// Drops all the recorded commands and destroys their attribute values, keeping the allocated
+	// memory.
+	void Clear();
+
+private:
+	void Record(EntityID entity, CommandType type, AttributeType attribute_type,
+				const uint8_t* data);
+	// Returns uninitialized storage for an attribute value of the given size and alignment.
+	uint8_t* AllocateData(size_t size, size_t alignment);
+
+private:
+	std::atomic<uint64_t>& sequence_;
+	std::vector<Command> commands_;
+	// Pages holding the attribute values of the kAddAttribute commands. Values never move once
+	// constructed, as attributes are not necessarily trivially relocatable.
+	std::vector<std::unique_ptr<uint8_t[]>> pages_;
+	// Index of the page values are currently allocated from, and the first free byte in it.
+	size_t page_index_ = 0;
+	size_t page_offset_ = 0;
+	// Values that have to be destroyed when the buffer is cleared.
+	std::vector<std::pair<const AttributeInfo*, uint8_t*>> values_;
+};
+} // namespace core::ecs
+
+#endif // CORE_COMMAND_BUFFER_H
@@ -1,10 +1,34 @@
 #include "ecs_manager.h"
 
+#include <algorithm>
+#include <mutex>
 #include <stdexcept>
+#include <utility>
+#include <vector>
 
 namespace core::ecs {
 
+namespace {
+
+// Command buffer of the current thread. Owned by the ECSManager.
+thread_local CommandBuffer* thread_command_buffer = nullptr;
+} // namespace
+
 Entity ECSManager::CreateEntity() {
+	if (deferring_) {
+		CommandBuffer& command_buffer = GetCommandBuffer();
+		std::lock_guard<std::mutex> lock(command_mutex_);
+		// Other systems read the records of existing indices without the lock, so a recycled
+		// index cannot be rewritten now. Fresh records are published by IsAlive's acquire load;
+		// freed indices are reused by the creations after FlushCommands.
+		auto entity_result = entity_manager_.CreateFreshEntity();
+		if (!entity_result.has_value()) {
+			throw std::runtime_error("Failed to create entity: " + entity_result.error());
+		}
+		command_buffer.RecordCreateEntity(entity_result->id);
+		return entity_result.value();
+	}
+
 	auto entity_result = entity_manager_.CreateEntity();
 	if (!entity_result.has_value()) {
 		throw std::runtime_error("Failed to create entity: " + entity_result.error());
@@ -16,10 +40,218 @@ Entity ECSManager::CreateEntity() {
 	return entity_result.value();
 }
 
+std::vector<Entity> ECSManager::CreateEntities(size_t count,
+											   const ArchetypeSignature& signature) {
+	return SpawnEntities(count, signature).entities;
+}
+
+ECSManager::SpawnResult ECSManager::SpawnEntities(size_t count,
+												  const ArchetypeSignature& signature) {
+	if (deferring_) {
+		throw std::runtime_error("Batch entity creation is not available while systems run.");
+	}
+
+	auto entities_result = entity_manager_.CreateEntities(count);
+	if (!entities_result.has_value()) {
+		throw std::runtime_error("Failed to create entities: " + entities_result.error());
+	}
+
+	std::vector<EntityID> entity_ids;
+	entity_ids.reserve(count);
+	for (const Entity& entity : entities_result.value()) {
+		entity_ids.push_back(entity.id);
+		entity_manager_.SetEntitySignature(entity.id, signature);
+	}
+
+	auto [archetype, first_index] = archetype_manager_.AddEntities(entity_ids, signature);
+	event_manager_.RecordAttributeEvents(AttributeEvent::kAdd, signature, entity_ids.data(),
+										 entity_ids.size());
+	return {std::move(entities_result.value()), &archetype.get(), first_index};
+}
+
 void ECSManager::DestroyEntity(EntityID entity) {
+	if (deferring_) {
+		GetCommandBuffer().RecordDestroyEntity(entity);
+		return;
+	}
+
+	ArchetypeSignature signature = entity_manager_.GetEntitySignature(entity);
 	archetype_manager_.RemoveEntity(entity);
 	entity_manager_.DestroyEntity(entity);
 
-	// TODO: Might want to remove from systems as well.
+	event_manager_.RecordAttributeEvents(AttributeEvent::kRemove, signature, &entity, 1);
+}
+
+void ECSManager::StartSystems() {
+	deferring_ = true;
+	system_manager_.StartSystems(archetype_manager_);
+	deferring_ = false;
+	FlushCommands();
+	DispatchEvents();
+}
+
+void ECSManager::UpdateSystems(float delta_time) {
+	deferring_ = true;
+	system_manager_.UpdateSystems(delta_time, archetype_manager_, [this]() {
+		FlushCommands();
+		DispatchEvents();
+	});
+	deferring_ = false;
+}
+
+void ECSManager::DispatchEvents() {
+	// Observers and handlers run between phases, so their structural changes apply right away.
+	bool was_deferring = std::exchange(deferring_, false);
+	event_manager_.Dispatch();
+	deferring_ = was_deferring;
+}
+
+void ECSManager::CompactArchetypes() {
+	if (deferring_) {
+		throw std::runtime_error("Archetypes cannot be compacted while systems run.");
+	}
+	archetype_manager_.CompactArchetypes();
+}
+
+void ECSManager::FlushCommands() {
+	std::vector<PendingCommand> commands;
+	for (const auto& buffer : command_buffers_) {
+		for (const Command& command : buffer->GetCommands()) {
+			commands.push_back({&command, buffer.get()});
+		}
+	}
+	if (commands.empty()) {
+		return;
+	}
+
+	// Group the commands by entity, keeping the order in which they were issued.
+	std::sort(commands.begin(), commands.end(),
+			  [](const PendingCommand& a, const PendingCommand& b) {
+		if (a.command->entity != b.command->entity) {
+			return a.command->entity < b.command->entity;
+		}
+		return a.command->sequence < b.command->sequence;
+	});
+
+	bool was_deferring = std::exchange(deferring_, false);
+	SpawnBatch spawn_batch;
+	size_t begin = 0;
+	while (begin < commands.size()) {
+		size_t end = begin + 1;
+		EntityID entity = commands[begin].command->entity;
+		while (end < commands.size() && commands[end].command->entity == entity) {
+			++end;
+		}
+		ApplyEntityCommands(commands.data() + begin, end - begin, spawn_batch);
+		begin = end;
+	}
+
+	for (auto& [signature, entity_ids] : spawn_batch.groups) {
+		archetype_manager_.AddEntities(entity_ids, signature);
+		for (EntityID entity_id : entity_ids) {
+			entity_manager_.SetEntitySignature(entity_id, signature);
+		}
+		event_manager_.RecordAttributeEvents(AttributeEvent::kAdd, signature, entity_ids.data(),
+											 entity_ids.size());
+	}
+	for (const auto& [entity_id, attribute_type, data] : spawn_batch.values) {
+		archetype_manager_.SetAttribute(entity_id, attribute_type,
+										*reinterpret_cast<const IAttribute*>(data));
+	}
+
+	for (const auto& buffer : command_buffers_) {
+		buffer->Clear();
+	}
+	deferring_ = was_deferring;
+}
+
+void ECSManager::ApplyEntityCommands(const PendingCommand* commands, size_t count,
+									 SpawnBatch& spawn_batch) {
+	EntityID entity = commands[0].command->entity;
+	if (!entity_manager_.IsAlive(entity)) {
+		// Commands issued through a stale handle are dropped.
+		return;
+	}
+	ArchetypeSignature old_signature = entity_manager_.GetEntitySignature(entity);
+
+	// Fold the commands into the final signature and the values to write.
+	ArchetypeSignature signature = old_signature;
+	// Attributes of the entity that were removed at some point. Removed and then added again,
+	// they get kRemove and kAdd events, as they would outside of systems.
+	ArchetypeSignature removed;
+	std::vector<std::pair<AttributeType, const uint8_t*>> values;
+	bool created = false;
+	bool destroyed = false;
+	for (size_t i = 0; i < count && !destroyed; ++i) {
+		const Command& command = *commands[i].command;
+		switch (command.type) {
+			case CommandType::kCreateEntity:
+				created = true;
+				signature.reset();
+				removed.reset();
+				values.clear();
+				break;
+			case CommandType::kDestroyEntity:
+				destroyed = true;
+				break;
+			case CommandType::kAddAttribute:
+				// Same as AddAttribute, an attribute that is already present is left unchanged.
+				if (!signature.test(command.attribute_type)) {
+					signature.set(command.attribute_type);
+					values.emplace_back(command.attribute_type, commands[i].buffer->GetData(command));
+				}
+				break;
+			case CommandType::kRemoveAttribute:
+				if (signature.test(command.attribute_type)) {
+					removed.set(command.attribute_type);
+				}
+				signature.reset(command.attribute_type);
+				std::erase_if(values, [&command](const auto& value) {
+					return value.first == command.attribute_type;
+				});
+				break;
+		}
+	}
+
+	if (destroyed) {
+		// Entities created in this batch were never placed in an archetype.
+		if (!created) {
+			archetype_manager_.RemoveEntity(entity);
+			event_manager_.RecordAttributeEvents(AttributeEvent::kRemove, old_signature, &entity,
+												 1);
+		}
+		entity_manager_.DestroyEntity(entity);
+		return;
+	}
+	if (created) {
+		spawn_batch.groups[signature].push_back(entity);
+		for (const auto& [attribute_type, data] : values) {
+			spawn_batch.values.emplace_back(entity, attribute_type, data);
+		}
+		return;
+	}
+
+	// Existing entities move straight to their final archetype.
+	if (signature != old_signature) {
+		archetype_manager_.UpdateEntityArchetype(entity, old_signature, signature);
+		entity_manager_.SetEntitySignature(entity, signature);
+	}
+	event_manager_.RecordAttributeEvents(AttributeEvent::kAdd,
+										 signature & (~old_signature | removed), &entity, 1);
+	event_manager_.RecordAttributeEvents(AttributeEvent::kRemove,
+										 old_signature & (~signature | removed), &entity, 1);
+	for (const auto& [attribute_type, data] : values) {
+		archetype_manager_.SetAttribute(entity, attribute_type,
+										*reinterpret_cast<const IAttribute*>(data));
+	}
+}
+
+CommandBuffer& ECSManager::GetCommandBuffer() {
+	if (thread_command_buffer == nullptr) {
+		std::lock_guard<std::mutex> lock(command_mutex_);
+		command_buffers_.push_back(std::make_unique<CommandBuffer>(command_sequence_));
+		thread_command_buffer = command_buffers_.back().get();
+	}
+	return *thread_command_buffer;
 }
 } // namespace core::ecs
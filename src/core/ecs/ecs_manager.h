@@ -1,13 +1,27 @@
 #ifndef CORE_ECS_MANAGER_H
 #define CORE_ECS_MANAGER_H
 
+#include <array>
+#include <atomic>
+#include <concepts>
 #include <cstddef>
-#include <typeindex>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <type_traits>
 #include <unordered_map>
+#include <utility>
+#include <vector>
 
 #include "archetype_manager.h"
+#include "command_buffer.h"
 #include "entity.h"
 #include "entity_manager.h"
+#include "event_manager.h"
+#include "query.h"
 #include "system.h"
 #include "system_manager.h"
 #include "types.h"
@@ -17,6 +31,11 @@ namespace core::ecs {
 // TODO: This should be the only interaction point for ECS operations. Therefore, the other managers
 // should have their methods private and be friends with this class.
 
+// While systems run, structural changes (creating and destroying entities, adding and removing
+// attributes) are recorded into per-thread command buffers instead of being applied, so that the
+// archetypes being iterated stay untouched. The changes are played back at the end of every
+// system phase, or when FlushCommands is called. Attribute events and typed events are dispatched
+// right after, see DispatchEvents.
 class ECSManager {
 public:
 	static ECSManager& GetInstance() {
@@ -24,41 +43,126 @@ public:
 		return instance;
 	}
 
-	// Create a new entity and return it.
+	// Create a new entity and return it. While deferring, the entity gets its ID right away but is
+	// only added to the world when the commands are flushed. The ID then always has a fresh index,
+	// as recycling one would rewrite a record other systems may be reading.
 	Entity CreateEntity();
+	// Create count new entities with the given signature directly in their final archetype.
+	// The attributes of the new entities are default constructed.
+	// Batch creation is not available while deferring.
+	std::vector<Entity> CreateEntities(size_t count, const ArchetypeSignature& signature);
+	// Create count new entities with the attributes Ts, each initialized to a copy of values.
+	template <typename... Ts>
+		requires (sizeof...(Ts) > 0 && (std::is_base_of_v<IAttribute, Ts> && ...))
+	std::vector<Entity> CreateEntities(size_t count, const Ts&... values) {
+		SpawnResult spawn = SpawnEntities(count, Signature<Ts...>());
+		ForEachSpawned<Ts...>(spawn, [&](size_t, Ts*... attributes) {
+			((*attributes = values), ...);
+		}, std::index_sequence_for<Ts...>{});
+		return std::move(spawn.entities);
+	}
+	// Create count new entities with the attributes Ts. Each attribute starts as a default
+	// constructed value, after which initializer(const Entity&, size_t index, Ts&...) is called
+	// once per entity to fill it in.
+	template <typename... Ts, typename Func>
+		requires (sizeof...(Ts) > 0 && (std::is_base_of_v<IAttribute, Ts> && ...) &&
+				  std::invocable<Func&, const Entity&, size_t, Ts&...>)
+	std::vector<Entity> CreateEntities(size_t count, Func&& initializer) {
+		SpawnResult spawn = SpawnEntities(count, Signature<Ts...>());
+		ForEachSpawned<Ts...>(spawn, [&](size_t index, Ts*... attributes) {
+			initializer(spawn.entities[index], index, *attributes...);
+		}, std::index_sequence_for<Ts...>{});
+		return std::move(spawn.entities);
+	}
 	// Destroy an entity.
 	void DestroyEntity(EntityID entity);
+	// Checks if the handle refers to a live entity. Handles of destroyed entities are never alive
+	// again, even once their index is reused: indices are retired before their generation wraps.
+	inline bool IsAlive(EntityID entity) const {
+		return entity_manager_.IsAlive(entity);
+	}
 
-	// Registers a system of type T with the given archetype signature.
+	// Registers a system of type T with the given archetype signature, running in the given phase.
 	// T must be derived from System.
 	template <typename T, typename = std::enable_if_t<std::is_base_of_v<System, T>>>
-	void RegisterSystem(ArchetypeSignature& signature) {
-		system_manager_.RegisterSystem<T>(signature);
+	void RegisterSystem(const ArchetypeSignature& signature,
+						SystemPhase phase = SystemPhase::kUpdate) {
+		system_manager_.RegisterSystem<T>(signature, phase);
 	}
-	// Calls the Start function for all registered systems.
-	void StartSystems() {
-		system_manager_.StartSystems();
+	// Requires system First to run before system Second within their phase.
+	template <typename First, typename Second>
+	void SetSystemOrder() {
+		system_manager_.SetSystemOrder<First, Second>();
 	}
+	// Calls the Start function for all registered systems.
+	void StartSystems();
 	// Updates all registered systems.
-	void UpdateSystems(float delta_time) {
-		system_manager_.UpdateSystems(delta_time);
+	void UpdateSystems(float delta_time);
+
+	// Applies the structural changes recorded while deferring. Commands are sorted by entity so
+	// that every entity moves to its final archetype at most once, and new entities are spawned
+	// in one batch per archetype. Must not be called while systems are running.
+	void FlushCommands();
+	// Destroys the archetypes left without entities and releases their memory. Must not be called
+	// while systems are running.
+	void CompactArchetypes();
+
+	// Writes the whole world to a snapshot file: the schema of the attribute types in use, the
+	// entity table and the chunks of every archetype holding entities. See world_snapshot.h for
+	// the format. Throws an exception if an attribute type is not trivially copyable or the file
+	// cannot be written. Must not be called while systems are running.
+	void SaveWorld(const std::string& path);
+	// Loads a snapshot written by SaveWorld into an empty world. Entities keep their IDs, so
+	// handles stored in attributes stay valid, and kAdd observers are notified at the next
+	// dispatch. The saved attribute types are matched against the registered ones by the name
+	// given to RegisterAttribute.
+	// Throws an exception if the world has entities, the file is not a valid snapshot, or one of
+	// its attribute types is not registered or changed its size or alignment. Must not be called
+	// while systems are running.
+	void LoadWorld(const std::string& path);
+	// Checks if structural changes are currently recorded instead of applied.
+	inline bool IsDeferring() const { return deferring_; }
+
+	// Registers an observer of the event for the attribute type T. Observers are called in
+	// batches at the end of every system phase, or when DispatchEvents is called, with the
+	// entities the event happened to.
+	template <typename T, typename = std::enable_if_t<std::is_base_of_v<IAttribute, T>>>
+	void Observe(AttributeEvent event, AttributeObserver observer) {
+		event_manager_.Observe(event, GetAttributeType<T>(), std::move(observer));
+	}
+	// Registers a handler of the events of type E.
+	template <typename E>
+	void Subscribe(EventHandler<E> handler) {
+		event_manager_.Subscribe<E>(std::move(handler));
 	}
+	// Queues an event of type E, to be handed to its handlers at the next dispatch. Can be called
+	// from systems.
+	template <typename E>
+	void Emit(const E& event) {
+		event_manager_.Emit(event);
+	}
+	// Hands the queued events to their observers and handlers. Structural changes made by them
+	// are applied right away, and the events they cause are dispatched in the same call. Must not
+	// be called while systems are running.
+	void DispatchEvents();
 
-	// Registers an attribute type T with its size. This must be called before using the attribute
-	// in any entity.
+	// Registers an attribute type T with its operations. This must be called before using the
+	// attribute in any entity. The name identifies T in saved worlds: it must be unique, and stay
+	// the same across builds and toolchains for their snapshots to load.
 	template <typename T, typename = std::enable_if_t<std::is_base_of_v<IAttribute, T>>>
-	void RegisterAttribute() {
-		std::type_index type(typeid(T));
-        if (component_types_.find(type) == component_types_.end()) {
-			archetype_manager_.RegisterAttributeType(next_attribute_type_, sizeof(T));
-            component_types_[type] = next_attribute_type_++;
-        }
+	void RegisterAttribute(const std::string& name) {
+		archetype_manager_.RegisterAttributeType(GetAttributeType<T>(), GetAttributeInfo<T>(),
+												 name);
 	}
 	// Adds an attribute of type T to the specified entity.
 	// If attribute of that type already exists, it returns without changes.
 	template <typename T, typename = std::enable_if_t<std::is_base_of_v<IAttribute, T>>>
 	void AddAttribute(EntityID entity, T& attribute) {
 		AttributeType type = GetAttributeType<T>();
+		if (deferring_) {
+			GetCommandBuffer().RecordAddAttribute(entity, type, &attribute, GetAttributeInfo<T>());
+			return;
+		}
 
 		ArchetypeSignature old_signature = entity_manager_.GetEntitySignature(entity);
 		if (old_signature.test(type)) {
@@ -68,19 +172,23 @@ public:
 		new_signature.set(type);
 
 		// Update archetype
-		archetype_manager_.UpdateEntityArchetype(entity, old_signature, new_signature);
+		archetype_manager_.AddEntityAttribute(entity, type);
 		entity_manager_.SetEntitySignature(entity, new_signature);
 
 		// Set attribute data
 		archetype_manager_.SetAttribute(entity, type, attribute);
 
-		// TODO: Might want to update systems as well.
+		event_manager_.RecordAttributeEvent(AttributeEvent::kAdd, type, entity);
 	}
 	// Removes an attribute of type T from the specified entity.
 	// If attribute of that type does not exist, it returns without changes.
 	template <typename T, typename = std::enable_if_t<std::is_base_of_v<IAttribute, T>>>
 	void RemoveAttribute(EntityID entity) {
 		AttributeType type = GetAttributeType<T>();
+		if (deferring_) {
+			GetCommandBuffer().RecordRemoveAttribute(entity, type);
+			return;
+		}
 
 		ArchetypeSignature old_signature = entity_manager_.GetEntitySignature(entity);
 		if (!old_signature.test(type)) {
@@ -90,30 +198,93 @@ public:
 		new_signature.reset(type);
 
 		// Update archetype
-		archetype_manager_.UpdateEntityArchetype(entity.id, old_signature, new_signature);
+		archetype_manager_.RemoveEntityAttribute(entity, type);
 		entity_manager_.SetEntitySignature(entity, new_signature);
 
-		// TODO: Might want to update systems as well.
+		event_manager_.RecordAttributeEvent(AttributeEvent::kRemove, type, entity);
 	}
 	// Retrieves the attribute of type T for the specified entity.
-	// Throws an exception if the attribute does not exist.
+	// Throws an exception if the attribute does not exist. Changes that are still deferred are
+	// not visible. T may be const-qualified for read-only access; otherwise the attribute is
+	// marked as changed.
 	template <typename T, typename = std::enable_if_t<std::is_base_of_v<IAttribute, T>>>
 	T& GetAttribute(EntityID entity) {
-		AttributeType type = GetAttributeType<T>();
-		auto attribute_opt = archetype_manager_.GetAttribute(entity, type);
-		if (!attribute_opt.has_value()) {
+		AttributeType type = GetAttributeType<std::remove_const_t<T>>();
+		std::conditional_t<std::is_const_v<T>, const IAttribute, IAttribute>* attribute;
+		if constexpr (std::is_const_v<T>) {
+			attribute = archetype_manager_.FindAttribute(entity, type);
+		} else {
+			attribute = archetype_manager_.GetAttribute(entity, type);
+		}
+		if (attribute == nullptr) {
 			throw std::runtime_error("Attribute not found for entity.");
 		}
-		return static_cast<T&>(attribute_opt->get());
+		return static_cast<T&>(*attribute);
+	}
+	// Writes the attribute of type T of the specified entity and notifies its kSet observers.
+	// Not a structural change, so it is applied right away even while deferring. Throws an
+	// exception if the attribute does not exist.
+	template <typename T, typename = std::enable_if_t<std::is_base_of_v<IAttribute, T>>>
+	void SetAttribute(EntityID entity, const T& attribute) {
+		AttributeType type = GetAttributeType<T>();
+		archetype_manager_.SetAttribute(entity, type, attribute);
+		event_manager_.RecordAttributeEvent(AttributeEvent::kSet, type, entity);
 	}
 	// Checks if the specified entity has an attribute of type T.
 	template <typename T, typename = std::enable_if_t<std::is_base_of_v<IAttribute, T>>>
 	bool HasAttribute(EntityID entity) {
 		AttributeType type = GetAttributeType<T>();
+		if (!entity_manager_.IsAlive(entity)) {
+			return false;
+		}
 		ArchetypeSignature signature = entity_manager_.GetEntitySignature(entity);
 		return signature.test(type);
 	}
 
+	// Returns a query over all archetypes containing the attribute types Ts. Ts may be
+	// const-qualified for read-only access or wrapped in Optional. Use Query::Where to skip
+	// unchanged chunks and Query::Without to exclude attribute types.
+	template <typename... Ts>
+	Query<Ts...> GetQuery() {
+		return Query<Ts...>();
+	}
+	// Calls func(EntityID, Ts&...) for every entity that has all the attribute types Ts.
+	template <typename... Ts, typename Func>
+	void ForEach(Func&& func) {
+		ForEach(GetQuery<Ts...>(), std::forward<Func>(func));
+	}
+	// Calls func(EntityID, Ts&...) for every entity matched by the query. The matching archetypes
+	// come from the query cache of the archetype manager, so repeated ad-hoc queries cost a hash
+	// lookup instead of a scan over all archetypes.
+	template <typename... Ts, typename Func>
+	void ForEach(const Query<Ts...>& query, Func&& func) {
+		const std::vector<Archetype*>& archetypes = archetype_manager_.QueryArchetypes(
+				query.GetTerms());
+		// Indexed, as func may create archetypes which get appended to the cached vector.
+		for (size_t i = 0; i < archetypes.size(); ++i) {
+			query.ForEach(*archetypes[i], func);
+		}
+	}
+	// Calls func(EntityID, Ts&...) for every entity matched by the query, with the chunks of all
+	// matching archetypes split into jobs of grain_size chunks. func must be safe to call
+	// concurrently. Structural changes it makes are recorded and applied once all jobs are done,
+	// or at the next sync point when called from a system.
+	template <typename... Ts, typename Func>
+	void ForEachParallel(const Query<Ts...>& query, Func&& func, size_t grain_size = 1) {
+		const std::vector<Archetype*>& archetypes = archetype_manager_.QueryArchetypes(
+				query.GetTerms());
+		// Systems running on workers read deferring_ concurrently, so leave it alone when already
+		// deferring.
+		if (deferring_) {
+			query.ForEachParallel(std::span<Archetype* const>(archetypes), func, grain_size);
+			return;
+		}
+		deferring_ = true;
+		query.ForEachParallel(std::span<Archetype* const>(archetypes), func, grain_size);
+		deferring_ = false;
+		FlushCommands();
+	}
+
 	inline ArchetypeManager& GetArchetypeManager() {
 		return archetype_manager_;
 	}
@@ -123,30 +294,72 @@ public:
 	inline SystemManager& GetSystemManager() {
 		return system_manager_;
 	}
+	inline EventManager& GetEventManager() {
+		return event_manager_;
+	}
 
 private:
 	ECSManager() = default;
 
+	// Result of spawning a batch of entities: the entities, their archetype and the index of the
+	// first one within the archetype.
+	struct SpawnResult {
+		std::vector<Entity> entities;
+		Archetype* archetype;
+		size_t first_index;
+	};
+	// Creates count entities with the given signature directly in their final archetype.
+	SpawnResult SpawnEntities(size_t count, const ArchetypeSignature& signature);
+
+	// Calls func(size_t index, Ts*...) with the attribute slots of every spawned entity. The
+	// entities are consecutive in their archetype, so their data is reached directly.
+	template <typename... Ts, typename Func, size_t... Is>
+	void ForEachSpawned(const SpawnResult& spawn, Func&& func, std::index_sequence<Is...>) {
+		Archetype& archetype = *spawn.archetype;
+		std::array<size_t, sizeof...(Ts)> columns{archetype.GetColumnIndex(GetAttributeType<Ts>())...};
+		for (size_t i = 0; i < spawn.entities.size(); ++i) {
+			func(i, reinterpret_cast<Ts*>(archetype.GetAttributeData(spawn.first_index + i,
+																	 columns[Is]))...);
+		}
+	}
+
+	// Returns the command buffer of the calling thread, creating it on first use.
+	CommandBuffer& GetCommandBuffer();
+	// Command recorded in one of the command buffers, along with the buffer holding its data.
+	struct PendingCommand {
+		const Command* command;
+		const CommandBuffer* buffer;
+	};
+	// Entities created while deferring, grouped by their final signature, and their attribute
+	// values. Spawned in one batch per archetype at the end of a flush.
+	struct SpawnBatch {
+		std::unordered_map<ArchetypeSignature, std::vector<EntityID>> groups;
+		std::vector<std::tuple<EntityID, AttributeType, const uint8_t*>> values;
+	};
+	// Applies the commands of a single entity, sorted by sequence. Created entities are added to
+	// spawn_batch instead of being placed right away.
+	void ApplyEntityCommands(const PendingCommand* commands, size_t count, SpawnBatch& spawn_batch);
+
 	// Retrieves the AttributeType for a given attribute class T.
 	template <typename T, typename = std::enable_if_t<std::is_base_of_v<IAttribute, T>>>
-	AttributeType GetAttributeType() {
-		auto it = component_types_.find(typeid(T));
-		if (it == component_types_.end()) {
-			throw std::runtime_error("Attribute type not registered.");
-		}
-		return it->second;
+	inline AttributeType GetAttributeType() const {
+		return GetAttributeTypeId<T>();
 	}
 
 private:
 	ArchetypeManager archetype_manager_;
 	EntityManager entity_manager_;
 	SystemManager system_manager_;
+	EventManager event_manager_;
 
-	// Maps C++ type indices to AttributeType identifiers.
-	std::unordered_map<std::type_index, AttributeType> component_types_;
-
-	// Next available AttributeType identifier.
-	AttributeType next_attribute_type_ = 0;
+	// Set while systems run. Structural changes are recorded instead of applied.
+	bool deferring_ = false;
+	// Command buffers of all the threads that recorded changes.
+	std::vector<std::unique_ptr<CommandBuffer>> command_buffers_;
+	// Guards command_buffers_ and the entity manager while deferring.
+	std::mutex command_mutex_;
+	// Shared sequence counter of the command buffers.
+	std::atomic<uint64_t> command_sequence_ = 0;
 };
 } // namespace core::ecs
 
@@ -1,29 +1,106 @@
 #include "entity_manager.h"
 
 #include <expected>
-#include <limits>
+#include <memory>
+#include <span>
+#include <stdexcept>
 #include <string>
+#include <vector>
 
 #include "types.h"
 
 namespace core::ecs {
 
-EntityManager::EntityManager() {
-	for (EntityID id = 0; id < std::numeric_limits<EntityID>::max(); ++id) {
-		available_entities_.push(Entity(id));
+std::expected<Entity, std::string> EntityManager::CreateEntity() {
+	if (free_count_ == 0 && record_count_.load(std::memory_order_relaxed) >= kMaxEntities) {
+		return std::unexpected("No more available entity IDs.");
 	}
+	return AllocateEntity();
 }
 
-std::expected<Entity, std::string> EntityManager::CreateEntity() {
-	if (available_entities_.empty()) {
+std::expected<Entity, std::string> EntityManager::CreateFreshEntity() {
+	if (record_count_.load(std::memory_order_relaxed) >= kMaxEntities) {
+		return std::unexpected("No more available entity IDs.");
+	}
+	return AllocateFreshEntity();
+}
+
+std::expected<std::vector<Entity>, std::string> EntityManager::CreateEntities(size_t count) {
+	size_t available = free_count_ + (kMaxEntities - record_count_.load(std::memory_order_relaxed));
+	if (available < count) {
 		return std::unexpected("No more available entity IDs.");
 	}
-	Entity entity = available_entities_.front();
-	available_entities_.pop();
-	return entity;
+	std::vector<Entity> entities;
+	entities.reserve(count);
+	for (size_t i = 0; i < count; ++i) {
+		entities.push_back(AllocateEntity());
+	}
+	return entities;
 }
 
 void EntityManager::DestroyEntity(EntityID entity) {
-	available_entities_.push(Entity(entity));
+	assert(IsAlive(entity) && "Entity is not alive");
+	uint32_t index = ToEntityIndex(entity);
+	EntityRecord& record = GetRecord(index);
+	// Recycled IDs start without attributes.
+	record.signature.reset();
+	uint32_t generation = ToEntityGeneration(entity);
+	if (generation == kEntityGenerationMask) {
+		// The next generation would wrap to 0 and revive the first handles of this index.
+		record.entity = kNullEntity;
+		return;
+	}
+	record.entity = MakeEntityID(free_head_, generation + 1);
+	free_head_ = index;
+	++free_count_;
+}
+
+void EntityManager::Restore(std::span<const EntityID> record_entities, uint32_t free_head,
+							size_t free_count) {
+	if (record_count_.load(std::memory_order_relaxed) != 0) {
+		throw std::runtime_error("Entities can only be restored into an empty entity manager.");
+	}
+	if (record_entities.size() > kMaxEntities || free_count > record_entities.size() ||
+		(free_count > 0 && free_head >= record_entities.size())) {
+		throw std::runtime_error("Invalid entity table.");
+	}
+	for (uint32_t index = 0; index < record_entities.size(); ++index) {
+		std::unique_ptr<EntityRecord[]>& page = pages_[index / kEntityPageSize];
+		if (!page) {
+			page = std::make_unique<EntityRecord[]>(kEntityPageSize);
+		}
+		EntityRecord& record = GetRecord(index);
+		record.entity = record_entities[index];
+		record.signature.reset();
+	}
+	free_head_ = free_head;
+	free_count_ = free_count;
+	record_count_.store(static_cast<uint32_t>(record_entities.size()), std::memory_order_release);
+}
+
+Entity EntityManager::AllocateEntity() {
+	if (free_count_ > 0) {
+		uint32_t index = free_head_;
+		EntityRecord& record = GetRecord(index);
+		free_head_ = ToEntityIndex(record.entity);
+		--free_count_;
+		record.entity = MakeEntityID(index, ToEntityGeneration(record.entity));
+		return Entity(record.entity);
+	}
+	return AllocateFreshEntity();
+}
+
+Entity EntityManager::AllocateFreshEntity() {
+	uint32_t index = record_count_.load(std::memory_order_relaxed);
+	std::unique_ptr<EntityRecord[]>& page = pages_[index / kEntityPageSize];
+	if (!page) {
+		page = std::make_unique<EntityRecord[]>(kEntityPageSize);
+	}
+	EntityRecord& record = GetRecord(index);
+	record.entity = MakeEntityID(index, 0);
+	record.signature.reset();
+	// Publish the record only once it is initialized.
+	record_count_.store(index + 1, std::memory_order_release);
+	return Entity(record.entity);
 }
 } // namespace core::ecs
@@ -2,42 +2,107 @@
 #define CORE_ENTITY_MANAGER_H
 
 #include <array>
+#include <atomic>
 #include <cassert>
+#include <cstdint>
 #include <expected>
-#include <queue>
+#include <memory>
+#include <span>
 #include <string>
+#include <vector>
 
 #include "entity.h"
 #include "types.h"
 
 namespace core::ecs {
 
-constexpr size_t kMaxEntities = 1 << 16;
+// Maximum number of entities alive at the same time. The last index is reserved for kNullEntity.
+constexpr size_t kMaxEntities = kEntityIndexMask;
+// Number of entity records allocated at once.
+constexpr size_t kEntityPageSize = 4096;
 
-// Manages entity creation and recycling.
+// Manages entity creation and recycling. Destroyed indices are kept in a free list threaded
+// through the entity records themselves, and are reused with a bumped generation. An index whose
+// generation is exhausted is retired instead of being reused, so that a stale handle never
+// matches a later entity.
 class EntityManager {
 public:
-	explicit EntityManager();
+	explicit EntityManager() = default;
 
 	// Create a new entity and return its ID.
 	std::expected<Entity, std::string> CreateEntity();
-	// Destroy an entity, making its ID available for reuse.
+	// Create a new entity with an index that was never handed out, leaving the free list alone.
+	// Only initializes a record that is not published yet, so it is safe while other threads read
+	// records, e.g. through IsAlive.
+	std::expected<Entity, std::string> CreateFreshEntity();
+	// Create count new entities at once. Fails without creating any entity if there are not
+	// enough available IDs.
+	std::expected<std::vector<Entity>, std::string> CreateEntities(size_t count);
+	// Destroy an entity, making its index available for reuse unless its generation is exhausted.
+	// Handles to the entity become stale for good.
 	void DestroyEntity(EntityID entity);
 
+	// Checks if the handle refers to a live entity. Stale handles fail the check even after their
+	// index was reused, however many times.
+	inline bool IsAlive(EntityID entity) const {
+		uint32_t index = ToEntityIndex(entity);
+		return index < record_count_.load(std::memory_order_acquire) &&
+			   GetRecord(index).entity == entity;
+	}
+
 	inline ArchetypeSignature GetEntitySignature(EntityID entity) const {
-		assert(entity < kMaxEntities && "Entity ID out of bounds");
-		return signatures_[entity];
+		assert(IsAlive(entity) && "Entity is not alive");
+		return GetRecord(ToEntityIndex(entity)).signature;
 	}
 	inline void SetEntitySignature(EntityID entity, const ArchetypeSignature& signature) {
-		assert(entity < kMaxEntities && "Entity ID out of bounds");
-		signatures_[entity] = signature;
+		assert(IsAlive(entity) && "Entity is not alive");
+		GetRecord(ToEntityIndex(entity)).signature = signature;
+	}
+
+	// Returns the number of indices handed out so far, free or not.
+	inline uint32_t GetRecordCount() const { return record_count_.load(std::memory_order_acquire); }
+	// Returns the handle stored in the record at the given index: the live entity, the free list
+	// link for free indices, or kNullEntity for retired indices. Together with the free list head
+	// and length, the handles of all records describe the whole entity table.
+	inline EntityID GetRecordEntity(uint32_t index) const { return GetRecord(index).entity; }
+	inline uint32_t GetFreeHead() const { return free_head_; }
+	inline size_t GetFreeCount() const { return free_count_; }
+	// Replaces the entity table of an empty manager with the given record handles and free list, as
+	// returned by GetRecordEntity, GetFreeHead and GetFreeCount. Live entities keep their handles
+	// and start without attributes.
+	void Restore(std::span<const EntityID> record_entities, uint32_t free_head, size_t free_count);
+
+private:
+	struct EntityRecord {
+		// Handle of the entity owning this index. For free indices, the index bits link to the
+		// next free index and the generation bits hold the generation of the next handle. Retired
+		// indices hold kNullEntity.
+		EntityID entity;
+		// Attributes of the entity.
+		ArchetypeSignature signature;
+	};
+
+	inline EntityRecord& GetRecord(uint32_t index) {
+		return pages_[index / kEntityPageSize][index % kEntityPageSize];
+	}
+	inline const EntityRecord& GetRecord(uint32_t index) const {
+		return pages_[index / kEntityPageSize][index % kEntityPageSize];
 	}
+	// Takes an index off the free list, or a fresh one if the list is empty.
+	Entity AllocateEntity();
+	// Initializes and publishes the record of the next fresh index.
+	Entity AllocateFreshEntity();
 
 private:
-	// Queue to hold available entity IDs
-	std::queue<Entity> available_entities_;
-	// Array of signatures (one per entity)
-    std::array<ArchetypeSignature, kMaxEntities> signatures_;
+	// Entity records, allocated a page at a time as the number of entities grows. Pages never
+	// move, so records can be read from other threads while entities are being created.
+	std::array<std::unique_ptr<EntityRecord[]>, kMaxEntities / kEntityPageSize + 1> pages_;
+	// Number of indices handed out so far, free or not.
+	std::atomic<uint32_t> record_count_ = 0;
+	// First index of the free list, or kEntityIndexMask if the list is empty.
+	uint32_t free_head_ = kEntityIndexMask;
+	// Number of indices in the free list.
+	size_t free_count_ = 0;
 };
 } // namespace core::ecs
 
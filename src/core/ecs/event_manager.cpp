@@ -0,0 +1,78 @@
+#include "event_manager.h"
+
+#include <mutex>
+#include <span>
+#include <utility>
+#include <vector>
+
+namespace core::ecs {
+
+void EventManager::Observe(AttributeEvent event, AttributeType attribute_type,
+						   AttributeObserver observer) {
+	size_t event_index = static_cast<size_t>(event);
+	observers_[event_index][attribute_type].push_back(std::move(observer));
+	observed_[event_index].set(attribute_type);
+}
+
+void EventManager::RecordAttributeEvents(AttributeEvent event,
+										 const ArchetypeSignature& attribute_types,
+										 const EntityID* entities, size_t count) {
+	size_t event_index = static_cast<size_t>(event);
+	ArchetypeSignature observed = attribute_types & observed_[event_index];
+	if (observed.none() || count == 0) {
+		return;
+	}
+	std::lock_guard<std::mutex> lock(mutex_);
+	for (AttributeType type = 0; type < kMaxAttributes; ++type) {
+		if (observed.test(type)) {
+			std::vector<EntityID>& pending = pending_entities_[event_index][type];
+			pending.insert(pending.end(), entities, entities + count);
+		}
+	}
+}
+
+void EventManager::Dispatch() {
+	bool dispatched = true;
+	while (dispatched) {
+		dispatched = DispatchAttributeEvents();
+		// Indexed, as handlers may emit event types seen for the first time.
+		for (size_t type = 0;; ++type) {
+			IEventChannel* channel;
+			{
+				std::lock_guard<std::mutex> lock(mutex_);
+				if (type >= channels_.size()) {
+					break;
+				}
+				channel = channels_[type].get();
+			}
+			if (channel != nullptr && channel->Dispatch(mutex_)) {
+				dispatched = true;
+			}
+		}
+	}
+}
+
+bool EventManager::DispatchAttributeEvents() {
+	bool dispatched = false;
+	for (size_t event_index = 0; event_index < kAttributeEventCount; ++event_index) {
+		for (AttributeType type = 0; type < kMaxAttributes; ++type) {
+			if (!observed_[event_index].test(type)) {
+				continue;
+			}
+			{
+				std::lock_guard<std::mutex> lock(mutex_);
+				std::swap(pending_entities_[event_index][type], dispatching_entities_);
+			}
+			if (dispatching_entities_.empty()) {
+				continue;
+			}
+			for (const AttributeObserver& observer : observers_[event_index][type]) {
+				observer(std::span<const EntityID>(dispatching_entities_));
+			}
+			dispatching_entities_.clear();
+			dispatched = true;
+		}
+	}
+	return dispatched;
+}
+} // namespace core::ecs
@@ -0,0 +1,166 @@
+#ifndef CORE_EVENT_MANAGER_H
+#define CORE_EVENT_MANAGER_H
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <utility>
+#include <vector>
+
+#include "types.h"
+
+namespace core::ecs {
+
+// Attribute lifecycle events that can be observed per attribute type.
+enum class AttributeEvent : uint8_t {
+	// The attribute was added to an entity, including entities created with it.
+	kAdd,
+	// The attribute value was written through ECSManager::SetAttribute.
+	kSet,
+	// The attribute was removed from an entity, including entities destroyed with it. The
+	// attribute is gone by the time observers run.
+	kRemove
+};
+static constexpr size_t kAttributeEventCount = 3;
+
+// Observer of an attribute event. Receives every entity the event happened to since the last
+// dispatch, in the order the events were recorded.
+using AttributeObserver = std::function<void(std::span<const EntityID>)>;
+// Handler of a typed event. Receives every event of type E emitted since the last dispatch, in
+// the order they were emitted.
+template <typename E>
+using EventHandler = std::function<void(std::span<const E>)>;
+
+// Unique identifier of an event type.
+using EventType = uint32_t;
+
+namespace internal {
+// Hands out the next unused EventType identifier.
+inline EventType NextEventTypeId() {
+	static std::atomic<EventType> next_event_type{0};
+	return next_event_type.fetch_add(1, std::memory_order_relaxed);
+}
+} // namespace internal
+
+// Returns the EventType identifier of the event class E. Assigned once per type, on first use.
+template <typename E>
+inline EventType GetEventTypeId() {
+	static const EventType event_type = internal::NextEventTypeId();
+	return event_type;
+}
+
+// Queues attribute events and typed events, and hands them to their observers and handlers in
+// batches. Events of one kind are stored contiguously, so a dispatch costs one call per observer
+// or handler and batch rather than one per event. Events can be recorded from any thread;
+// dispatching happens at sync points, see ECSManager::DispatchEvents.
+class EventManager {
+public:
+	explicit EventManager() = default;
+	EventManager(const EventManager&) = delete;
+	EventManager& operator=(const EventManager&) = delete;
+
+	// Registers an observer of the event for the attribute type. Must not be called while
+	// dispatching.
+	void Observe(AttributeEvent event, AttributeType attribute_type, AttributeObserver observer);
+	// Records the event for count entities and every observed attribute type of attribute_types.
+	// Unobserved attribute types are skipped without locking.
+	void RecordAttributeEvents(AttributeEvent event, const ArchetypeSignature& attribute_types,
+							   const EntityID* entities, size_t count);
+	// Records the event for a single entity and attribute type.
+	inline void RecordAttributeEvent(AttributeEvent event, AttributeType attribute_type,
+									 EntityID entity) {
+		ArchetypeSignature attribute_types;
+		attribute_types.set(attribute_type);
+		RecordAttributeEvents(event, attribute_types, &entity, 1);
+	}
+
+	// Registers a handler of the events of type E. Must not be called while dispatching.
+	template <typename E>
+	void Subscribe(EventHandler<E> handler) {
+		std::lock_guard<std::mutex> lock(mutex_);
+		GetChannel<E>().handlers.push_back(std::move(handler));
+	}
+	// Queues an event of type E. Events without handlers are dropped.
+	template <typename E>
+	void Emit(const E& event) {
+		std::lock_guard<std::mutex> lock(mutex_);
+		EventChannel<E>& channel = GetChannel<E>();
+		if (!channel.handlers.empty()) {
+			channel.pending.push_back(event);
+		}
+	}
+
+	// Hands the queued events to their observers and handlers. Events recorded while dispatching
+	// are dispatched as well, until no event is left.
+	void Dispatch();
+
+private:
+	// Queue and handlers of a single event type. The virtual call is paid once per batch.
+	struct IEventChannel {
+		virtual ~IEventChannel() = default;
+		// Dispatches the pending events. Returns whether there were any.
+		virtual bool Dispatch(std::mutex& mutex) = 0;
+	};
+	template <typename E>
+	struct EventChannel : IEventChannel {
+		std::vector<EventHandler<E>> handlers;
+		std::vector<E> pending;
+		// Events being dispatched. Swapped with pending so that handlers may emit new events.
+		std::vector<E> dispatching;
+
+		bool Dispatch(std::mutex& mutex) override {
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				std::swap(pending, dispatching);
+			}
+			if (dispatching.empty()) {
+				return false;
+			}
+			for (const EventHandler<E>& handler : handlers) {
+				handler(std::span<const E>(dispatching));
+			}
+			dispatching.clear();
+			return true;
+		}
+	};
+
+	// Returns the channel of the event type E, creating it on first use. mutex_ must be held.
+	template <typename E>
+	EventChannel<E>& GetChannel() {
+		EventType type = GetEventTypeId<E>();
+		if (type >= channels_.size()) {
+			channels_.resize(type + 1);
+		}
+		if (channels_[type] == nullptr) {
+			channels_[type] = std::make_unique<EventChannel<E>>();
+		}
+		return static_cast<EventChannel<E>&>(*channels_[type]);
+	}
+	// Dispatches the pending attribute events. Returns whether there were any.
+	bool DispatchAttributeEvents();
+
+private:
+	// Attribute types with at least one observer, per event.
+	std::array<ArchetypeSignature, kAttributeEventCount> observed_;
+	// Observers per event and attribute type.
+	std::array<std::array<std::vector<AttributeObserver>, kMaxAttributes>, kAttributeEventCount>
+			observers_;
+	// Entities the events happened to since the last dispatch, per event and attribute type.
+	std::array<std::array<std::vector<EntityID>, kMaxAttributes>, kAttributeEventCount>
+			pending_entities_;
+	// Entities being dispatched. Swapped with the pending ones so that observers may record
+	// new events.
+	std::vector<EntityID> dispatching_entities_;
+	// Channels of the typed events, indexed by EventType. Null for types never used.
+	std::vector<std::unique_ptr<IEventChannel>> channels_;
+	// Guards the pending events and channels_.
+	std::mutex mutex_;
+};
+} // namespace core::ecs
+
+#endif // CORE_EVENT_MANAGER_H
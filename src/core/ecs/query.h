@@ -0,0 +1,359 @@
+#ifndef CORE_QUERY_H
+#define CORE_QUERY_H
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "archetype.h"
+#include "types.h"
+#include "core/jobs/job_system.h"
+
+namespace core::ecs {
+
+// Query term for an attribute that entities may or may not have. The callback receives a pointer
+// to the attribute, or nullptr for entities without it. Archetypes match regardless of T.
+template <typename T>
+struct Optional {};
+
+// Query filter restricting a query to the chunks whose T column was written after the reference
+// tick given to Query::Where. Changes are tracked per chunk, so every entity of a matching chunk
+// is visited.
+template <typename T>
+struct Changed {};
+// Query filter restricting a query to the chunks that received entities after the reference tick
+// given to Query::Where. Entities moving into a chunk count as added for all its columns.
+template <typename T>
+struct Added {};
+
+namespace internal {
+// Attribute type, callback argument and access of a query term.
+template <typename T>
+struct QueryTermTraits {
+	using Attribute = std::remove_const_t<T>;
+	using Argument = T&;
+	static constexpr bool kOptional = false;
+	static constexpr bool kWrites = !std::is_const_v<T>;
+};
+template <typename T>
+struct QueryTermTraits<Optional<T>> {
+	using Attribute = std::remove_const_t<T>;
+	using Argument = T*;
+	static constexpr bool kOptional = true;
+	static constexpr bool kWrites = !std::is_const_v<T>;
+};
+
+template <typename Filter>
+struct QueryFilterTraits;
+template <typename T>
+struct QueryFilterTraits<Changed<T>> {
+	using Type = T;
+	static constexpr bool kAdded = false;
+};
+template <typename T>
+struct QueryFilterTraits<Added<T>> {
+	using Type = T;
+	static constexpr bool kAdded = true;
+};
+} // namespace internal
+
+// Typed view over the archetypes containing all the attribute types Ts. Column lookups are
+// resolved once per archetype, after which entities are visited by walking the chunk columns with
+// plain pointer arithmetic. Ts may be const-qualified for read-only access; the columns of the
+// other attributes are marked as changed for every chunk visited. Ts may also be Optional<T>,
+// and attribute types can be excluded with Without.
+// Queries can be default constructed or obtained through ECSManager::GetQuery.
+template <typename... Ts>
+class Query {
+public:
+	static constexpr size_t kAttributeCount = sizeof...(Ts);
+	// Maximum number of filters of a query.
+	static constexpr size_t kMaxFilters = 4;
+
+	Query() :
+			attribute_types_{
+					GetAttributeTypeId<typename internal::QueryTermTraits<Ts>::Attribute>()...} {
+		for (size_t i = 0; i < kAttributeCount; ++i) {
+			if (!kOptional[i]) {
+				required_.set(attribute_types_[i]);
+			}
+		}
+		terms_.include = required_;
+	}
+
+	// Restricts the query to the archetypes without any of the attribute types Us.
+	template <typename... Us>
+	Query& Without() {
+		(terms_.exclude.set(GetAttributeTypeId<std::remove_const_t<Us>>()), ...);
+		return *this;
+	}
+	// Restricts the query to the chunks passing all Filters (Changed<T> or Added<T>) relative to
+	// since_tick, usually System::GetLastRunTick(). Filtered attribute types do not have to be
+	// part of Ts, but archetypes must contain them to match.
+	template <typename... Filters>
+	Query& Where(ChangeTick since_tick) {
+		static_assert(sizeof...(Filters) <= kMaxFilters, "Too many query filters.");
+		since_tick_ = since_tick;
+		filter_count_ = 0;
+		terms_.include = required_;
+		(AddFilter<Filters>(), ...);
+		return *this;
+	}
+
+	// Returns the signature an archetype must contain to match the query.
+	inline const ArchetypeSignature& GetSignature() const { return terms_.include; }
+	// Returns the terms an archetype must satisfy to match the query. Used to look up the matching
+	// archetypes in the ArchetypeManager's query cache.
+	inline const QueryTerms& GetTerms() const { return terms_; }
+	// Checks if the archetype satisfies the terms of the query.
+	inline bool Matches(const Archetype& archetype) const {
+		return terms_.Matches(archetype.GetSignature());
+	}
+
+	// Calls func(EntityID, Ts&...) for every entity in the archetype. Optional terms are passed as
+	// pointers. Does nothing if the archetype does not match the query.
+	template <typename Func>
+	void ForEach(Archetype& archetype, Func&& func) const {
+		if (!Matches(archetype)) {
+			return;
+		}
+		ColumnAccess access = ResolveColumns(archetype);
+		archetype.ForEachChunk([&](const ArchetypeChunk& chunk) {
+			if (PassesFilters(archetype, chunk, access)) {
+				ForEachInChunk(archetype, chunk, access, func);
+			}
+		});
+	}
+	// Calls func(EntityID, Ts&...) for every entity in a single chunk of the archetype. Does
+	// nothing if the archetype does not match the query or the chunk does not pass its filters.
+	template <typename Func>
+	void ForEach(Archetype& archetype, const ArchetypeChunk& chunk, Func&& func) const {
+		if (!Matches(archetype)) {
+			return;
+		}
+		ColumnAccess access = ResolveColumns(archetype);
+		if (PassesFilters(archetype, chunk, access)) {
+			ForEachInChunk(archetype, chunk, access, func);
+		}
+	}
+
+	// Calls func(EntityID, Ts&...) for every entity in the matching archetypes, splitting their
+	// chunks into jobs of grain_size chunks run on the JobSystem, and waits for them. func is
+	// shared by the jobs and must be safe to call concurrently for different entities.
+	template <typename Func>
+	void ForEachParallel(std::span<Archetype* const> archetypes, Func&& func,
+						 size_t grain_size = 1) const {
+		ChunkTasks tasks = CollectChunks(archetypes);
+		jobs::JobSystem::GetInstance().ParallelFor(
+				tasks.chunks.size(), grain_size, [&](size_t begin, size_t end) {
+			for (size_t i = begin; i < end; ++i) {
+				VisitChunk(tasks, tasks.chunks[i], func);
+			}
+		});
+	}
+	// Same as ForEachParallel, for a single archetype.
+	template <typename Func>
+	void ForEachParallel(Archetype& archetype, Func&& func, size_t grain_size = 1) const {
+		Archetype* archetypes[] = {&archetype};
+		ForEachParallel(std::span<Archetype* const>(archetypes), func, grain_size);
+	}
+	// Parallel iteration with a reduction. Every job accumulates into its own copy of init by
+	// calling func(Accumulator&, EntityID, Ts&...) for its entities, so jobs never share an
+	// accumulator. Once all jobs are done, the partial results are combined in chunk order on the
+	// calling thread with reduce(Accumulator& result, const Accumulator& partial), starting from
+	// init, which keeps the result deterministic.
+	template <typename Accumulator, typename Func, typename Reduce>
+	Accumulator ParallelReduce(std::span<Archetype* const> archetypes, const Accumulator& init,
+							   Func&& func, Reduce&& reduce, size_t grain_size = 1) const {
+		ChunkTasks tasks = CollectChunks(archetypes);
+		grain_size = std::max<size_t>(grain_size, 1);
+		std::vector<Accumulator> partials((tasks.chunks.size() + grain_size - 1) / grain_size,
+										  init);
+		jobs::JobSystem::GetInstance().ParallelFor(
+				tasks.chunks.size(), grain_size, [&](size_t begin, size_t end) {
+			// Accumulated locally and stored once, so that jobs running at the same time do not
+			// write to neighbouring slots of partials.
+			Accumulator partial = init;
+			auto accumulate = [&](EntityID entity_id, auto&&... attributes) {
+				func(partial, entity_id, attributes...);
+			};
+			for (size_t i = begin; i < end; ++i) {
+				VisitChunk(tasks, tasks.chunks[i], accumulate);
+			}
+			partials[begin / grain_size] = std::move(partial);
+		});
+		Accumulator result = init;
+		for (const Accumulator& partial : partials) {
+			reduce(result, partial);
+		}
+		return result;
+	}
+	// Same as ParallelReduce, for a single archetype.
+	template <typename Accumulator, typename Func, typename Reduce>
+	Accumulator ParallelReduce(Archetype& archetype, const Accumulator& init, Func&& func,
+							   Reduce&& reduce, size_t grain_size = 1) const {
+		Archetype* archetypes[] = {&archetype};
+		return ParallelReduce(std::span<Archetype* const>(archetypes), init, func, reduce,
+							  grain_size);
+	}
+
+private:
+	// Attribute type of a filter and whether it checks for additions or changes.
+	struct FilterTerm {
+		AttributeType attribute_type;
+		bool added;
+	};
+	// Column indices and strides of the query attributes within an archetype, followed by the
+	// columns of the filters. Optional attributes missing from the archetype have kNoColumn.
+	struct ColumnAccess {
+		std::array<size_t, kAttributeCount> columns;
+		std::array<size_t, kAttributeCount> strides;
+		std::array<size_t, kMaxFilters> filter_columns;
+	};
+	// Chunk visited by a parallel iteration, along with the columns of its archetype.
+	struct ChunkTask {
+		Archetype* archetype;
+		size_t access_index;
+		size_t chunk_index;
+	};
+	// Chunks of the matching archetypes, flattened so that they can be split evenly into jobs.
+	struct ChunkTasks {
+		std::vector<ColumnAccess> accesses;
+		std::vector<ChunkTask> chunks;
+	};
+	// Whether each term of the query is optional, in the order of Ts.
+	static constexpr std::array<bool, kAttributeCount> kOptional{
+			internal::QueryTermTraits<Ts>::kOptional...};
+	// Whether each attribute of the query is written, in the order of Ts.
+	static constexpr std::array<bool, kAttributeCount> kWrites{
+			internal::QueryTermTraits<Ts>::kWrites...};
+
+	template <typename Filter>
+	void AddFilter() {
+		using Traits = internal::QueryFilterTraits<Filter>;
+		AttributeType type = GetAttributeTypeId<std::remove_const_t<typename Traits::Type>>();
+		filters_[filter_count_++] = {type, Traits::kAdded};
+		terms_.include.set(type);
+	}
+
+	// Looks up the columns of the query attributes in the archetype.
+	ColumnAccess ResolveColumns(const Archetype& archetype) const {
+		ColumnAccess access;
+		for (size_t i = 0; i < kAttributeCount; ++i) {
+			if (kOptional[i]) {
+				access.columns[i] = archetype.FindColumnIndex(attribute_types_[i]);
+			} else {
+				access.columns[i] = archetype.GetColumnIndex(attribute_types_[i]);
+			}
+			access.strides[i] = access.columns[i] == kNoColumn
+										? 0
+										: archetype.GetColumnStride(access.columns[i]);
+		}
+		for (size_t i = 0; i < filter_count_; ++i) {
+			access.filter_columns[i] = archetype.GetColumnIndex(filters_[i].attribute_type);
+		}
+		return access;
+	}
+
+	// Checks if the chunk passes all the filters of the query.
+	bool PassesFilters(const Archetype& archetype, const ArchetypeChunk& chunk,
+					   const ColumnAccess& access) const {
+		for (size_t i = 0; i < filter_count_; ++i) {
+			ChangeTick tick = filters_[i].added
+									  ? archetype.GetAddedTick(chunk.index, access.filter_columns[i])
+									  : archetype.GetChangedTick(chunk.index,
+																 access.filter_columns[i]);
+			if (tick <= since_tick_) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	// Resolves the columns of the matching archetypes and lists their chunks.
+	ChunkTasks CollectChunks(std::span<Archetype* const> archetypes) const {
+		ChunkTasks tasks;
+		for (Archetype* archetype : archetypes) {
+			if (!Matches(*archetype)) {
+				continue;
+			}
+			tasks.accesses.push_back(ResolveColumns(*archetype));
+			size_t chunk_count = archetype->GetChunkCount();
+			for (size_t chunk_index = 0; chunk_index < chunk_count; ++chunk_index) {
+				tasks.chunks.push_back({archetype, tasks.accesses.size() - 1, chunk_index});
+			}
+		}
+		return tasks;
+	}
+	// Visits a chunk listed by CollectChunks if it passes the filters.
+	template <typename Func>
+	void VisitChunk(const ChunkTasks& tasks, const ChunkTask& task, Func& func) const {
+		ArchetypeChunk chunk = task.archetype->GetChunk(task.chunk_index);
+		const ColumnAccess& access = tasks.accesses[task.access_index];
+		if (PassesFilters(*task.archetype, chunk, access)) {
+			ForEachInChunk(*task.archetype, chunk, access, func);
+		}
+	}
+
+	// Walks the rows of a chunk, handing the attributes of each entity to func.
+	template <typename Func>
+	static void ForEachInChunk(Archetype& archetype, const ArchetypeChunk& chunk,
+							   const ColumnAccess& access, Func& func) {
+		std::array<uint8_t*, kAttributeCount> data;
+		for (size_t i = 0; i < kAttributeCount; ++i) {
+			if (access.columns[i] == kNoColumn) {
+				data[i] = nullptr;
+				continue;
+			}
+			data[i] = archetype.GetColumnData(chunk, access.columns[i]);
+			if (kWrites[i]) {
+				archetype.MarkChanged(chunk.index, access.columns[i]);
+			}
+		}
+		for (size_t row = 0; row < chunk.size; ++row) {
+			Invoke(func, chunk.entities[row], data, access.strides, row,
+				   std::index_sequence_for<Ts...>{});
+		}
+	}
+
+	template <typename Func, size_t... Is>
+	static void Invoke(Func& func, EntityID entity_id,
+					   const std::array<uint8_t*, kAttributeCount>& data,
+					   const std::array<size_t, kAttributeCount>& strides, size_t row,
+					   std::index_sequence<Is...>) {
+		func(entity_id, GetArgument<Ts>(data[Is], strides[Is], row)...);
+	}
+
+	// Returns the callback argument of a term for the given row of its column.
+	template <typename T>
+	static typename internal::QueryTermTraits<T>::Argument GetArgument(uint8_t* data,
+																		size_t stride, size_t row) {
+		if constexpr (internal::QueryTermTraits<T>::kOptional) {
+			using Pointer = typename internal::QueryTermTraits<T>::Argument;
+			return data == nullptr ? nullptr : reinterpret_cast<Pointer>(data + row * stride);
+		} else {
+			return *reinterpret_cast<T*>(data + row * stride);
+		}
+	}
+
+private:
+	// Attribute types of the query, in the order of Ts.
+	std::array<AttributeType, kAttributeCount> attribute_types_;
+	// Attribute types of the non-optional terms.
+	ArchetypeSignature required_;
+	// Terms archetypes must satisfy: the required and filtered attribute types, and the excluded
+	// ones.
+	QueryTerms terms_;
+	// Filters of the query, checked against since_tick_.
+	std::array<FilterTerm, kMaxFilters> filters_;
+	size_t filter_count_ = 0;
+	ChangeTick since_tick_ = 0;
+};
+} // namespace core::ecs
+
+#endif // CORE_QUERY_H
@@ -2,9 +2,42 @@
 #define CORE_SYSTEM_H
 
 #include "archetype.h"
+#include "types.h"
 
 namespace core::ecs {
 
+// Phases of a frame. Every system belongs to one phase; phases run in declaration order.
+enum class SystemPhase {
+	kPreUpdate,
+	kUpdate,
+	kPostUpdate,
+	kRender
+};
+
+// Attributes accessed by a system. The SystemManager uses it to find the systems that can run
+// concurrently: two systems conflict when one of them writes an attribute type the other reads or
+// writes.
+struct SystemAccess {
+	// Attribute types the system only reads.
+	ArchetypeSignature reads;
+	// Attribute types the system writes.
+	ArchetypeSignature writes;
+	// Whether the system has to run on the thread calling UpdateSystems, e.g. because it issues
+	// graphics calls.
+	bool main_thread_only = true;
+	// Whether the system implements TickChunk and its chunks can be ticked concurrently. Only
+	// honoured for systems that are not main thread only.
+	bool per_chunk = false;
+	// Number of consecutive chunks ticked by each job of a per chunk system. Larger grains
+	// amortize the scheduling cost when TickChunk does little work per chunk.
+	size_t chunk_grain_size = 1;
+
+	// Checks if the two accesses prevent the systems from running at the same time.
+	inline bool ConflictsWith(const SystemAccess& other) const {
+		return (writes & (other.reads | other.writes)).any() || (other.writes & reads).any();
+	}
+};
+
 class System {
 public:
 	virtual ~System() = default;
@@ -16,7 +49,8 @@ public:
 	// called by the higher manager (SystemManager). It calls Start for each entity in the archetype.
 	virtual void StartArchetype(core::ecs::Archetype& archetype) = 0;
 
-	// Pure update function to be overridden by derived classes.
+	// Pure update function to be overridden by derived classes. Called once per update, before the
+	// archetypes or chunks of the system are ticked.
 	virtual void Tick(float delta_time) = 0;
 
 	// TODO: Add abstraction layer and simulate calling this per entity as Tick.
@@ -24,6 +58,31 @@ public:
 	// Calls the update function for a specific archetype. This function should only be called by
 	// the higher manager (SystemManager). It calls Tick for each entity in the archetype.
 	virtual void TickArchetype(Archetype& archetype, float delta_time) = 0;
+
+	// Calls the update function for a single chunk of an archetype. Used instead of TickArchetype
+	// when GetAccess() requests per chunk updates, in which case it may run concurrently for
+	// different chunks.
+	virtual void TickChunk(Archetype& /*archetype*/, const ArchetypeChunk& /*chunk*/,
+						   float /*delta_time*/) {}
+
+	// Returns the change tick of the previous run of the system, or 0 if it never ran. Pass it to
+	// Query::Where to only visit the chunks written since then by other systems.
+	inline ChangeTick GetLastRunTick() const { return last_run_tick_; }
+
+	// Returns the attributes the system accesses while ticking. The default is the conservative
+	// choice of writing every attribute on the main thread, which never runs concurrently with
+	// other systems.
+	virtual SystemAccess GetAccess() const {
+		SystemAccess access;
+		access.writes.set();
+		return access;
+	}
+
+private:
+	friend class SystemManager;
+
+	// Change tick of the wave the system last ran in. Set by the SystemManager.
+	ChangeTick last_run_tick_ = 0;
 };
 } // namespace core::ecs
 
@@ -1,49 +1,197 @@
 #include "system_manager.h"
 
+#include <algorithm>
+#include <queue>
+#include <stdexcept>
+#include <typeinfo>
+#include <utility>
+
 #include "archetype_manager.h"
 #include "system.h"
 #include "types.h"
 
 namespace core::ecs {
 
-void SystemManager::OnArchetypeCreated(Archetype& archetype) {
-	ArchetypeSignature archetype_signature = archetype.GetSignature();
-	for (auto& [type, system] : systems_) {
-		ArchetypeSignature system_signature = system_signatures_[type];
-		if ((archetype_signature & system_signature) == system_signature) {
-			system_archetypes_[type].push_back(archetype);
+void SystemManager::StartSystems(ArchetypeManager& archetype_manager) {
+	if (schedule_dirty_) {
+		BuildSchedule(archetype_manager);
+	}
+
+	for (SystemEntry& entry : systems_) {
+		for (Archetype* archetype : *entry.archetypes) {
+			entry.system->StartArchetype(*archetype);
 		}
 	}
 }
 
-void SystemManager::RebuildArchetypeCache(ArchetypeManager& archetype_manager) {
-	system_archetypes_.clear();
-	for (auto& [signature, archetype] : archetype_manager.GetAllArchetypes()) {
-		for (auto& [type, system] : systems_) {
-			auto const& system_signature = system_signatures_[type];
-			if ((signature & system_signature) == system_signature) {
-				system_archetypes_[type].push_back(*archetype);
+void SystemManager::UpdateSystems(float delta_time, ArchetypeManager& archetype_manager,
+								  const std::function<void()>& sync_point) {
+	if (schedule_dirty_) {
+		BuildSchedule(archetype_manager);
+	}
+
+	size_t wave_begin = 0;
+	for (size_t wave_end : wave_ends_) {
+		// Systems of a wave never write what the others access, so they can share a tick.
+		ChangeTick wave_tick = archetype_manager.AdvanceChangeTick();
+		jobs::JobCounter counter;
+		for (size_t i = wave_begin; i < wave_end; ++i) {
+			if (!systems_[i].access.main_thread_only) {
+				ScheduleSystem(systems_[i], counter, delta_time);
 			}
 		}
+		// Main thread systems run here while the workers handle the rest of the wave.
+		for (size_t i = wave_begin; i < wave_end; ++i) {
+			SystemEntry& entry = systems_[i];
+			if (entry.access.main_thread_only) {
+				entry.system->Tick(delta_time);
+				for (Archetype* archetype : *entry.archetypes) {
+					entry.system->TickArchetype(*archetype, delta_time);
+				}
+			}
+		}
+		job_system_.Wait(counter);
+		for (size_t i = wave_begin; i < wave_end; ++i) {
+			systems_[i].system->last_run_tick_ = wave_tick;
+		}
+		// Writes made after the wave, sync points included, must be newer than its tick.
+		archetype_manager.AdvanceChangeTick();
+
+		bool phase_ends = wave_end == systems_.size() ||
+						  systems_[wave_end].phase != systems_[wave_begin].phase;
+		if (phase_ends && sync_point) {
+			sync_point();
+		}
+		wave_begin = wave_end;
 	}
 }
 
-void SystemManager::StartSystems() {
-	for (auto& [type, system] : systems_) {
-		auto& archetypes = system_archetypes_[type];
-		for (auto& archetype_ref : archetypes) {
-			System& sys = *system;
-			sys.StartArchetype(archetype_ref.get());
+void SystemManager::BuildSchedule(ArchetypeManager& archetype_manager) {
+	size_t system_count = systems_.size();
+
+	// Explicit constraints as edges between the current indices. Constraints across phases are
+	// already satisfied by the phase order.
+	std::vector<std::vector<size_t>> successors(system_count);
+	std::vector<size_t> predecessor_counts(system_count, 0);
+	for (const auto& [first_type, second_type] : order_constraints_) {
+		auto first_it = system_indices_.find(first_type);
+		auto second_it = system_indices_.find(second_type);
+		if (first_it == system_indices_.end() || second_it == system_indices_.end()) {
+			throw std::runtime_error("System order references an unregistered system.");
+		}
+		size_t first = first_it->second;
+		size_t second = second_it->second;
+		if (systems_[first].phase > systems_[second].phase) {
+			throw std::runtime_error("System order contradicts the system phases.");
+		}
+		if (systems_[first].phase == systems_[second].phase) {
+			successors[first].push_back(second);
+			++predecessor_counts[second];
+		}
+	}
+
+	// Topological sort, always picking the ready system of the earliest phase and registration.
+	auto later = [this](size_t a, size_t b) {
+		return std::make_pair(systems_[a].phase, systems_[a].registration_index) >
+			   std::make_pair(systems_[b].phase, systems_[b].registration_index);
+	};
+	std::priority_queue<size_t, std::vector<size_t>, decltype(later)> ready(later);
+	for (size_t i = 0; i < system_count; ++i) {
+		if (predecessor_counts[i] == 0) {
+			ready.push(i);
 		}
 	}
+	std::vector<size_t> order;
+	order.reserve(system_count);
+	while (!ready.empty()) {
+		size_t index = ready.top();
+		ready.pop();
+		order.push_back(index);
+		for (size_t successor : successors[index]) {
+			if (--predecessor_counts[successor] == 0) {
+				ready.push(successor);
+			}
+		}
+	}
+	if (order.size() != system_count) {
+		throw std::runtime_error("System order constraints contain a cycle.");
+	}
+
+	// Assign waves in sorted order. A system goes after every earlier system of its phase it
+	// conflicts with or is explicitly ordered after.
+	for (SystemEntry& entry : systems_) {
+		entry.access = entry.system->GetAccess();
+		entry.archetypes = &archetype_manager.QueryArchetypes(entry.signature);
+	}
+	std::vector<size_t> waves(system_count, 0);
+	size_t phase_first_wave = 0;
+	size_t wave_count = 0;
+	for (size_t position = 0; position < system_count; ++position) {
+		size_t index = order[position];
+		if (position > 0 && systems_[order[position - 1]].phase != systems_[index].phase) {
+			phase_first_wave = wave_count;
+		}
+		waves[index] = phase_first_wave;
+		for (size_t earlier = 0; earlier < position; ++earlier) {
+			size_t other = order[earlier];
+			if (systems_[other].phase != systems_[index].phase) {
+				continue;
+			}
+			const std::vector<size_t>& other_successors = successors[other];
+			bool ordered = std::find(other_successors.begin(), other_successors.end(), index) !=
+						   other_successors.end();
+			if (ordered || systems_[index].access.ConflictsWith(systems_[other].access)) {
+				waves[index] = std::max(waves[index], waves[other] + 1);
+			}
+		}
+		wave_count = std::max(wave_count, waves[index] + 1);
+	}
+	// Sorting by wave keeps every system after the systems it depends on.
+	std::stable_sort(order.begin(), order.end(), [&waves](size_t a, size_t b) {
+		return waves[a] < waves[b];
+	});
+
+	// Lay the systems out in execution order so updates are a linear walk.
+	std::vector<SystemEntry> sorted_systems;
+	sorted_systems.reserve(system_count);
+	wave_ends_.assign(wave_count, 0);
+	for (size_t index : order) {
+		sorted_systems.push_back(std::move(systems_[index]));
+		wave_ends_[waves[index]] = sorted_systems.size();
+	}
+	systems_ = std::move(sorted_systems);
+	for (size_t i = 0; i < system_count; ++i) {
+		system_indices_[typeid(*systems_[i].system)] = i;
+	}
+	schedule_dirty_ = false;
 }
 
-void SystemManager::UpdateSystems(float delta_time) {
-	for (auto& [type, system] : systems_) {
-		auto& archetypes = system_archetypes_[type];
-		for (auto& archetype_ref : archetypes) {
-			System& sys = *system;
-			sys.TickArchetype(archetype_ref.get(), delta_time);
+void SystemManager::ScheduleSystem(SystemEntry& entry, jobs::JobCounter& counter,
+								   float delta_time) {
+	System* system = entry.system.get();
+	if (!entry.access.per_chunk) {
+		// Archetypes of the same system are ticked one after the other.
+		job_system_.Schedule([system, archetypes = entry.archetypes, delta_time]() {
+			system->Tick(delta_time);
+			for (Archetype* archetype : *archetypes) {
+				system->TickArchetype(*archetype, delta_time);
+			}
+		}, counter);
+		return;
+	}
+
+	// The chunk jobs may only start once Tick is done.
+	system->Tick(delta_time);
+	size_t grain_size = std::max<size_t>(entry.access.chunk_grain_size, 1);
+	for (Archetype* archetype : *entry.archetypes) {
+		size_t chunk_count = archetype->GetChunkCount();
+		for (size_t begin = 0; begin < chunk_count; begin += grain_size) {
+			size_t end = std::min(begin + grain_size, chunk_count);
+			job_system_.Schedule([system, archetype, begin, end, delta_time]() {
+				for (size_t chunk_index = begin; chunk_index < end; ++chunk_index) {
+					system->TickChunk(*archetype, archetype->GetChunk(chunk_index), delta_time);
+				}
+			}, counter);
 		}
 	}
 }
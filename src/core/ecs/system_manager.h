@@ -1,55 +1,100 @@
 #ifndef CORE_SYSTEM_MANAGER_H
 #define CORE_SYSTEM_MANAGER_H
 
+#include <cassert>
+#include <functional>
 #include <memory>
 #include <typeindex>
 #include <unordered_map>
+#include <utility>
 #include <vector>
 
 #include "archetype.h"
 #include "archetype_manager.h"
 #include "system.h"
 #include "types.h"
+#include "core/jobs/job_system.h"
 
 namespace core::ecs {
 
+// Owns the systems and runs them every frame. Systems run phase by phase (see SystemPhase).
+// Within a phase, explicit before/after constraints are honoured first, otherwise registration
+// order decides. The resulting order is split into waves: a system lands in the first wave after
+// every earlier system it conflicts with (see SystemAccess) or is ordered after, so the systems
+// within a wave can run concurrently on the JobSystem.
 class SystemManager {
 public:
 	explicit SystemManager() = default;
 
-	// Registers a system of type T with the given archetype signature.
+	// Registers a system of type T with the given archetype signature, running in the given phase.
 	// T must be derived from System.
 	template <typename T, typename = std::enable_if_t<std::is_base_of_v<System, T>>>
-	void RegisterSystem(ArchetypeSignature& signature) {
+	void RegisterSystem(const ArchetypeSignature& signature,
+						SystemPhase phase = SystemPhase::kUpdate) {
 		std::type_index type(typeid(T));
 
-		assert(system_signatures_.find(type) == system_signatures_.end() &&
+		assert(system_indices_.find(type) == system_indices_.end() &&
 			   "System type already registered.");
 
-		auto system = std::make_unique<T>();
-		systems_.insert({type, std::move(system)});
-		system_signatures_[type] = signature;
+		system_indices_[type] = systems_.size();
+		systems_.push_back({std::make_unique<T>(), signature, phase, systems_.size(), {}, nullptr});
+		schedule_dirty_ = true;
 	}
+	// Requires system First to run before system Second. Both systems must be registered by the
+	// time the systems are started or updated. Ordering a system before one of an earlier phase
+	// throws an exception when the schedule is built, as do cyclic constraints.
+	template <typename First, typename Second,
+			  typename = std::enable_if_t<std::is_base_of_v<System, First> &&
+										  std::is_base_of_v<System, Second>>>
+	void SetSystemOrder() {
+		order_constraints_.emplace_back(typeid(First), typeid(Second));
+		schedule_dirty_ = true;
+	}
+
+	// Calls the Start function for all registered systems, in schedule order.
+	void StartSystems(ArchetypeManager& archetype_manager);
+	// Updates all registered systems by ticking their matching archetypes. Systems within a wave
+	// run concurrently, waves run one after the other. Every wave runs under its own change tick
+	// of the archetype manager, which becomes the last run tick of its systems. sync_point, if
+	// set, is called on the calling thread at the end of every phase, while no system is running.
+	void UpdateSystems(float delta_time, ArchetypeManager& archetype_manager,
+					   const std::function<void()>& sync_point = {});
 
-	// Calls the Start function for all registered systems.
-	void StartSystems();
-	// Updates all registered systems by ticking their matching archetypes.
-	void UpdateSystems(float delta_time);
+private:
+	struct SystemEntry {
+		std::unique_ptr<System> system;
+		// Required archetype signature of the system.
+		ArchetypeSignature signature;
+		// Phase the system runs in.
+		SystemPhase phase;
+		// Position of the system in registration order. Breaks ties between unordered systems.
+		size_t registration_index;
+		// Attribute access of the system, captured when the schedule is built.
+		SystemAccess access;
+		// Archetypes matching the signature, owned by the query cache of the archetype manager
+		// which keeps them current. Resolved when the schedule is built.
+		const std::vector<Archetype*>* archetypes = nullptr;
+	};
 
-	// Adds an archetype to all systems that match its signature.
-	// Should be called whenever a new archetype is created.
-	void OnArchetypeCreated(Archetype& archetype);
-	// Rebuilds the cache of archetypes for all systems.
-	// Should be called after all systems have been registered.
-	void RebuildArchetypeCache(ArchetypeManager& archetype_manager);
+	// Sorts systems_ into execution order, splits it into waves and resolves the archetypes of
+	// every system. Throws if the order constraints contradict the phases or each other.
+	void BuildSchedule(ArchetypeManager& archetype_manager);
+	// Schedules the work of a system that can run off the main thread on the job system.
+	void ScheduleSystem(SystemEntry& entry, jobs::JobCounter& counter, float delta_time);
 
 private:
-	// Maps system type to its instance. Stored as unique_ptr to manage lifetime.
-	std::unordered_map<std::type_index, std::unique_ptr<System>> systems_;
-	// Maps system type to its required archetype signature.
-	std::unordered_map<std::type_index, ArchetypeSignature> system_signatures_;
-    // Cache archetypes for each system for quick access during updates
-    std::unordered_map<std::type_index, std::vector<std::reference_wrapper<Archetype>>> system_archetypes_;
+	// Registered systems, in execution order once the schedule is built.
+	std::vector<SystemEntry> systems_;
+	// Maps system type to its index in systems_.
+	std::unordered_map<std::type_index, size_t> system_indices_;
+	// Pairs of systems where the first has to run before the second.
+	std::vector<std::pair<std::type_index, std::type_index>> order_constraints_;
+	// End index in systems_ of each wave. Waves never span two phases.
+	std::vector<size_t> wave_ends_;
+	// Set when systems or constraints were added since the schedule was last built.
+	bool schedule_dirty_ = true;
+
+	jobs::JobSystem& job_system_ = jobs::JobSystem::GetInstance();
 };
 } // namespace core::ecs
 
@@ -1,13 +1,44 @@
 #ifndef CORE_TYPES_H
 #define CORE_TYPES_H
 
+#include <atomic>
 #include <bitset>
+#include <cstddef>
 #include <cstdint>
+#include <cstring>
+#include <functional>
+#include <limits>
+#include <new>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
 
 namespace core::ecs {
 
-// Define a type alias for Entity IDs.
-using EntityID = uint16_t;
+// Entity handle made of an index (low kEntityIndexBits bits) and a generation (the remaining high
+// bits). The generation is bumped every time an index is recycled, so handles kept around after
+// their entity was destroyed can be told apart from the entity that reuses the index. Indices are
+// retired rather than let their generation wrap.
+using EntityID = uint32_t;
+static constexpr uint32_t kEntityIndexBits = 22;
+static constexpr uint32_t kEntityGenerationBits = 32 - kEntityIndexBits;
+static constexpr uint32_t kEntityIndexMask = (1u << kEntityIndexBits) - 1;
+static constexpr uint32_t kEntityGenerationMask = (1u << kEntityGenerationBits) - 1;
+// Handle that never refers to a live entity. Its index is never handed out.
+static constexpr EntityID kNullEntity = std::numeric_limits<EntityID>::max();
+
+// Returns the index part of an entity handle.
+inline constexpr uint32_t ToEntityIndex(EntityID entity) { return entity & kEntityIndexMask; }
+// Returns the generation part of an entity handle.
+inline constexpr uint32_t ToEntityGeneration(EntityID entity) { return entity >> kEntityIndexBits; }
+// Builds an entity handle from its index and generation.
+inline constexpr EntityID MakeEntityID(uint32_t index, uint32_t generation) {
+	return (generation << kEntityIndexBits) | (index & kEntityIndexMask);
+}
+
+// Counter stamped on chunk columns when they are written, used for change detection. Advanced by
+// the ArchetypeManager between system waves; never wraps in practice.
+using ChangeTick = uint64_t;
 
 // Define a type alias for Attribute Types.
 using AttributeType = uint8_t;
@@ -17,11 +48,132 @@ static constexpr size_t kMaxAttributes = 64;
 // Archetype signature represented as a bitset, where each bit indicates the presence of an
 // unique attribute.
 using ArchetypeSignature = std::bitset<kMaxAttributes>;
-// Base interface for all attribute types.
-class IAttribute {
-public:
-	virtual ~IAttribute() = default;
+
+// Terms an archetype signature is matched against: the attribute types it must contain and the
+// ones it must not contain.
+struct QueryTerms {
+	ArchetypeSignature include;
+	ArchetypeSignature exclude;
+
+	inline bool Matches(const ArchetypeSignature& signature) const {
+		return (signature & include) == include && (signature & exclude).none();
+	}
+	bool operator==(const QueryTerms& other) const = default;
+};
+// Hash of QueryTerms, for use as an unordered container key.
+struct QueryTermsHash {
+	inline size_t operator()(const QueryTerms& terms) const {
+		std::hash<ArchetypeSignature> hash;
+		return hash(terms.include) * 31 + hash(terms.exclude);
+	}
+};
+// Base of all attribute types. Has no virtual functions, so attributes carry no vptr and stay
+// plain data; type-specific operations go through the attribute's AttributeInfo.
+class IAttribute {};
+
+// Type-erased operations on an attribute type. Registered along with the attribute type so that
+// archetypes can construct, relocate and destroy attribute data without knowing its type.
+struct AttributeInfo {
+	size_t size;
+	size_t alignment;
+	// Set when values can be copied and relocated with memcpy and need no destruction.
+	bool trivial;
+	void (*default_construct_fn)(void* destination);
+	void (*copy_construct_fn)(void* destination, const void* source);
+	void (*copy_assign_fn)(void* destination, const void* source);
+	void (*relocate_fn)(void* destination, void* source);
+	void (*destroy_fn)(void* data);
+
+	// Default constructs a value in the uninitialized destination.
+	inline void DefaultConstruct(void* destination) const { default_construct_fn(destination); }
+	// Copy constructs source into the uninitialized destination.
+	inline void CopyConstruct(void* destination, const void* source) const {
+		if (trivial) {
+			std::memcpy(destination, source, size);
+		} else {
+			copy_construct_fn(destination, source);
+		}
+	}
+	// Copy assigns source to the constructed destination.
+	inline void CopyAssign(void* destination, const void* source) const {
+		if (trivial) {
+			std::memcpy(destination, source, size);
+		} else {
+			copy_assign_fn(destination, source);
+		}
+	}
+	// Moves source into the uninitialized destination and destroys source.
+	inline void Relocate(void* destination, void* source) const {
+		if (trivial) {
+			std::memcpy(destination, source, size);
+		} else {
+			relocate_fn(destination, source);
+		}
+	}
+	// Destroys the value.
+	inline void Destroy(void* data) const {
+		if (!trivial) {
+			destroy_fn(data);
+		}
+	}
 };
+
+namespace internal {
+// Hands out the next unused AttributeType identifier. Throws once kMaxAttributes identifiers
+// have been handed out, as signatures and archetype tables have no room for more types.
+inline AttributeType NextAttributeTypeId() {
+	static std::atomic<size_t> next_attribute_type{0};
+	size_t attribute_type = next_attribute_type.fetch_add(1, std::memory_order_relaxed);
+	if (attribute_type >= kMaxAttributes) {
+		throw std::runtime_error("Too many attribute types, at most kMaxAttributes are supported.");
+	}
+	return static_cast<AttributeType>(attribute_type);
+}
+} // namespace internal
+
+// Returns the AttributeType identifier of the attribute class T. Identifiers are assigned once per
+// type, on first use, so every later call is a single load of a static. Identifiers are stable for
+// the lifetime of the process but may differ between runs. Throws on the first use of more than
+// kMaxAttributes types.
+template <typename T, typename = std::enable_if_t<std::is_base_of_v<IAttribute, T>>>
+inline AttributeType GetAttributeTypeId() {
+	static const AttributeType attribute_type = internal::NextAttributeTypeId();
+	return attribute_type;
+}
+
+// Returns the AttributeInfo of the attribute class T.
+template <typename T, typename = std::enable_if_t<std::is_base_of_v<IAttribute, T>>>
+inline const AttributeInfo& GetAttributeInfo() {
+	static const AttributeInfo info{
+		sizeof(T),
+		alignof(T),
+		std::is_trivially_copyable_v<T> && std::is_trivially_destructible_v<T>,
+		[](void* destination) { new (destination) T(); },
+		[](void* destination, const void* source) {
+			new (destination) T(*static_cast<const T*>(source));
+		},
+		[](void* destination, const void* source) {
+			*static_cast<T*>(destination) = *static_cast<const T*>(source);
+		},
+		[](void* destination, void* source) {
+			new (destination) T(std::move(*static_cast<T*>(source)));
+			static_cast<T*>(source)->~T();
+		},
+		[](void* data) { static_cast<T*>(data)->~T(); }};
+	return info;
+}
+
+// Returns the archetype signature made of the attribute classes Ts, e.g.
+// Signature<Transform, Camera>(). The signature is built once per set of types.
+template <typename... Ts>
+inline const ArchetypeSignature& Signature() {
+	static const ArchetypeSignature signature = [] {
+		ArchetypeSignature result;
+		(result.set(GetAttributeTypeId<std::remove_const_t<Ts>>()), ...);
+		return result;
+	}();
+	return signature;
+}
 } // namespace core::ecs
 
 #endif // CORE_TYPES_H
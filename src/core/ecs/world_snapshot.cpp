@@ -0,0 +1,397 @@
+#include "world_snapshot.h"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <fstream>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "archetype.h"
+#include "ecs_manager.h"
+#include "types.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define CORE_WORLD_SNAPSHOT_USE_MMAP
+#endif
+
+namespace core::ecs {
+
+namespace {
+
+static constexpr uint32_t kNoSchemaIndex = static_cast<uint32_t>(-1);
+
+inline uint64_t AlignUp(uint64_t value, uint64_t alignment) {
+	return (value + alignment - 1) / alignment * alignment;
+}
+
+// Read-only view of a whole snapshot file. Mapped where the platform allows it, so only the pages
+// actually copied from are read, and read into memory otherwise.
+class SnapshotFile {
+public:
+	explicit SnapshotFile(const std::string& path) {
+#if defined(CORE_WORLD_SNAPSHOT_USE_MMAP)
+		int fd = open(path.c_str(), O_RDONLY);
+		if (fd < 0) {
+			throw std::runtime_error("Failed to open world snapshot: " + path);
+		}
+		struct stat file_stat;
+		if (fstat(fd, &file_stat) != 0 || file_stat.st_size <= 0) {
+			close(fd);
+			throw std::runtime_error("Invalid world snapshot: " + path);
+		}
+		size_ = static_cast<size_t>(file_stat.st_size);
+		void* data = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+		close(fd);
+		if (data == MAP_FAILED) {
+			throw std::runtime_error("Failed to map world snapshot: " + path);
+		}
+#if defined(MADV_SEQUENTIAL)
+		// Chunks are copied front to back.
+		madvise(data, size_, MADV_SEQUENTIAL);
+#endif
+		data_ = static_cast<const uint8_t*>(data);
+#else
+		std::ifstream file(path, std::ios::binary | std::ios::ate);
+		if (!file) {
+			throw std::runtime_error("Failed to open world snapshot: " + path);
+		}
+		buffer_.resize(static_cast<size_t>(file.tellg()));
+		file.seekg(0);
+		if (!file.read(reinterpret_cast<char*>(buffer_.data()), buffer_.size())) {
+			throw std::runtime_error("Failed to read world snapshot: " + path);
+		}
+		data_ = buffer_.data();
+		size_ = buffer_.size();
+#endif
+	}
+	~SnapshotFile() {
+#if defined(CORE_WORLD_SNAPSHOT_USE_MMAP)
+		munmap(const_cast<uint8_t*>(data_), size_);
+#endif
+	}
+	SnapshotFile(const SnapshotFile&) = delete;
+	SnapshotFile& operator=(const SnapshotFile&) = delete;
+
+	// Returns count elements of type T starting at the given offset. Throws if they do not lie
+	// within the file or are misaligned.
+	template <typename T>
+	std::span<const T> GetArray(uint64_t offset, uint64_t count) const {
+		if (offset % alignof(T) != 0 || offset > size_ || count > (size_ - offset) / sizeof(T)) {
+			throw std::runtime_error("Invalid world snapshot: data out of bounds.");
+		}
+		return {reinterpret_cast<const T*>(data_ + offset), static_cast<size_t>(count)};
+	}
+	inline size_t GetSize() const { return size_; }
+
+private:
+	const uint8_t* data_ = nullptr;
+	size_t size_ = 0;
+#if !defined(CORE_WORLD_SNAPSHOT_USE_MMAP)
+	std::vector<uint8_t> buffer_;
+#endif
+};
+
+// Appends the raw bytes of the elements to the file, and advances offset past them.
+template <typename T>
+void WriteArray(std::ofstream& file, uint64_t& offset, std::span<const T> elements) {
+	file.write(reinterpret_cast<const char*>(elements.data()), elements.size_bytes());
+	offset += elements.size_bytes();
+}
+
+// Pads the file with zeros up to the given offset.
+void WritePadding(std::ofstream& file, uint64_t& offset, uint64_t target) {
+	static constexpr std::array<char, kWorldSnapshotChunkAlignment> kZeros{};
+	while (offset < target) {
+		uint64_t count = std::min<uint64_t>(target - offset, kZeros.size());
+		file.write(kZeros.data(), count);
+		offset += count;
+	}
+}
+} // namespace
+
+void ECSManager::SaveWorld(const std::string& path) {
+	if (deferring_) {
+		throw std::runtime_error("The world cannot be saved while systems run.");
+	}
+
+	std::vector<Archetype*> archetypes;
+	for (auto& [signature, archetype] : archetype_manager_.GetAllArchetypes()) {
+		if (archetype->GetEntityCount() > 0) {
+			archetypes.push_back(archetype.get());
+		}
+	}
+
+	// Schema of the attribute types in use, in order of first appearance.
+	std::array<uint32_t, kMaxAttributes> schema_indices;
+	schema_indices.fill(kNoSchemaIndex);
+	std::vector<WorldSnapshotAttribute> attributes;
+	std::string names;
+	std::vector<WorldSnapshotArchetype> archetype_entries;
+	std::vector<WorldSnapshotColumn> columns;
+	for (Archetype* archetype : archetypes) {
+		const std::vector<AttributeType>& types = archetype->GetAttributeTypes();
+		WorldSnapshotArchetype entry{};
+		entry.layout = static_cast<uint32_t>(archetype->GetChunkLayout());
+		entry.column_count = static_cast<uint32_t>(types.size());
+		entry.first_column = columns.size();
+		entry.entity_count = archetype->GetEntityCount();
+		entry.entities_per_chunk = archetype->GetEntitiesPerChunk();
+		// Archetypes without attributes have no chunk data worth saving.
+		entry.chunk_count = types.empty() ? 0 : archetype->GetChunkCount();
+		for (size_t column = 0; column < types.size(); ++column) {
+			const AttributeInfo& info = archetype->GetAttributeInfo(column);
+			if (schema_indices[types[column]] == kNoSchemaIndex) {
+				const std::string& name = archetype_manager_.GetAttributeNames().at(types[column]);
+				if (!info.trivial) {
+					throw std::runtime_error("Attribute is not trivially copyable and cannot be "
+											 "saved: " + name);
+				}
+				schema_indices[types[column]] = static_cast<uint32_t>(attributes.size());
+				attributes.push_back({static_cast<uint32_t>(names.size()),
+									  static_cast<uint32_t>(name.size()),
+									  static_cast<uint32_t>(info.size),
+									  static_cast<uint32_t>(info.alignment)});
+				names.append(name);
+			}
+			entry.attributes |= uint64_t{1} << schema_indices[types[column]];
+			columns.push_back({schema_indices[types[column]], 0,
+							   archetype->GetColumnOffset(column),
+							   archetype->GetColumnStride(column)});
+		}
+		archetype_entries.push_back(entry);
+	}
+
+	std::vector<EntityID> entity_records(entity_manager_.GetRecordCount());
+	for (uint32_t index = 0; index < entity_records.size(); ++index) {
+		entity_records[index] = entity_manager_.GetRecordEntity(index);
+	}
+
+	// Lay out the file.
+	WorldSnapshotHeader header{};
+	std::memcpy(header.magic, kWorldSnapshotMagic, sizeof(header.magic));
+	header.version = kWorldSnapshotVersion;
+	header.byte_order_mark = kWorldSnapshotByteOrderMark;
+	header.chunk_size = kChunkSize;
+	header.attribute_count = static_cast<uint32_t>(attributes.size());
+	header.archetype_count = static_cast<uint32_t>(archetype_entries.size());
+	header.entity_record_count = static_cast<uint32_t>(entity_records.size());
+	header.entity_free_head = entity_manager_.GetFreeHead();
+	header.entity_free_count = entity_manager_.GetFreeCount();
+	uint64_t offset = sizeof(WorldSnapshotHeader);
+	header.attributes_offset = offset;
+	offset += attributes.size() * sizeof(WorldSnapshotAttribute);
+	header.archetypes_offset = offset;
+	offset += archetype_entries.size() * sizeof(WorldSnapshotArchetype);
+	header.columns_offset = offset;
+	offset += columns.size() * sizeof(WorldSnapshotColumn);
+	header.entity_records_offset = offset;
+	offset += entity_records.size() * sizeof(EntityID);
+	header.names_offset = offset;
+	offset += names.size();
+	offset = AlignUp(offset, alignof(EntityID));
+	for (WorldSnapshotArchetype& entry : archetype_entries) {
+		entry.entities_offset = offset;
+		offset += entry.entity_count * sizeof(EntityID);
+	}
+	offset = AlignUp(offset, kWorldSnapshotChunkAlignment);
+	for (WorldSnapshotArchetype& entry : archetype_entries) {
+		entry.chunks_offset = offset;
+		offset += entry.chunk_count * kChunkSize;
+	}
+	header.file_size = offset;
+
+	std::ofstream file(path, std::ios::binary | std::ios::trunc);
+	if (!file) {
+		throw std::runtime_error("Failed to open world snapshot for writing: " + path);
+	}
+	offset = 0;
+	WriteArray(file, offset, std::span<const WorldSnapshotHeader>(&header, 1));
+	WriteArray(file, offset, std::span<const WorldSnapshotAttribute>(attributes));
+	WriteArray(file, offset, std::span<const WorldSnapshotArchetype>(archetype_entries));
+	WriteArray(file, offset, std::span<const WorldSnapshotColumn>(columns));
+	WriteArray(file, offset, std::span<const EntityID>(entity_records));
+	WriteArray(file, offset, std::span<const char>(names));
+	for (size_t i = 0; i < archetypes.size(); ++i) {
+		WritePadding(file, offset, archetype_entries[i].entities_offset);
+		WriteArray(file, offset, std::span<const EntityID>(archetypes[i]->GetEntities()));
+	}
+	for (size_t i = 0; i < archetypes.size(); ++i) {
+		WritePadding(file, offset, archetype_entries[i].chunks_offset);
+		for (size_t chunk = 0; chunk < archetype_entries[i].chunk_count; ++chunk) {
+			WriteArray(file, offset,
+					   std::span<const uint8_t>(archetypes[i]->GetChunk(chunk).data, kChunkSize));
+		}
+	}
+	if (!file) {
+		throw std::runtime_error("Failed to write world snapshot: " + path);
+	}
+}
+
+void ECSManager::LoadWorld(const std::string& path) {
+	if (deferring_) {
+		throw std::runtime_error("The world cannot be loaded while systems run.");
+	}
+	if (entity_manager_.GetRecordCount() != 0) {
+		throw std::runtime_error("Worlds can only be loaded into an empty world.");
+	}
+
+	SnapshotFile file(path);
+	const WorldSnapshotHeader& header = file.GetArray<WorldSnapshotHeader>(0, 1)[0];
+	if (std::memcmp(header.magic, kWorldSnapshotMagic, sizeof(header.magic)) != 0 ||
+		header.byte_order_mark != kWorldSnapshotByteOrderMark) {
+		throw std::runtime_error("Not a world snapshot: " + path);
+	}
+	if (header.version != kWorldSnapshotVersion) {
+		throw std::runtime_error("Unsupported world snapshot version: " + path);
+	}
+	if (header.file_size != file.GetSize() || header.attribute_count > kMaxAttributes ||
+		header.chunk_size == 0) {
+		throw std::runtime_error("Invalid world snapshot: " + path);
+	}
+
+	// Map the saved schema onto the registered attribute types.
+	std::unordered_map<std::string_view, AttributeType> name_to_type;
+	for (const auto& [type, name] : archetype_manager_.GetAttributeNames()) {
+		name_to_type.emplace(name, type);
+	}
+	std::span<const WorldSnapshotAttribute> attributes =
+			file.GetArray<WorldSnapshotAttribute>(header.attributes_offset, header.attribute_count);
+	std::vector<AttributeType> schema_types;
+	for (const WorldSnapshotAttribute& attribute : attributes) {
+		std::span<const char> name_chars = file.GetArray<char>(
+				header.names_offset + attribute.name_offset, attribute.name_length);
+		std::string_view name(name_chars.data(), name_chars.size());
+		auto it = name_to_type.find(name);
+		if (it == name_to_type.end()) {
+			throw std::runtime_error("Attribute of the world snapshot is not registered: " +
+									 std::string(name));
+		}
+		const AttributeInfo& info = *archetype_manager_.GetAttributeInfos().at(it->second);
+		if (info.size != attribute.size || info.alignment != attribute.alignment || !info.trivial) {
+			throw std::runtime_error("Attribute changed since the world snapshot was saved: " +
+									 std::string(name));
+		}
+		schema_types.push_back(it->second);
+	}
+
+	// Check everything before touching the world, so a bad file leaves it empty.
+	std::span<const EntityID> entity_records =
+			file.GetArray<EntityID>(header.entity_records_offset, header.entity_record_count);
+	std::span<const WorldSnapshotArchetype> archetypes =
+			file.GetArray<WorldSnapshotArchetype>(header.archetypes_offset, header.archetype_count);
+	std::vector<ArchetypeSignature> signatures;
+	// Entities already listed by an archetype; each must be listed once.
+	std::vector<bool> listed_entities(entity_records.size(), false);
+	for (const WorldSnapshotArchetype& entry : archetypes) {
+		ArchetypeSignature signature;
+		for (size_t index = 0; index < schema_types.size(); ++index) {
+			if (entry.attributes & (uint64_t{1} << index)) {
+				signature.set(schema_types[index]);
+			}
+		}
+		std::span<const WorldSnapshotColumn> columns =
+				file.GetArray<WorldSnapshotColumn>(header.columns_offset +
+												   entry.first_column * sizeof(WorldSnapshotColumn),
+												   entry.column_count);
+		if (entry.column_count != signature.count() || entry.entities_per_chunk == 0 ||
+			(entry.column_count > 0 &&
+			 (entry.entities_per_chunk > header.chunk_size ||
+			  entry.chunk_count != (entry.entity_count + entry.entities_per_chunk - 1) /
+										   entry.entities_per_chunk))) {
+			throw std::runtime_error("Invalid world snapshot: archetype mismatch.");
+		}
+		// Every attribute of the archetype needs exactly one column, as the entities are added
+		// without constructing their attributes.
+		uint64_t column_attributes = 0;
+		for (const WorldSnapshotColumn& column : columns) {
+			if (column.attribute >= schema_types.size()) {
+				throw std::runtime_error("Invalid world snapshot: column out of bounds.");
+			}
+			uint64_t attribute_bit = uint64_t{1} << column.attribute;
+			if (!(entry.attributes & attribute_bit) || (column_attributes & attribute_bit)) {
+				throw std::runtime_error("Invalid world snapshot: column attribute mismatch.");
+			}
+			column_attributes |= attribute_bit;
+			if (column.offset > header.chunk_size || column.stride > header.chunk_size ||
+				column.offset + (entry.entities_per_chunk - 1) * column.stride +
+								attributes[column.attribute].size > header.chunk_size) {
+				throw std::runtime_error("Invalid world snapshot: column out of bounds.");
+			}
+		}
+		for (EntityID entity : file.GetArray<EntityID>(entry.entities_offset, entry.entity_count)) {
+			uint32_t index = ToEntityIndex(entity);
+			if (index >= entity_records.size() || entity_records[index] != entity) {
+				throw std::runtime_error("Invalid world snapshot: unknown entity.");
+			}
+			if (listed_entities[index]) {
+				throw std::runtime_error("Invalid world snapshot: entity listed twice.");
+			}
+			listed_entities[index] = true;
+		}
+		file.GetArray<uint8_t>(entry.chunks_offset, entry.chunk_count * header.chunk_size);
+		signatures.push_back(signature);
+	}
+
+	entity_manager_.Restore(entity_records, header.entity_free_head, header.entity_free_count);
+	for (size_t i = 0; i < archetypes.size(); ++i) {
+		const WorldSnapshotArchetype& entry = archetypes[i];
+		std::span<const EntityID> saved_entities =
+				file.GetArray<EntityID>(entry.entities_offset, entry.entity_count);
+		std::vector<EntityID> entity_ids(saved_entities.begin(), saved_entities.end());
+		for (EntityID entity : entity_ids) {
+			entity_manager_.SetEntitySignature(entity, signatures[i]);
+		}
+		auto [archetype_ref, first_index] =
+				archetype_manager_.AddEntities(entity_ids, signatures[i], false);
+		Archetype& archetype = archetype_ref.get();
+
+		std::span<const WorldSnapshotColumn> columns =
+				file.GetArray<WorldSnapshotColumn>(header.columns_offset +
+												   entry.first_column * sizeof(WorldSnapshotColumn),
+												   entry.column_count);
+		std::span<const uint8_t> chunks =
+				file.GetArray<uint8_t>(entry.chunks_offset, entry.chunk_count * header.chunk_size);
+		// Chunks can be copied whole if the archetype was empty and lays out its chunks like the
+		// saved one.
+		bool same_layout = first_index == 0 && header.chunk_size == kChunkSize &&
+						   entry.entities_per_chunk == archetype.GetEntitiesPerChunk();
+		std::vector<size_t> target_columns;
+		for (const WorldSnapshotColumn& column : columns) {
+			size_t target = archetype.GetColumnIndex(schema_types[column.attribute]);
+			same_layout = same_layout && column.offset == archetype.GetColumnOffset(target) &&
+						  column.stride == archetype.GetColumnStride(target);
+			target_columns.push_back(target);
+		}
+		if (same_layout) {
+			for (size_t chunk = 0; chunk < entry.chunk_count; ++chunk) {
+				std::memcpy(archetype.GetChunk(chunk).data, chunks.data() + chunk * kChunkSize,
+							kChunkSize);
+			}
+		} else {
+			for (size_t c = 0; c < columns.size(); ++c) {
+				const WorldSnapshotColumn& column = columns[c];
+				size_t size = attributes[column.attribute].size;
+				for (size_t index = 0; index < entry.entity_count; ++index) {
+					const uint8_t* source = chunks.data() +
+											index / entry.entities_per_chunk * header.chunk_size +
+											column.offset +
+											index % entry.entities_per_chunk * column.stride;
+					std::memcpy(archetype.GetAttributeData(first_index + index, target_columns[c]),
+								source, size);
+				}
+			}
+		}
+		event_manager_.RecordAttributeEvents(AttributeEvent::kAdd, signatures[i],
+											 entity_ids.data(), entity_ids.size());
+	}
+}
+} // namespace core::ecs
@@ -0,0 +1,95 @@
+#ifndef CORE_WORLD_SNAPSHOT_H
+#define CORE_WORLD_SNAPSHOT_H
+
+#include <cstddef>
+#include <cstdint>
+
+#include "types.h"
+
+namespace core::ecs {
+
+// On-disk format of the world snapshots written by ECSManager::SaveWorld. Integers are stored in
+// the byte order of the machine that wrote the file, and offsets are counted from its start:
+//
+//   WorldSnapshotHeader
+//   WorldSnapshotAttribute[attribute_count]   schema of the saved attribute types
+//   WorldSnapshotArchetype[archetype_count]
+//   WorldSnapshotColumn[...]                  columns of every archetype, one run per archetype
+//   EntityID[entity_record_count]             entity table, free records included
+//   char[...]                                 attribute names, without terminators
+//   EntityID[...]                             entities of every archetype, in row order
+//   chunk data                                chunk_size bytes per chunk, page aligned
+//
+// Chunks are stored byte for byte, so when the attribute layouts of the loading build match the
+// saved ones every chunk is restored with a single copy. Otherwise the columns are copied entity
+// by entity using the saved offsets and strides.
+
+// First bytes of every snapshot file.
+static constexpr char kWorldSnapshotMagic[8] = {'S', 'A', 'B', 'L', 'W', 'R', 'L', 'D'};
+// Bumped whenever the format changes. Files of other versions are rejected. Version 1 named the
+// attribute types after typeid.
+static constexpr uint32_t kWorldSnapshotVersion = 2;
+// Written as is, so files written on a machine with another byte order can be told apart.
+static constexpr uint32_t kWorldSnapshotByteOrderMark = 0x01020304;
+// Alignment of the chunk data within the file, so the chunks of a mapped file are page aligned.
+static constexpr uint64_t kWorldSnapshotChunkAlignment = 4096;
+
+static_assert(kMaxAttributes <= 64, "Archetype attributes are saved as a 64-bit mask.");
+
+struct WorldSnapshotHeader {
+	char magic[8];
+	uint32_t version;
+	uint32_t byte_order_mark;
+	// Chunk size of the build that wrote the file.
+	uint64_t chunk_size;
+	uint64_t file_size;
+	uint32_t attribute_count;
+	uint32_t archetype_count;
+	uint32_t entity_record_count;
+	// Free list of the entity table, see EntityManager::Restore.
+	uint32_t entity_free_head;
+	uint64_t entity_free_count;
+	uint64_t attributes_offset;
+	uint64_t archetypes_offset;
+	uint64_t columns_offset;
+	uint64_t entity_records_offset;
+	uint64_t names_offset;
+};
+
+// Attribute type of the saved schema. Attribute types are matched on load by the name they were
+// registered with, as their identifiers may differ between runs.
+struct WorldSnapshotAttribute {
+	// Position of the name within the name block, and its length.
+	uint32_t name_offset;
+	uint32_t name_length;
+	uint32_t size;
+	uint32_t alignment;
+};
+
+struct WorldSnapshotArchetype {
+	// Attribute types of the archetype, as a bit mask over the indices of the saved schema.
+	uint64_t attributes;
+	// ChunkLayout of the archetype.
+	uint32_t layout;
+	uint32_t column_count;
+	// Index of the first column of the archetype in the column table.
+	uint64_t first_column;
+	uint64_t entity_count;
+	uint64_t entities_per_chunk;
+	uint64_t chunk_count;
+	uint64_t entities_offset;
+	// Offset of the first chunk. The chunks of an archetype are stored back to back.
+	uint64_t chunks_offset;
+};
+
+struct WorldSnapshotColumn {
+	// Index of the attribute type in the saved schema.
+	uint32_t attribute;
+	uint32_t reserved;
+	// Offset of the column from the start of a chunk, and distance between two entities.
+	uint64_t offset;
+	uint64_t stride;
+};
+} // namespace core::ecs
+
+#endif // CORE_WORLD_SNAPSHOT_H
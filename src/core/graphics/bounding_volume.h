@@ -0,0 +1,59 @@
+#ifndef CORE_GRAPHICS_BOUNDING_VOLUME_H
+#define CORE_GRAPHICS_BOUNDING_VOLUME_H
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <vector>
+
+#include "vertex.h"
+
+namespace core::graphics {
+
+// Axis aligned box and bounding sphere of a mesh or a model, in its own space. The sphere is
+// centered on the box.
+struct BoundingVolume {
+	glm::vec3 min = glm::vec3(0.0f);
+	glm::vec3 max = glm::vec3(0.0f);
+	glm::vec3 center = glm::vec3(0.0f);
+	float radius = 0.0f;
+};
+
+// Computes the box of the vertices and the smallest sphere centered on the box containing them.
+// Returns an empty volume at the origin if there are no vertices.
+inline BoundingVolume ComputeBoundingVolume(const std::vector<Vertex>& vertices) {
+	BoundingVolume volume;
+	if (vertices.empty()) {
+		return volume;
+	}
+	volume.min = glm::vec3(vertices[0].position);
+	volume.max = volume.min;
+	for (const Vertex& vertex : vertices) {
+		volume.min = glm::min(volume.min, glm::vec3(vertex.position));
+		volume.max = glm::max(volume.max, glm::vec3(vertex.position));
+	}
+	volume.center = (volume.min + volume.max) * 0.5f;
+	// Tighter than half the diagonal of the box for most meshes.
+	float squared_radius = 0.0f;
+	for (const Vertex& vertex : vertices) {
+		glm::vec3 offset = glm::vec3(vertex.position) - volume.center;
+		squared_radius = std::max(squared_radius, glm::dot(offset, offset));
+	}
+	volume.radius = glm::sqrt(squared_radius);
+	return volume;
+}
+
+// Returns the volume enclosing both volumes. The sphere is centered on the merged box and
+// encloses both spheres.
+inline BoundingVolume MergeBoundingVolumes(const BoundingVolume& a, const BoundingVolume& b) {
+	BoundingVolume merged;
+	merged.min = glm::min(a.min, b.min);
+	merged.max = glm::max(a.max, b.max);
+	merged.center = (merged.min + merged.max) * 0.5f;
+	merged.radius = std::max(glm::length(a.center - merged.center) + a.radius,
+							 glm::length(b.center - merged.center) + b.radius);
+	return merged;
+}
+} // namespace core::graphics
+
+#endif // CORE_GRAPHICS_BOUNDING_VOLUME_H
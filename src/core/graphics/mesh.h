@@ -4,6 +4,7 @@
 #include <cstddef>
 #include <vector>
 
+#include "bounding_volume.h"
 #include "vertex.h"
 
 namespace core::graphics {
@@ -14,6 +15,8 @@ struct Mesh {
 	unsigned int faces_count;
 	std::vector<Vertex> vertices;
 	std::vector <unsigned int> indices;
+	// Bounds of the vertices, in the space of the mesh.
+	BoundingVolume bounds;
 };
 } // namespace core::graphics
 
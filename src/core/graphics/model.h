@@ -6,6 +6,7 @@
 #include <cstddef>
 #include <vector>
 
+#include "bounding_volume.h"
 #include "material.h"
 #include "mesh.h"
 
@@ -22,7 +23,8 @@ struct Model {
 	std::vector<MeshInstance> mesh_instances;
 	std::vector<Mesh> meshes;
 	std::vector<Material> materials;
-
+	// Bounds of the meshes drawn by the mesh instances, in the space of the model.
+	BoundingVolume bounds;
 };
 } // namespace core::graphics
 
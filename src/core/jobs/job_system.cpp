@@ -0,0 +1,155 @@
+#include "job_system.h"
+
+#include <utility>
+
+namespace core::jobs {
+
+namespace {
+
+// Index of the worker running on the current thread, or kNotAWorker.
+constexpr size_t kNotAWorker = static_cast<size_t>(-1);
+thread_local size_t current_worker_index = kNotAWorker;
+// Job system owning the current worker thread.
+thread_local const JobSystem* current_job_system = nullptr;
+} // namespace
+
+JobSystem::JobSystem(size_t worker_count) {
+	queues_.reserve(worker_count);
+	for (size_t i = 0; i < worker_count; ++i) {
+		queues_.push_back(std::make_unique<WorkerQueue>());
+	}
+	workers_.reserve(worker_count);
+	for (size_t i = 0; i < worker_count; ++i) {
+		workers_.emplace_back(&JobSystem::WorkerLoop, this, i);
+	}
+}
+
+JobSystem::~JobSystem() {
+	{
+		std::lock_guard<std::mutex> lock(sleep_mutex_);
+		stopping_ = true;
+	}
+	wake_condition_.notify_all();
+	for (std::thread& worker : workers_) {
+		worker.join();
+	}
+}
+
+size_t JobSystem::GetDefaultWorkerCount() {
+	size_t hardware_threads = std::thread::hardware_concurrency();
+	return hardware_threads > 1 ? hardware_threads - 1 : 0;
+}
+
+void JobSystem::Schedule(Job job, JobCounter& counter) {
+	counter.pending_.fetch_add(1, std::memory_order_relaxed);
+	if (workers_.empty()) {
+		// Nobody to hand the job to, run it right away.
+		Task task{std::move(job), &counter};
+		RunTask(task);
+		return;
+	}
+
+	// Workers push to their own queue, other threads spread jobs over all the queues.
+	size_t queue_index = current_job_system == this
+			? current_worker_index
+			: next_queue_.fetch_add(1, std::memory_order_relaxed) % queues_.size();
+	{
+		WorkerQueue& queue = *queues_[queue_index];
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		queue.tasks.push_back({std::move(job), &counter});
+	}
+	queued_tasks_.fetch_add(1, std::memory_order_release);
+
+	// Taking the lock ensures a worker checking the queue size is either done waiting or will see
+	// the new task.
+	{
+		std::lock_guard<std::mutex> lock(sleep_mutex_);
+	}
+	wake_condition_.notify_one();
+}
+
+void JobSystem::Wait(JobCounter& counter) {
+	size_t worker_index = current_job_system == this ? current_worker_index : queues_.size();
+	while (!counter.IsDone()) {
+		Task task;
+		if (TryGetTask(worker_index, task)) {
+			RunTask(task);
+		} else {
+			std::this_thread::yield();
+		}
+	}
+
+	std::lock_guard<std::mutex> lock(counter.error_mutex_);
+	if (counter.error_) {
+		std::exception_ptr error = std::exchange(counter.error_, nullptr);
+		std::rethrow_exception(error);
+	}
+}
+
+void JobSystem::WorkerLoop(size_t worker_index) {
+	current_worker_index = worker_index;
+	current_job_system = this;
+
+	while (true) {
+		Task task;
+		if (TryGetTask(worker_index, task)) {
+			RunTask(task);
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock(sleep_mutex_);
+		wake_condition_.wait(lock, [this]() {
+			return stopping_ || queued_tasks_.load(std::memory_order_acquire) > 0;
+		});
+		if (stopping_) {
+			return;
+		}
+	}
+}
+
+bool JobSystem::TryGetTask(size_t worker_index, Task& task) {
+	if (queued_tasks_.load(std::memory_order_acquire) == 0) {
+		return false;
+	}
+
+	// Own queue first, newest task first since its data is most likely still in cache.
+	if (worker_index < queues_.size()) {
+		WorkerQueue& queue = *queues_[worker_index];
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		if (!queue.tasks.empty()) {
+			task = std::move(queue.tasks.back());
+			queue.tasks.pop_back();
+			queued_tasks_.fetch_sub(1, std::memory_order_relaxed);
+			return true;
+		}
+	}
+
+	// Steal the oldest task of another queue.
+	size_t queue_count = queues_.size();
+	size_t start = worker_index < queue_count ? worker_index + 1 : 0;
+	for (size_t i = 0; i < queue_count; ++i) {
+		WorkerQueue& queue = *queues_[(start + i) % queue_count];
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		if (!queue.tasks.empty()) {
+			task = std::move(queue.tasks.front());
+			queue.tasks.pop_front();
+			queued_tasks_.fetch_sub(1, std::memory_order_relaxed);
+			return true;
+		}
+	}
+	return false;
+}
+
+void JobSystem::RunTask(Task& task) {
+	JobCounter& counter = *task.counter;
+	try {
+		task.job();
+	} catch (...) {
+		std::lock_guard<std::mutex> lock(counter.error_mutex_);
+		if (!counter.error_) {
+			counter.error_ = std::current_exception();
+		}
+	}
+	counter.pending_.fetch_sub(1, std::memory_order_acq_rel);
+}
+} // namespace core::jobs
@@ -0,0 +1,118 @@
+#ifndef CORE_JOBS_JOB_SYSTEM_H
+#define CORE_JOBS_JOB_SYSTEM_H
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace core::jobs {
+
+// Unit of work executed by the JobSystem.
+using Job = std::function<void()>;
+
+// Tracks a group of scheduled jobs. Passed to JobSystem::Schedule and JobSystem::Wait.
+class JobCounter {
+public:
+	JobCounter() = default;
+	JobCounter(const JobCounter&) = delete;
+	JobCounter& operator=(const JobCounter&) = delete;
+
+	// Checks if all the jobs scheduled with this counter have finished.
+	inline bool IsDone() const { return pending_.load(std::memory_order_acquire) == 0; }
+
+private:
+	friend class JobSystem;
+
+	// Number of scheduled jobs that have not finished yet.
+	std::atomic<size_t> pending_ = 0;
+	// First exception thrown by one of the jobs. Rethrown by JobSystem::Wait.
+	std::exception_ptr error_;
+	std::mutex error_mutex_;
+};
+
+// Fixed pool of worker threads executing jobs. Every worker owns a deque: it pops its own jobs
+// from the back and, once it runs dry, steals from the front of the other workers' deques.
+// Threads waiting on a counter help by running jobs instead of blocking.
+class JobSystem {
+public:
+	// Returns the shared job system, using one worker per hardware thread besides the main one.
+	static JobSystem& GetInstance() {
+		static JobSystem instance(GetDefaultWorkerCount());
+		return instance;
+	}
+
+	// Starts worker_count worker threads. With no workers, jobs run on the thread that waits for
+	// them.
+	explicit JobSystem(size_t worker_count);
+	~JobSystem();
+
+	JobSystem(const JobSystem&) = delete;
+	JobSystem& operator=(const JobSystem&) = delete;
+
+	// Schedules a job. The counter must outlive the job and is usually waited on with Wait.
+	void Schedule(Job job, JobCounter& counter);
+	// Runs pending jobs until all the jobs of the counter have finished. Rethrows the first
+	// exception thrown by one of them.
+	void Wait(JobCounter& counter);
+
+	// Splits [0, count) into ranges of at most grain_size elements, calls func(begin, end) for each
+	// of them in parallel and waits for all of them to finish.
+	template <typename Func>
+	void ParallelFor(size_t count, size_t grain_size, Func&& func) {
+		grain_size = std::max<size_t>(grain_size, 1);
+		JobCounter counter;
+		for (size_t begin = 0; begin < count; begin += grain_size) {
+			size_t end = std::min(begin + grain_size, count);
+			Schedule([&func, begin, end]() { func(begin, end); }, counter);
+		}
+		Wait(counter);
+	}
+
+	// Returns the number of worker threads.
+	inline size_t GetWorkerCount() const { return workers_.size(); }
+	// Returns the number of workers used by the shared instance.
+	static size_t GetDefaultWorkerCount();
+
+private:
+	struct Task {
+		Job job;
+		JobCounter* counter;
+	};
+
+	// Deque of tasks owned by a worker. Guarded by a mutex; contention is limited to steals.
+	struct WorkerQueue {
+		std::mutex mutex;
+		std::deque<Task> tasks;
+	};
+
+	// Main loop of a worker thread.
+	void WorkerLoop(size_t worker_index);
+	// Pops a task from the queue of the given worker, or steals one from the others. Threads that
+	// are not workers pass the number of workers and only steal.
+	bool TryGetTask(size_t worker_index, Task& task);
+	// Runs a task and signals its counter.
+	void RunTask(Task& task);
+
+private:
+	std::vector<std::unique_ptr<WorkerQueue>> queues_;
+	std::vector<std::thread> workers_;
+
+	// Number of tasks sitting in the queues. Idle workers sleep while it is zero.
+	std::atomic<size_t> queued_tasks_ = 0;
+	// Round-robin target for jobs scheduled by threads that are not workers.
+	std::atomic<size_t> next_queue_ = 0;
+	std::mutex sleep_mutex_;
+	std::condition_variable wake_condition_;
+	bool stopping_ = false;
+};
+} // namespace core::jobs
+
+#endif // CORE_JOBS_JOB_SYSTEM_H
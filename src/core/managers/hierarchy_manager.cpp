@@ -0,0 +1,217 @@
+#include "hierarchy_manager.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+#include "core/attributes/hierarchy.h"
+#include "core/attributes/transform.h"
+#include "core/attributes/world_matrix.h"
+
+namespace core::managers {
+
+HierarchyManager::HierarchyManager() {
+	auto on_changed = [this](std::span<const ecs::EntityID> entities) {
+		OnHierarchyChanged(entities);
+	};
+	ecs_manager_.Observe<attributes::Hierarchy>(ecs::AttributeEvent::kAdd, on_changed);
+	ecs_manager_.Observe<attributes::Hierarchy>(ecs::AttributeEvent::kSet, on_changed);
+	ecs_manager_.Observe<attributes::Hierarchy>(
+			ecs::AttributeEvent::kRemove,
+			[this](std::span<const ecs::EntityID> entities) { OnHierarchyRemoved(entities); });
+}
+
+void HierarchyManager::SetParent(ecs::EntityID child, ecs::EntityID parent) {
+	if (child == parent) {
+		throw std::runtime_error("An entity cannot be its own parent.");
+	}
+	Reparent(child, parent);
+	WriteAttribute(child, parent);
+}
+
+void HierarchyManager::Remove(ecs::EntityID entity) {
+	if (FindIndex(entity) == kNoIndex) {
+		return;
+	}
+	// As a root, the subtree of the entity is the tail of the arrays and has no ancestors.
+	Reparent(entity, ecs::kNullEntity);
+	uint32_t index = FindIndex(entity);
+
+	for (uint32_t i = index + 1; i < entities_.size(); ++i) {
+		if (parent_indices_[i] == index) {
+			parent_indices_[i] = kNoIndex;
+			if (ecs_manager_.HasAttribute<attributes::Hierarchy>(entities_[i])) {
+				ecs_manager_.GetAttribute<attributes::Hierarchy>(entities_[i]).parent_id =
+						ecs::kNullEntity;
+			}
+		}
+	}
+
+	entities_.erase(entities_.begin() + index);
+	parent_indices_.erase(parent_indices_.begin() + index);
+	subtree_sizes_.erase(subtree_sizes_.begin() + index);
+	world_matrices_.erase(world_matrices_.begin() + index);
+	for (uint32_t i = index; i < entities_.size(); ++i) {
+		if (parent_indices_[i] != kNoIndex && parent_indices_[i] > index) {
+			--parent_indices_[i];
+		}
+		entity_to_index_[ecs::ToEntityIndex(entities_[i])] = i;
+	}
+	entity_to_index_[ecs::ToEntityIndex(entity)] = kNoIndex;
+}
+
+ecs::EntityID HierarchyManager::GetParent(ecs::EntityID entity) const {
+	uint32_t index = FindIndex(entity);
+	if (index == kNoIndex || parent_indices_[index] == kNoIndex) {
+		return ecs::kNullEntity;
+	}
+	return entities_[parent_indices_[index]];
+}
+
+void HierarchyManager::PropagateTransforms() {
+	ecs::ArchetypeManager& archetype_manager = ecs_manager_.GetArchetypeManager();
+	ecs::AttributeType transform_type = ecs::GetAttributeTypeId<attributes::Transform>();
+	ecs::AttributeType world_matrix_type = ecs::GetAttributeTypeId<attributes::WorldMatrix>();
+
+	for (size_t i = 0; i < entities_.size(); ++i) {
+		const auto* transform = static_cast<const attributes::Transform*>(
+				archetype_manager.FindAttribute(entities_[i], transform_type));
+		glm::mat4 local = transform != nullptr ? transform->GetModelMatrix() : glm::mat4(1.0f);
+		// Parents come first, so their world matrix is already up to date.
+		uint32_t parent = parent_indices_[i];
+		world_matrices_[i] = parent == kNoIndex ? local : world_matrices_[parent] * local;
+
+		auto* world_matrix = static_cast<attributes::WorldMatrix*>(
+				archetype_manager.GetAttribute(entities_[i], world_matrix_type));
+		if (world_matrix != nullptr) {
+			world_matrix->matrix = world_matrices_[i];
+		}
+	}
+}
+
+uint32_t HierarchyManager::GetOrAddIndex(ecs::EntityID entity) {
+	uint32_t index = FindIndex(entity);
+	if (index != kNoIndex) {
+		return index;
+	}
+	index = static_cast<uint32_t>(entities_.size());
+	entities_.push_back(entity);
+	parent_indices_.push_back(kNoIndex);
+	subtree_sizes_.push_back(1);
+	world_matrices_.emplace_back(1.0f);
+
+	uint32_t entity_index = ecs::ToEntityIndex(entity);
+	if (entity_index >= entity_to_index_.size()) {
+		entity_to_index_.resize(entity_index + 1, kNoIndex);
+	}
+	entity_to_index_[entity_index] = index;
+	return index;
+}
+
+void HierarchyManager::Reparent(ecs::EntityID child, ecs::EntityID parent) {
+	uint32_t begin = GetOrAddIndex(child);
+	uint32_t parent_index = kNoIndex;
+	if (parent != ecs::kNullEntity) {
+		// Adding the parent appends it as a root, which leaves the child in place. It gets a
+		// Hierarchy attribute as well, so that destroying it detaches its children.
+		if (FindIndex(parent) == kNoIndex &&
+			!ecs_manager_.HasAttribute<attributes::Hierarchy>(parent)) {
+			WriteAttribute(parent, ecs::kNullEntity);
+		}
+		parent_index = GetOrAddIndex(parent);
+	}
+	uint32_t old_parent_index = parent_indices_[begin];
+	if (old_parent_index == parent_index) {
+		return;
+	}
+	uint32_t size = subtree_sizes_[begin];
+	uint32_t end = begin + size;
+	if (parent_index != kNoIndex && parent_index >= begin && parent_index < end) {
+		throw std::runtime_error("An entity cannot be parented to one of its descendants.");
+	}
+
+	// The subtree goes right after the last descendant of the new parent, or last for roots.
+	uint32_t target = parent_index == kNoIndex
+							  ? static_cast<uint32_t>(entities_.size())
+							  : parent_index + subtree_sizes_[parent_index];
+	if (old_parent_index != kNoIndex) {
+		AddToSubtreeSizes(old_parent_index, -static_cast<int64_t>(size));
+	}
+	// Rotate fixes up the parent index along with the others.
+	parent_indices_[begin] = parent_index;
+	uint32_t new_begin;
+	if (target >= end) {
+		Rotate(begin, end, target);
+		new_begin = target - size;
+	} else {
+		Rotate(target, begin, end);
+		new_begin = target;
+	}
+	if (parent_indices_[new_begin] != kNoIndex) {
+		AddToSubtreeSizes(parent_indices_[new_begin], size);
+	}
+}
+
+void HierarchyManager::AddToSubtreeSizes(uint32_t index, int64_t delta) {
+	while (index != kNoIndex) {
+		subtree_sizes_[index] = static_cast<uint32_t>(subtree_sizes_[index] + delta);
+		index = parent_indices_[index];
+	}
+}
+
+void HierarchyManager::Rotate(uint32_t first, uint32_t middle, uint32_t last) {
+	if (first == middle || middle == last) {
+		return;
+	}
+	std::rotate(entities_.begin() + first, entities_.begin() + middle, entities_.begin() + last);
+	std::rotate(parent_indices_.begin() + first, parent_indices_.begin() + middle,
+				parent_indices_.begin() + last);
+	std::rotate(subtree_sizes_.begin() + first, subtree_sizes_.begin() + middle,
+				subtree_sizes_.begin() + last);
+	std::rotate(world_matrices_.begin() + first, world_matrices_.begin() + middle,
+				world_matrices_.begin() + last);
+
+	// Entries before first cannot have a parent in the rotated range, as parents come first.
+	uint32_t left = middle - first;
+	uint32_t right = last - middle;
+	for (uint32_t i = first; i < parent_indices_.size(); ++i) {
+		uint32_t& parent = parent_indices_[i];
+		if (parent != kNoIndex && parent >= first && parent < last) {
+			parent = parent < middle ? parent + right : parent - left;
+		}
+	}
+	for (uint32_t i = first; i < last; ++i) {
+		entity_to_index_[ecs::ToEntityIndex(entities_[i])] = i;
+	}
+}
+
+void HierarchyManager::WriteAttribute(ecs::EntityID entity, ecs::EntityID parent) {
+	if (ecs_manager_.HasAttribute<attributes::Hierarchy>(entity)) {
+		// Written in place, the hierarchy already matches.
+		ecs_manager_.GetAttribute<attributes::Hierarchy>(entity).parent_id = parent;
+		return;
+	}
+	attributes::Hierarchy hierarchy;
+	hierarchy.parent_id = parent;
+	ecs_manager_.AddAttribute(entity, hierarchy);
+}
+
+void HierarchyManager::OnHierarchyChanged(std::span<const ecs::EntityID> entities) {
+	for (ecs::EntityID entity : entities) {
+		if (!ecs_manager_.HasAttribute<attributes::Hierarchy>(entity)) {
+			continue;
+		}
+		ecs::EntityID parent =
+				ecs_manager_.GetAttribute<const attributes::Hierarchy>(entity).parent_id;
+		if (!ecs_manager_.IsAlive(parent)) {
+			parent = ecs::kNullEntity;
+		}
+		Reparent(entity, parent);
+	}
+}
+
+void HierarchyManager::OnHierarchyRemoved(std::span<const ecs::EntityID> entities) {
+	for (ecs::EntityID entity : entities) {
+		Remove(entity);
+	}
+}
+} // namespace core::managers
@@ -1,6 +1,107 @@
 #ifndef CORE_MANAGERS_HIERARCHY_MANAGER_H
 #define CORE_MANAGERS_HIERARCHY_MANAGER_H
 
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <span>
+#include <vector>
 
+#include <glm/glm.hpp>
+
+#include "core/ecs/ecs_manager.h"
+#include "core/ecs/types.h"
+
+namespace core::managers {
+
+// Keeps the parent-child relations of entities in dense arrays sorted in depth-first order: every
+// parent comes before its children and every subtree is contiguous. Propagating transforms is
+// then a single linear pass, where the world matrix of the parent is always ready when a child is
+// reached. Reparenting rotates the moved subtree into its new place, which only touches the
+// entries between the old and the new position.
+//
+// The relations mirror the Hierarchy attribute: adding, writing (through
+// ECSManager::SetAttribute) or removing it updates the hierarchy at the next event dispatch, and
+// SetParent keeps the attribute in sync. The WorldMatrix of hierarchy entities is written by
+// PropagateTransforms; the TransformSystem leaves it alone.
+class HierarchyManager {
+public:
+	static HierarchyManager& GetInstance() {
+		static HierarchyManager instance;
+		return instance;
+	}
+
+	// Makes parent the parent of child, or child a root if parent is kNullEntity. Entities not
+	// yet in the hierarchy are added to it, and the Hierarchy attributes of both are created or
+	// updated. Throws an exception if parent is child or one of its descendants. Must not be
+	// called while systems are running; systems write the Hierarchy attribute instead.
+	void SetParent(ecs::EntityID child, ecs::EntityID parent);
+	// Removes the entity from the hierarchy. Its children become roots.
+	void Remove(ecs::EntityID entity);
+
+	// Checks if the entity is part of the hierarchy.
+	inline bool Contains(ecs::EntityID entity) const { return FindIndex(entity) != kNoIndex; }
+	// Returns the parent of the entity, or kNullEntity for roots and entities outside the
+	// hierarchy.
+	ecs::EntityID GetParent(ecs::EntityID entity) const;
+	// Returns the entities of the hierarchy in depth-first order.
+	inline std::span<const ecs::EntityID> GetEntities() const { return entities_; }
+
+	// Recomputes the WorldMatrix of every entity in the hierarchy from its Transform and the world
+	// matrix of its parent, in a single pass over the dense arrays. Entities without a Transform
+	// count as identity, entities without a WorldMatrix are skipped but still pass their world
+	// matrix on to their children.
+	void PropagateTransforms();
+
+private:
+	HierarchyManager();
+
+	static constexpr uint32_t kNoIndex = std::numeric_limits<uint32_t>::max();
+
+	// Returns the position of the entity in the dense arrays, or kNoIndex.
+	inline uint32_t FindIndex(ecs::EntityID entity) const {
+		uint32_t entity_index = ecs::ToEntityIndex(entity);
+		if (entity_index >= entity_to_index_.size()) {
+			return kNoIndex;
+		}
+		uint32_t index = entity_to_index_[entity_index];
+		return index != kNoIndex && entities_[index] == entity ? index : kNoIndex;
+	}
+	// Appends the entity as a root if it is not part of the hierarchy yet, and returns its
+	// position.
+	uint32_t GetOrAddIndex(ecs::EntityID entity);
+	// Moves the subtree of child under parent. Only touches the Hierarchy attribute of parents
+	// new to the hierarchy, which get one.
+	void Reparent(ecs::EntityID child, ecs::EntityID parent);
+	// Adds delta to the subtree size of the entry at index and of all its ancestors.
+	void AddToSubtreeSizes(uint32_t index, int64_t delta);
+	// Rotates the entries in [first, last) so that the one at middle becomes the first, and fixes
+	// up the parent indices and the entity lookup.
+	void Rotate(uint32_t first, uint32_t middle, uint32_t last);
+
+	// Writes the parent into the Hierarchy attribute of the entity, adding the attribute if
+	// necessary.
+	void WriteAttribute(ecs::EntityID entity, ecs::EntityID parent);
+	// Observers of the Hierarchy attribute. Bring the hierarchy up to date with the attributes
+	// of the entities that gained or wrote it, and drop the entities that lost it.
+	void OnHierarchyChanged(std::span<const ecs::EntityID> entities);
+	void OnHierarchyRemoved(std::span<const ecs::EntityID> entities);
+
+private:
+	// Entities in depth-first order.
+	std::vector<ecs::EntityID> entities_;
+	// Position of the parent of each entry, or kNoIndex for roots. Always lower than the position
+	// of the entry itself.
+	std::vector<uint32_t> parent_indices_;
+	// Number of entries in the subtree of each entry, itself included.
+	std::vector<uint32_t> subtree_sizes_;
+	// World matrix of each entry, computed by PropagateTransforms.
+	std::vector<glm::mat4> world_matrices_;
+	// Position in the dense arrays of every entity, indexed by entity index, or kNoIndex.
+	std::vector<uint32_t> entity_to_index_;
+
+	ecs::ECSManager& ecs_manager_ = ecs::ECSManager::GetInstance();
+};
+} // namespace core::managers
 
 #endif // CORE_MANAGERS_HIERARCHY_MANAGER_H
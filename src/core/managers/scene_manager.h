@@ -24,7 +24,7 @@ public:
 private:
 	SceneManager() = default;
 
-	ecs::EntityID main_camera_;
+	ecs::EntityID main_camera_ = ecs::kNullEntity;
 };
 } // namespace core::managers
 
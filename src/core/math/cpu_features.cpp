@@ -0,0 +1,16 @@
+#include "cpu_features.h"
+
+namespace core::math {
+
+bool HasAvx() {
+#if defined(__AVX__)
+	return true;
+#elif defined(CORE_MATH_AVX_TARGET)
+	// Also checks that the operating system saves the AVX registers.
+	static const bool has_avx = __builtin_cpu_supports("avx");
+	return has_avx;
+#else
+	return false;
+#endif
+}
+} // namespace core::math
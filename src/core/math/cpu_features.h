@@ -0,0 +1,29 @@
+#ifndef CORE_MATH_CPU_FEATURES_H
+#define CORE_MATH_CPU_FEATURES_H
+
+// CORE_MATH_AVX_TARGET is defined when AVX code can be compiled without building the whole target
+// for AVX. Functions defined between CORE_MATH_BEGIN_AVX and CORE_MATH_END_AVX are compiled for
+// AVX and may only be called after checking HasAvx.
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define CORE_MATH_AVX_TARGET
+#if defined(__clang__)
+#define CORE_MATH_BEGIN_AVX \
+	_Pragma("clang attribute push(__attribute__((target(\"avx\"))), apply_to = function)")
+#define CORE_MATH_END_AVX _Pragma("clang attribute pop")
+#else
+#define CORE_MATH_BEGIN_AVX _Pragma("GCC push_options") _Pragma("GCC target(\"avx\")")
+#define CORE_MATH_END_AVX _Pragma("GCC pop_options")
+#endif
+#elif defined(__AVX__)
+#define CORE_MATH_AVX_TARGET
+#define CORE_MATH_BEGIN_AVX
+#define CORE_MATH_END_AVX
+#endif
+
+namespace core::math {
+
+// Checks if the processor running the program supports AVX. The result is computed once.
+bool HasAvx();
+} // namespace core::math
+
+#endif // CORE_MATH_CPU_FEATURES_H
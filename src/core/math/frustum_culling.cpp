@@ -0,0 +1,148 @@
+#include "frustum_culling.h"
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+
+#include <glm/glm.hpp>
+
+#include "cpu_features.h"
+
+#if defined(CORE_MATH_AVX_TARGET) || defined(__SSE2__) || defined(_M_X64) || \
+		(defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <immintrin.h>
+#endif
+
+#if defined(CORE_MATH_AVX_TARGET)
+#define CORE_MATH_USE_AVX
+#endif
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define CORE_MATH_USE_SSE
+#endif
+
+namespace core::math {
+
+namespace {
+
+#if defined(CORE_MATH_USE_AVX)
+
+// Compiled for AVX whatever the target of the build, only called when the processor has AVX.
+CORE_MATH_BEGIN_AVX
+namespace avx {
+
+#include "frustum_culling_batch.h"
+
+struct Ops {
+	using Float = __m256;
+	static constexpr size_t kWidth = 8;
+
+	static inline Float Set(float value) { return _mm256_set1_ps(value); }
+	static inline Float Load(const float* data) { return _mm256_loadu_ps(data); }
+	static inline Float Add(Float a, Float b) { return _mm256_add_ps(a, b); }
+	static inline Float Mul(Float a, Float b) { return _mm256_mul_ps(a, b); }
+	static inline Float And(Float a, Float b) { return _mm256_and_ps(a, b); }
+	static inline Float GreaterEqual(Float a, Float b) {
+		return _mm256_cmp_ps(a, b, _CMP_GE_OQ);
+	}
+	// Returns the sign bits of the lanes, lane 0 in bit 0.
+	static inline uint32_t MoveMask(Float a) {
+		return static_cast<uint32_t>(_mm256_movemask_ps(a));
+	}
+};
+
+} // namespace avx
+CORE_MATH_END_AVX
+
+#endif
+
+#if defined(CORE_MATH_USE_SSE)
+
+namespace sse {
+
+#include "frustum_culling_batch.h"
+
+struct Ops {
+	using Float = __m128;
+	static constexpr size_t kWidth = 4;
+
+	static inline Float Set(float value) { return _mm_set1_ps(value); }
+	static inline Float Load(const float* data) { return _mm_loadu_ps(data); }
+	static inline Float Add(Float a, Float b) { return _mm_add_ps(a, b); }
+	static inline Float Mul(Float a, Float b) { return _mm_mul_ps(a, b); }
+	static inline Float And(Float a, Float b) { return _mm_and_ps(a, b); }
+	static inline Float GreaterEqual(Float a, Float b) { return _mm_cmpge_ps(a, b); }
+	// Returns the sign bits of the lanes, lane 0 in bit 0.
+	static inline uint32_t MoveMask(Float a) { return static_cast<uint32_t>(_mm_movemask_ps(a)); }
+};
+
+} // namespace sse
+
+#endif
+
+using CullBatchesFunc = size_t (*)(const Frustum&, const attributes::Bounds*, size_t, uint32_t*,
+								   size_t&);
+
+// Picks the widest batch kernel the processor supports, nullptr if there is none.
+CullBatchesFunc SelectCullBatches() {
+#if defined(CORE_MATH_USE_AVX)
+	if (HasAvx()) {
+		return avx::CullBatches<avx::Ops>;
+	}
+#endif
+#if defined(CORE_MATH_USE_SSE)
+	return sse::CullBatches<sse::Ops>;
+#else
+	return nullptr;
+#endif
+}
+} // namespace
+
+Frustum ExtractFrustum(const glm::mat4& view_projection) {
+	// Rows of the matrix, glm matrices being indexed by column first.
+	glm::vec4 rows[4];
+	for (int i = 0; i < 4; ++i) {
+		rows[i] = glm::vec4(view_projection[0][i], view_projection[1][i], view_projection[2][i],
+							view_projection[3][i]);
+	}
+
+	Frustum frustum;
+	frustum.planes[0] = rows[3] + rows[0]; // Left
+	frustum.planes[1] = rows[3] - rows[0]; // Right
+	frustum.planes[2] = rows[3] + rows[1]; // Bottom
+	frustum.planes[3] = rows[3] - rows[1]; // Top
+	frustum.planes[4] = rows[3] + rows[2]; // Near
+	frustum.planes[5] = rows[3] - rows[2]; // Far
+	// Normalized so that the plane equation gives the distance compared with the radius.
+	for (glm::vec4& plane : frustum.planes) {
+		plane /= glm::length(glm::vec3(plane));
+	}
+	return frustum;
+}
+
+size_t CullSpheres(const Frustum& frustum, const attributes::Bounds* bounds, size_t count,
+				   uint32_t* visible_indices) {
+	static const CullBatchesFunc cull_batches = SelectCullBatches();
+	size_t index = 0;
+	size_t visible_count = 0;
+	if (cull_batches) {
+		index = cull_batches(frustum, bounds, count, visible_indices, visible_count);
+	}
+	for (; index < count; ++index) {
+		if (IsSphereVisible(frustum, bounds[index])) {
+			visible_indices[visible_count++] = static_cast<uint32_t>(index);
+		}
+	}
+	return visible_count;
+}
+
+size_t CullSpheresScalar(const Frustum& frustum, const attributes::Bounds* bounds, size_t count,
+						 uint32_t* visible_indices) {
+	size_t visible_count = 0;
+	for (size_t i = 0; i < count; ++i) {
+		if (IsSphereVisible(frustum, bounds[i])) {
+			visible_indices[visible_count++] = static_cast<uint32_t>(i);
+		}
+	}
+	return visible_count;
+}
+} // namespace core::math
@@ -0,0 +1,45 @@
+#ifndef CORE_MATH_FRUSTUM_CULLING_H
+#define CORE_MATH_FRUSTUM_CULLING_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+#include <glm/glm.hpp>
+
+#include "core/attributes/bounds.h"
+
+namespace core::math {
+
+// Planes of a view frustum as (normal, distance), with normals pointing inwards: a point p is on
+// the inner side of a plane when dot(normal, p) + distance >= 0.
+struct Frustum {
+	std::array<glm::vec4, 6> planes;
+};
+
+// Extracts the normalized frustum planes of an OpenGL view-projection matrix (Gribb-Hartmann).
+Frustum ExtractFrustum(const glm::mat4& view_projection);
+
+// Checks if the sphere is at least partly on the inner side of every plane of the frustum.
+inline bool IsSphereVisible(const Frustum& frustum, const attributes::Bounds& bounds) {
+	for (const glm::vec4& plane : frustum.planes) {
+		if (glm::dot(glm::vec3(plane), bounds.center) + plane.w < -bounds.radius) {
+			return false;
+		}
+	}
+	return true;
+}
+
+// Tests count bounding spheres against the frustum and writes the indices of the spheres at least
+// partly inside it to visible_indices, which must have room for count indices. Returns the number
+// of visible spheres. Processes 8 (AVX) or 4 (SSE) spheres at a time when the processor supports
+// it and falls back to the scalar version for the remainder.
+size_t CullSpheres(const Frustum& frustum, const attributes::Bounds* bounds, size_t count,
+				   uint32_t* visible_indices);
+
+// Scalar version of CullSpheres, the reference it is tested against.
+size_t CullSpheresScalar(const Frustum& frustum, const attributes::Bounds* bounds, size_t count,
+						 uint32_t* visible_indices);
+} // namespace core::math
+
+#endif // CORE_MATH_FRUSTUM_CULLING_H
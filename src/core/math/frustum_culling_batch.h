@@ -0,0 +1,55 @@
+// Batch kernels shared by the instruction sets of frustum_culling.cpp. Included once per
+// instruction set, inside its namespace and before its Ops, so that the templates are compiled
+// for that instruction set. Not a standalone header.
+
+// Tests Ops::kWidth consecutive spheres against the frustum. Returns a mask with bit i set if
+// sphere i is visible.
+template <typename Ops>
+inline uint32_t CullBatch(const Frustum& frustum, const attributes::Bounds* bounds) {
+	using Float = typename Ops::Float;
+	constexpr size_t kWidth = Ops::kWidth;
+
+	// Gather the sphere fields into lanes.
+	alignas(32) float fields[4][kWidth];
+	for (size_t lane = 0; lane < kWidth; ++lane) {
+		fields[0][lane] = bounds[lane].center.x;
+		fields[1][lane] = bounds[lane].center.y;
+		fields[2][lane] = bounds[lane].center.z;
+		fields[3][lane] = -bounds[lane].radius;
+	}
+	Float x = Ops::Load(fields[0]);
+	Float y = Ops::Load(fields[1]);
+	Float z = Ops::Load(fields[2]);
+	Float negative_radius = Ops::Load(fields[3]);
+
+	// A sphere is visible if its signed distance to every plane is at least minus its radius.
+	auto inside = [&](const glm::vec4& plane) {
+		Float distance = Ops::Add(Ops::Add(Ops::Mul(x, Ops::Set(plane.x)),
+										   Ops::Mul(y, Ops::Set(plane.y))),
+								  Ops::Add(Ops::Mul(z, Ops::Set(plane.z)), Ops::Set(plane.w)));
+		return Ops::GreaterEqual(distance, negative_radius);
+	};
+	Float visible = inside(frustum.planes[0]);
+	for (size_t i = 1; i < frustum.planes.size(); ++i) {
+		visible = Ops::And(visible, inside(frustum.planes[i]));
+	}
+	return Ops::MoveMask(visible);
+}
+
+// Tests the leading full batches of count spheres against the frustum and writes the indices of
+// the visible ones to visible_indices. Returns the number of spheres processed and sets
+// visible_count to the number of visible ones.
+template <typename Ops>
+size_t CullBatches(const Frustum& frustum, const attributes::Bounds* bounds, size_t count,
+				   uint32_t* visible_indices, size_t& visible_count) {
+	size_t index = 0;
+	visible_count = 0;
+	for (; index + Ops::kWidth <= count; index += Ops::kWidth) {
+		uint32_t mask = CullBatch<Ops>(frustum, bounds + index);
+		while (mask != 0) {
+			visible_indices[visible_count++] = static_cast<uint32_t>(index + std::countr_zero(mask));
+			mask &= mask - 1;
+		}
+	}
+	return index;
+}
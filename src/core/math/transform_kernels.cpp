@@ -0,0 +1,195 @@
+#include "transform_kernels.h"
+
+#include <cstddef>
+
+#include "cpu_features.h"
+
+#if defined(CORE_MATH_AVX_TARGET) || defined(__SSE2__) || defined(_M_X64) || \
+		(defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <immintrin.h>
+#endif
+
+#if defined(CORE_MATH_AVX_TARGET)
+#define CORE_MATH_USE_AVX
+#endif
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define CORE_MATH_USE_SSE
+#endif
+
+namespace core::math {
+
+namespace {
+
+#if defined(CORE_MATH_USE_AVX) || defined(CORE_MATH_USE_SSE)
+
+constexpr float kDegreesToRadians = 0.017453292519943295f;
+constexpr float kTwoOverPi = 0.6366197723675814f;
+// pi / 2 split in two parts so the range reduction keeps its precision (Cody-Waite).
+constexpr float kPiOverTwoHigh = 1.5707963705062866f;
+constexpr float kPiOverTwoLow = -4.371139000186243e-8f;
+// Minimax polynomial coefficients for sin and cos on [-pi / 4, pi / 4].
+constexpr float kSin1 = -1.6666654611e-1f;
+constexpr float kSin2 = 8.3321608736e-3f;
+constexpr float kSin3 = -1.9515295891e-4f;
+constexpr float kCos1 = 4.166664568298827e-2f;
+constexpr float kCos2 = -1.388731625493765e-3f;
+constexpr float kCos3 = 2.443315711809948e-5f;
+
+#endif
+
+#if defined(CORE_MATH_USE_AVX)
+
+// Compiled for AVX whatever the target of the build, only called when the processor has AVX.
+CORE_MATH_BEGIN_AVX
+namespace avx {
+
+#include "transform_kernels_batch.h"
+
+struct Ops {
+	using Float = __m256;
+	static constexpr size_t kWidth = 8;
+
+	static inline Float Set(float value) { return _mm256_set1_ps(value); }
+	static inline Float Load(const float* data) { return _mm256_loadu_ps(data); }
+	static inline Float Add(Float a, Float b) { return _mm256_add_ps(a, b); }
+	static inline Float Sub(Float a, Float b) { return _mm256_sub_ps(a, b); }
+	static inline Float Mul(Float a, Float b) { return _mm256_mul_ps(a, b); }
+	static inline Float Negate(Float a) { return _mm256_xor_ps(a, _mm256_set1_ps(-0.0f)); }
+
+	static inline void SinCos(Float x, Float& sin_x, Float& cos_x) {
+		// Quadrant arithmetic is done in floating point since AVX lacks 256-bit integer ops.
+		Float j = _mm256_round_ps(Mul(x, Set(kTwoOverPi)),
+								  _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+		Float y = Sub(x, Mul(j, Set(kPiOverTwoHigh)));
+		y = Sub(y, Mul(j, Set(kPiOverTwoLow)));
+
+		Float sin_poly, cos_poly;
+		SinCosPolynomials<Ops>(y, sin_poly, cos_poly);
+
+		Float quadrant = Sub(j, Mul(Set(4.0f), _mm256_floor_ps(Mul(j, Set(0.25f)))));
+		Float is_one = _mm256_cmp_ps(quadrant, Set(1.0f), _CMP_EQ_OQ);
+		Float is_two = _mm256_cmp_ps(quadrant, Set(2.0f), _CMP_EQ_OQ);
+		Float is_three = _mm256_cmp_ps(quadrant, Set(3.0f), _CMP_EQ_OQ);
+		Float swap = _mm256_or_ps(is_one, is_three);
+		Float sin_sign = _mm256_and_ps(_mm256_or_ps(is_two, is_three), Set(-0.0f));
+		Float cos_sign = _mm256_and_ps(_mm256_or_ps(is_one, is_two), Set(-0.0f));
+
+		// Selected with masks, GCC turns blendv on comparison results into branches without AVX2.
+		Float sin_value = _mm256_or_ps(_mm256_and_ps(swap, cos_poly),
+									   _mm256_andnot_ps(swap, sin_poly));
+		Float cos_value = _mm256_or_ps(_mm256_and_ps(swap, sin_poly),
+									   _mm256_andnot_ps(swap, cos_poly));
+		sin_x = _mm256_xor_ps(sin_value, sin_sign);
+		cos_x = _mm256_xor_ps(cos_value, cos_sign);
+	}
+
+	// Writes column j of kWidth consecutive matrices given each row of the column across lanes.
+	static inline void StoreColumn(attributes::WorldMatrix* out, int j, Float x, Float y, Float z,
+								   Float w) {
+		for (int half = 0; half < 2; ++half) {
+			__m128 a = half ? _mm256_extractf128_ps(x, 1) : _mm256_castps256_ps128(x);
+			__m128 b = half ? _mm256_extractf128_ps(y, 1) : _mm256_castps256_ps128(y);
+			__m128 c = half ? _mm256_extractf128_ps(z, 1) : _mm256_castps256_ps128(z);
+			__m128 d = half ? _mm256_extractf128_ps(w, 1) : _mm256_castps256_ps128(w);
+			_MM_TRANSPOSE4_PS(a, b, c, d);
+			attributes::WorldMatrix* lanes = out + half * 4;
+			_mm_storeu_ps(&lanes[0].matrix[j][0], a);
+			_mm_storeu_ps(&lanes[1].matrix[j][0], b);
+			_mm_storeu_ps(&lanes[2].matrix[j][0], c);
+			_mm_storeu_ps(&lanes[3].matrix[j][0], d);
+		}
+	}
+};
+
+} // namespace avx
+CORE_MATH_END_AVX
+
+#endif
+
+#if defined(CORE_MATH_USE_SSE)
+
+namespace sse {
+
+#include "transform_kernels_batch.h"
+
+struct Ops {
+	using Float = __m128;
+	static constexpr size_t kWidth = 4;
+
+	static inline Float Set(float value) { return _mm_set1_ps(value); }
+	static inline Float Load(const float* data) { return _mm_loadu_ps(data); }
+	static inline Float Add(Float a, Float b) { return _mm_add_ps(a, b); }
+	static inline Float Sub(Float a, Float b) { return _mm_sub_ps(a, b); }
+	static inline Float Mul(Float a, Float b) { return _mm_mul_ps(a, b); }
+	static inline Float Negate(Float a) { return _mm_xor_ps(a, _mm_set1_ps(-0.0f)); }
+
+	static inline void SinCos(Float x, Float& sin_x, Float& cos_x) {
+		__m128i j = _mm_cvtps_epi32(Mul(x, Set(kTwoOverPi)));
+		Float j_float = _mm_cvtepi32_ps(j);
+		Float y = Sub(x, Mul(j_float, Set(kPiOverTwoHigh)));
+		y = Sub(y, Mul(j_float, Set(kPiOverTwoLow)));
+
+		Float sin_poly, cos_poly;
+		SinCosPolynomials<Ops>(y, sin_poly, cos_poly);
+
+		// Odd quadrants swap sin and cos, bit 1 of the quadrant gives the sign.
+		__m128i one = _mm_set1_epi32(1);
+		__m128i two = _mm_set1_epi32(2);
+		Float swap = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(j, one), one));
+		Float sin_sign = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(j, two), 30));
+		Float cos_sign = _mm_castsi128_ps(
+				_mm_slli_epi32(_mm_and_si128(_mm_add_epi32(j, one), two), 30));
+
+		Float sin_value = _mm_or_ps(_mm_and_ps(swap, cos_poly), _mm_andnot_ps(swap, sin_poly));
+		Float cos_value = _mm_or_ps(_mm_and_ps(swap, sin_poly), _mm_andnot_ps(swap, cos_poly));
+		sin_x = _mm_xor_ps(sin_value, sin_sign);
+		cos_x = _mm_xor_ps(cos_value, cos_sign);
+	}
+
+	// Writes column j of kWidth consecutive matrices given each row of the column across lanes.
+	static inline void StoreColumn(attributes::WorldMatrix* out, int j, Float x, Float y, Float z,
+								   Float w) {
+		_MM_TRANSPOSE4_PS(x, y, z, w);
+		_mm_storeu_ps(&out[0].matrix[j][0], x);
+		_mm_storeu_ps(&out[1].matrix[j][0], y);
+		_mm_storeu_ps(&out[2].matrix[j][0], z);
+		_mm_storeu_ps(&out[3].matrix[j][0], w);
+	}
+};
+
+} // namespace sse
+
+#endif
+
+using ComputeBatchesFunc = size_t (*)(const attributes::Transform*, attributes::WorldMatrix*,
+									  size_t);
+
+// Picks the widest batch kernel the processor supports, nullptr if there is none.
+ComputeBatchesFunc SelectComputeBatches() {
+#if defined(CORE_MATH_USE_AVX)
+	if (HasAvx()) {
+		return avx::ComputeBatches<avx::Ops>;
+	}
+#endif
+#if defined(CORE_MATH_USE_SSE)
+	return sse::ComputeBatches<sse::Ops>;
+#else
+	return nullptr;
+#endif
+}
+} // namespace
+
+void ComputeWorldMatrices(const attributes::Transform* transforms,
+						  attributes::WorldMatrix* world_matrices, size_t count) {
+	static const ComputeBatchesFunc compute_batches = SelectComputeBatches();
+	size_t index = compute_batches ? compute_batches(transforms, world_matrices, count) : 0;
+	ComputeWorldMatricesScalar(transforms + index, world_matrices + index, count - index);
+}
+
+void ComputeWorldMatricesScalar(const attributes::Transform* transforms,
+								attributes::WorldMatrix* world_matrices, size_t count) {
+	for (size_t i = 0; i < count; ++i) {
+		world_matrices[i].matrix = transforms[i].GetModelMatrix();
+	}
+}
+} // namespace core::math
@@ -0,0 +1,22 @@
+#ifndef CORE_MATH_TRANSFORM_KERNELS_H
+#define CORE_MATH_TRANSFORM_KERNELS_H
+
+#include <cstddef>
+
+#include "core/attributes/transform.h"
+#include "core/attributes/world_matrix.h"
+
+namespace core::math {
+
+// Computes the world matrices of count transforms, equivalent to calling
+// Transform::GetModelMatrix on each of them. Processes 8 (AVX) or 4 (SSE) transforms at a time
+// when the processor supports it and falls back to the scalar version for the remainder.
+void ComputeWorldMatrices(const attributes::Transform* transforms,
+						  attributes::WorldMatrix* world_matrices, size_t count);
+
+// Scalar version of ComputeWorldMatrices.
+void ComputeWorldMatricesScalar(const attributes::Transform* transforms,
+								attributes::WorldMatrix* world_matrices, size_t count);
+} // namespace core::math
+
+#endif // CORE_MATH_TRANSFORM_KERNELS_H
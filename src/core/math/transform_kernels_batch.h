@@ -0,0 +1,85 @@
+// Batch kernels shared by the instruction sets of transform_kernels.cpp. Included once per
+// instruction set, inside its namespace and before its Ops, so that the templates are compiled
+// for that instruction set. Not a standalone header.
+
+// Evaluates the sin and cos polynomials on the reduced argument y.
+template <typename Ops, typename Float = typename Ops::Float>
+inline void SinCosPolynomials(Float y, Float& sin_poly, Float& cos_poly) {
+	Float z = Ops::Mul(y, y);
+	sin_poly = Ops::Add(Ops::Set(kSin2), Ops::Mul(z, Ops::Set(kSin3)));
+	sin_poly = Ops::Add(Ops::Set(kSin1), Ops::Mul(z, sin_poly));
+	sin_poly = Ops::Add(y, Ops::Mul(Ops::Mul(y, z), sin_poly));
+
+	cos_poly = Ops::Add(Ops::Set(kCos2), Ops::Mul(z, Ops::Set(kCos3)));
+	cos_poly = Ops::Add(Ops::Set(kCos1), Ops::Mul(z, cos_poly));
+	cos_poly = Ops::Mul(Ops::Mul(z, z), cos_poly);
+	cos_poly = Ops::Add(Ops::Sub(Ops::Set(1.0f), Ops::Mul(z, Ops::Set(0.5f))), cos_poly);
+}
+
+// Computes the world matrices of Ops::kWidth consecutive transforms.
+template <typename Ops>
+inline void ComputeBatch(const attributes::Transform* transforms,
+						 attributes::WorldMatrix* world_matrices) {
+	using Float = typename Ops::Float;
+	constexpr size_t kWidth = Ops::kWidth;
+
+	// Gather the transform fields into lanes.
+	alignas(32) float fields[9][kWidth];
+	for (size_t lane = 0; lane < kWidth; ++lane) {
+		const attributes::Transform& transform = transforms[lane];
+		fields[0][lane] = transform.position.x;
+		fields[1][lane] = transform.position.y;
+		fields[2][lane] = transform.position.z;
+		fields[3][lane] = transform.rotation.x;
+		fields[4][lane] = transform.rotation.y;
+		fields[5][lane] = transform.rotation.z;
+		fields[6][lane] = transform.scale.x;
+		fields[7][lane] = transform.scale.y;
+		fields[8][lane] = transform.scale.z;
+	}
+
+	Float degrees_to_radians = Ops::Set(kDegreesToRadians);
+	Float sin_pitch, cos_pitch, sin_yaw, cos_yaw, sin_roll, cos_roll;
+	Ops::SinCos(Ops::Mul(Ops::Load(fields[3]), degrees_to_radians), sin_pitch, cos_pitch);
+	Ops::SinCos(Ops::Mul(Ops::Load(fields[4]), degrees_to_radians), sin_yaw, cos_yaw);
+	Ops::SinCos(Ops::Mul(Ops::Load(fields[5]), degrees_to_radians), sin_roll, cos_roll);
+
+	// Same terms as glm::yawPitchRoll, scaled per column.
+	Float sin_pitch_sin_roll = Ops::Mul(sin_pitch, sin_roll);
+	Float sin_pitch_cos_roll = Ops::Mul(sin_pitch, cos_roll);
+	Float scale_x = Ops::Load(fields[6]);
+	Float scale_y = Ops::Load(fields[7]);
+	Float scale_z = Ops::Load(fields[8]);
+
+	Float m00 = Ops::Add(Ops::Mul(cos_yaw, cos_roll), Ops::Mul(sin_yaw, sin_pitch_sin_roll));
+	Float m01 = Ops::Mul(sin_roll, cos_pitch);
+	Float m02 = Ops::Sub(Ops::Mul(cos_yaw, sin_pitch_sin_roll), Ops::Mul(sin_yaw, cos_roll));
+	Float m10 = Ops::Sub(Ops::Mul(sin_yaw, sin_pitch_cos_roll), Ops::Mul(cos_yaw, sin_roll));
+	Float m11 = Ops::Mul(cos_roll, cos_pitch);
+	Float m12 = Ops::Add(Ops::Mul(sin_roll, sin_yaw), Ops::Mul(cos_yaw, sin_pitch_cos_roll));
+	Float m20 = Ops::Mul(sin_yaw, cos_pitch);
+	Float m21 = Ops::Negate(sin_pitch);
+	Float m22 = Ops::Mul(cos_yaw, cos_pitch);
+
+	Float zero = Ops::Set(0.0f);
+	Ops::StoreColumn(world_matrices, 0, Ops::Mul(m00, scale_x), Ops::Mul(m01, scale_x),
+					 Ops::Mul(m02, scale_x), zero);
+	Ops::StoreColumn(world_matrices, 1, Ops::Mul(m10, scale_y), Ops::Mul(m11, scale_y),
+					 Ops::Mul(m12, scale_y), zero);
+	Ops::StoreColumn(world_matrices, 2, Ops::Mul(m20, scale_z), Ops::Mul(m21, scale_z),
+					 Ops::Mul(m22, scale_z), zero);
+	Ops::StoreColumn(world_matrices, 3, Ops::Load(fields[0]), Ops::Load(fields[1]),
+					 Ops::Load(fields[2]), Ops::Set(1.0f));
+}
+
+// Computes the world matrices of the leading full batches of count transforms. Returns the number
+// of transforms processed.
+template <typename Ops>
+size_t ComputeBatches(const attributes::Transform* transforms,
+					  attributes::WorldMatrix* world_matrices, size_t count) {
+	size_t index = 0;
+	for (; index + Ops::kWidth <= count; index += Ops::kWidth) {
+		ComputeBatch<Ops>(transforms + index, world_matrices + index);
+	}
+	return index;
+}
@@ -0,0 +1,49 @@
+#include "render_command_list.h"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace core::render {
+
+namespace {
+
+static constexpr size_t kRadixBits = 8;
+static constexpr size_t kRadixSize = size_t{1} << kRadixBits;
+static constexpr size_t kRadixPasses = 64 / kRadixBits;
+} // namespace
+
+void RenderCommandList::Sort() {
+	if (commands_.size() < 2) {
+		return;
+	}
+
+	// Count the digits of every pass in a single read of the keys.
+	std::array<std::array<size_t, kRadixSize>, kRadixPasses> histograms{};
+	for (const RenderCommand& command : commands_) {
+		for (size_t pass = 0; pass < kRadixPasses; ++pass) {
+			++histograms[pass][(command.key >> (pass * kRadixBits)) & (kRadixSize - 1)];
+		}
+	}
+
+	scratch_.resize(commands_.size());
+	for (size_t pass = 0; pass < kRadixPasses; ++pass) {
+		std::array<size_t, kRadixSize>& histogram = histograms[pass];
+		size_t shift = pass * kRadixBits;
+		// Every key has the same digit, the pass would not move anything.
+		if (histogram[(commands_[0].key >> shift) & (kRadixSize - 1)] == commands_.size()) {
+			continue;
+		}
+		size_t offset = 0;
+		for (size_t& count : histogram) {
+			offset += std::exchange(count, offset);
+		}
+		for (const RenderCommand& command : commands_) {
+			scratch_[histogram[(command.key >> shift) & (kRadixSize - 1)]++] = command;
+		}
+		std::swap(commands_, scratch_);
+	}
+}
+} // namespace core::render
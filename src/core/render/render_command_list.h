@@ -0,0 +1,92 @@
+#ifndef CORE_RENDER_RENDER_COMMAND_LIST_H
+#define CORE_RENDER_RENDER_COMMAND_LIST_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace core::render {
+
+// Render passes, in the order they are drawn.
+enum class RenderPass : uint8_t {
+	kOpaque
+};
+
+// Sort key of a render command. From the most to the least significant bits: pass, shader,
+// material, mesh and depth. Sorting by key draws the passes in order and puts commands sharing a
+// shader, then a material, then a mesh next to each other, so the submission loop can skip the
+// binds they have in common. Within the same state, commands are drawn front to back.
+class RenderSortKey {
+public:
+	static constexpr uint32_t kPassBits = 4;
+	static constexpr uint32_t kShaderBits = 8;
+	static constexpr uint32_t kMaterialBits = 20;
+	static constexpr uint32_t kMeshBits = 20;
+	static constexpr uint32_t kDepthBits = 12;
+	static_assert(kPassBits + kShaderBits + kMaterialBits + kMeshBits + kDepthBits == 64,
+				  "Sort key fields must fill 64 bits.");
+
+	// Packs the fields into a key. Fields wider than their bits are truncated; depth is expected
+	// in [0, 1] and quantized.
+	static inline uint64_t Make(RenderPass pass, uint32_t shader, uint32_t material,
+								uint32_t mesh, float depth) {
+		float clamped_depth = depth < 0.0f ? 0.0f : (depth > 1.0f ? 1.0f : depth);
+		uint64_t quantized_depth = static_cast<uint64_t>(clamped_depth * kMaxDepth);
+		return (static_cast<uint64_t>(pass) & Mask(kPassBits)) << kPassShift |
+			   (static_cast<uint64_t>(shader) & Mask(kShaderBits)) << kShaderShift |
+			   (static_cast<uint64_t>(material) & Mask(kMaterialBits)) << kMaterialShift |
+			   (static_cast<uint64_t>(mesh) & Mask(kMeshBits)) << kMeshShift |
+			   quantized_depth;
+	}
+
+	static inline RenderPass GetPass(uint64_t key) {
+		return static_cast<RenderPass>(key >> kPassShift);
+	}
+	static inline uint32_t GetShader(uint64_t key) {
+		return static_cast<uint32_t>((key >> kShaderShift) & Mask(kShaderBits));
+	}
+	static inline uint32_t GetMaterial(uint64_t key) {
+		return static_cast<uint32_t>((key >> kMaterialShift) & Mask(kMaterialBits));
+	}
+	static inline uint32_t GetMesh(uint64_t key) {
+		return static_cast<uint32_t>((key >> kMeshShift) & Mask(kMeshBits));
+	}
+
+private:
+	static constexpr inline uint64_t Mask(uint32_t bits) { return (uint64_t{1} << bits) - 1; }
+
+	static constexpr uint32_t kMeshShift = kDepthBits;
+	static constexpr uint32_t kMaterialShift = kMeshShift + kMeshBits;
+	static constexpr uint32_t kShaderShift = kMaterialShift + kMaterialBits;
+	static constexpr uint32_t kPassShift = kShaderShift + kShaderBits;
+	static constexpr float kMaxDepth = static_cast<float>((uint64_t{1} << kDepthBits) - 1);
+};
+
+// Command recorded into a RenderCommandList: a sort key and the index of the draw it stands for
+// in an array owned by the caller.
+struct RenderCommand {
+	uint64_t key;
+	uint32_t draw_index;
+};
+
+// Commands of a frame, sorted by key before submission. Keeps its storage between frames.
+class RenderCommandList {
+public:
+	inline void Add(uint64_t key, uint32_t draw_index) { commands_.push_back({key, draw_index}); }
+	inline void Clear() { commands_.clear(); }
+
+	// Sorts the commands by key with a least significant digit radix sort, one byte per pass.
+	// Passes over bytes that are the same in every key, typically the pass and shader fields, are
+	// skipped. Commands with equal keys keep their order.
+	void Sort();
+
+	inline const std::vector<RenderCommand>& GetCommands() const { return commands_; }
+
+private:
+	std::vector<RenderCommand> commands_;
+	// Destination of the odd radix passes, swapped with commands_.
+	std::vector<RenderCommand> scratch_;
+};
+} // namespace core::render
+
+#endif // CORE_RENDER_RENDER_COMMAND_LIST_H
@@ -1,6 +1,8 @@
 #ifndef CORE_RENDER_RENDER_MATERIAL_DATA_H
 #define CORE_RENDER_RENDER_MATERIAL_DATA_H
 
+#include <cstdint>
+
 #include <glad/glad.h>
 #include <glm/glm.hpp>
 
@@ -11,6 +13,8 @@ struct RenderMaterialData {
 	GLuint normalMap;
 	glm::vec4 baseColor;
 	int textureMask;
+	// Identifier of the material within the renderer, used to sort draw calls.
+	uint32_t id;
 };
 } // namespace core::render
 
@@ -1,16 +1,25 @@
 #ifndef CORE_RENDER_RENDER_MESH_DATA_H
 #define CORE_RENDER_RENDER_MESH_DATA_H
 
+#include <cstdint>
+
 #include <glad/glad.h>
 
 namespace core::render {
 
 struct RenderMeshData {
 	GLuint vao;
+	// Buffers owned by the mesh. Zero when the mesh is in the buffers shared with other meshes.
 	GLuint vbo;
 	GLuint ebo;
 	int indicesSize;
+	// Offset of the mesh in its vertex and index buffers. Zero unless the buffers are shared with
+	// other meshes.
+	GLint baseVertex;
+	GLuint firstIndex;
 	int materialIndex;
+	// Identifier of the mesh within the renderer, used to sort draw calls.
+	uint32_t id;
 };
 } // namespace core::render
 
@@ -5,6 +5,7 @@
 
 #include "render_mesh_data.h"
 #include "render_material_data.h"
+#include "core/graphics/bounding_volume.h"
 #include "core/graphics/model.h"
 
 namespace core::render {
@@ -13,6 +14,7 @@ struct RenderModelData {
 	std::vector <graphics::Model::MeshInstance> meshInstances;
 	std::vector <RenderMeshData> meshDatas;
 	std::vector <RenderMaterialData> materialDatas;
+	graphics::BoundingVolume bounds;
 };
 } // namespace core::render
 
@@ -0,0 +1,62 @@
+#include "render_queue.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+
+#include <glm/glm.hpp>
+
+#include "core/graphics/model.h"
+
+namespace core::render {
+
+void RenderQueue::Build(const std::unordered_map<size_t, RenderModelData>& models,
+						const attributes::Camera& camera) {
+	instanced_draws_.clear();
+	instance_matrices_.clear();
+	command_list_.Clear();
+	std::sort(drawables_.begin(), drawables_.end(),
+			  [](const Drawable& a, const Drawable& b) { return a.model_id < b.model_id; });
+
+	// Row of the view matrix giving the view space depth of a point.
+	glm::vec4 depth_row(camera.view_matrix[0][2], camera.view_matrix[1][2],
+						camera.view_matrix[2][2], camera.view_matrix[3][2]);
+	float depth_range = camera.far_plane - camera.near_plane;
+
+	size_t first = 0;
+	while (first < drawables_.size()) {
+		size_t model_id = drawables_[first].model_id;
+		size_t last = first + 1;
+		while (last < drawables_.size() && drawables_[last].model_id == model_id) {
+			++last;
+		}
+		auto model_it = models.find(model_id);
+		if (model_it != models.end()) {
+			const RenderModelData& model_data = model_it->second;
+			for (const graphics::Model::MeshInstance& mesh_instance : model_data.meshInstances) {
+				const RenderMeshData& mesh_data = model_data.meshDatas[mesh_instance.mesh_index];
+				const RenderMaterialData& material_data =
+						model_data.materialDatas[mesh_instance.material_index];
+				float nearest = camera.far_plane;
+				for (size_t i = first; i < last; ++i) {
+					const glm::mat4& matrix = instance_matrices_.emplace_back(
+							mesh_instance.transformation_matrix * drawables_[i].model_matrix);
+					// The camera looks down -z in view space.
+					nearest = std::min(nearest, -glm::dot(depth_row, matrix[3]));
+				}
+				float depth = (nearest - camera.near_plane) / depth_range;
+				command_list_.Add(RenderSortKey::Make(RenderPass::kOpaque, 0, material_data.id,
+													  mesh_data.id, depth),
+								  static_cast<uint32_t>(instanced_draws_.size()));
+				instanced_draws_.push_back({&mesh_data, &material_data,
+											static_cast<GLuint>(instance_matrices_.size() -
+																(last - first)),
+											static_cast<GLsizei>(last - first)});
+			}
+		}
+		first = last;
+	}
+	command_list_.Sort();
+}
+} // namespace core::render
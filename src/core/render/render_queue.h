@@ -0,0 +1,63 @@
+#ifndef CORE_RENDER_RENDER_QUEUE_H
+#define CORE_RENDER_RENDER_QUEUE_H
+
+#include <cstddef>
+#include <unordered_map>
+#include <vector>
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "drawable.h"
+#include "render_command_list.h"
+#include "render_material_data.h"
+#include "render_mesh_data.h"
+#include "render_model_data.h"
+#include "core/attributes/camera.h"
+
+namespace core::render {
+
+// CPU side of a frame: the drawables queued by the systems, grouped into instanced draws and
+// sorted render commands. Makes no GL calls, so it can be filled and built without a context.
+// Keeps its storage between frames.
+class RenderQueue {
+public:
+	// One instanced draw call: a mesh instance of a model, for every drawable of that model.
+	struct InstancedDraw {
+		const RenderMeshData* mesh_data;
+		const RenderMaterialData* material_data;
+		// Range of the model matrices of the instances in GetInstanceMatrices().
+		GLuint first_instance;
+		GLsizei instance_count;
+	};
+
+	// Queues a drawable for the current frame.
+	inline void Submit(const Drawable& drawable) { drawables_.push_back(drawable); }
+	// Makes room for count more drawables in the current frame, so that submitting them does not
+	// reallocate.
+	inline void Reserve(size_t count) { drawables_.reserve(drawables_.size() + count); }
+	// Empties the queue for the next frame.
+	inline void Clear() { drawables_.clear(); }
+
+	// Groups the queued drawables by model and fills the instanced draws, their model matrices and
+	// the command list. The depth of the sort keys is the distance of the nearest instance from
+	// the camera. Drawables of models missing from models are skipped. The instanced draws point
+	// into models, which must outlive them.
+	void Build(const std::unordered_map<size_t, RenderModelData>& models,
+			   const attributes::Camera& camera);
+
+	inline size_t GetDrawableCount() const { return drawables_.size(); }
+	inline const std::vector<InstancedDraw>& GetInstancedDraws() const { return instanced_draws_; }
+	inline const std::vector<glm::mat4>& GetInstanceMatrices() const { return instance_matrices_; }
+	inline const RenderCommandList& GetCommandList() const { return command_list_; }
+
+private:
+	std::vector<Drawable> drawables_;
+	std::vector<InstancedDraw> instanced_draws_;
+	std::vector<glm::mat4> instance_matrices_;
+	// Commands of the current frame, one per instanced draw.
+	RenderCommandList command_list_;
+};
+} // namespace core::render
+
+#endif // CORE_RENDER_RENDER_QUEUE_H
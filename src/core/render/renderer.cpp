@@ -1,5 +1,8 @@
 #include "renderer.h"
 
+#include <algorithm>
+#include <memory>
+#include <stdexcept>
 #include <vector>
 #include <string>
 #include <fstream>
@@ -9,11 +12,13 @@
 #include <glm/gtc/type_ptr.hpp>
 
 #include "drawable.h"
+#include "shared_geometry_buffer.h"
 #include "core/graphics/model.h"
 #include "core/graphics/texture.h"
 #include "core/graphics/vertex.h"
 #include "core/attributes/camera.h"
 #include "core/attributes/transform.h"
+#include "core/attributes/world_matrix.h"
 #include "core/ecs/ecs_manager.h"
 
 
@@ -28,33 +33,14 @@ namespace {
 		glCreateVertexArrays(1, &loadedData.vao);
 		glCreateBuffers(1, &loadedData.vbo);
 
-		GLuint vboBindingPoint = 0;
 		glNamedBufferStorage(loadedData.vbo, sizeof(graphics::Vertex) * mesh.vertices.size(), mesh.vertices.data(), GL_DYNAMIC_STORAGE_BIT);
-		glVertexArrayVertexBuffer(loadedData.vao, vboBindingPoint, loadedData.vbo, 0, sizeof(graphics::Vertex));
-
-		GLuint vboPositionIndex = 0;
-		glEnableVertexArrayAttrib(loadedData.vao, vboPositionIndex);
-		glVertexArrayAttribFormat(loadedData.vao, vboPositionIndex, 4, GL_FLOAT, false, 0);
-		glVertexArrayAttribBinding(loadedData.vao, vboPositionIndex, vboBindingPoint);
-
-		GLuint vboTangentIndex = 1;
-		glEnableVertexArrayAttrib(loadedData.vao, vboTangentIndex);
-		glVertexArrayAttribFormat(loadedData.vao, vboTangentIndex, 4, GL_FLOAT, false, offsetof(graphics::Vertex, tangent));
-		glVertexArrayAttribBinding(loadedData.vao, vboTangentIndex, vboBindingPoint);
-
-		GLuint vboNormalIndex = 2;
-		glEnableVertexArrayAttrib(loadedData.vao, vboNormalIndex);
-		glVertexArrayAttribFormat(loadedData.vao, vboNormalIndex, 4, GL_FLOAT, false, offsetof(graphics::Vertex, normal));
-		glVertexArrayAttribBinding(loadedData.vao, vboNormalIndex, vboBindingPoint);
-
-		GLuint vboTextureIndex = 3;
-		glEnableVertexArrayAttrib(loadedData.vao, vboTextureIndex);
-		glVertexArrayAttribFormat(loadedData.vao, vboTextureIndex, 2, GL_FLOAT, false, offsetof(graphics::Vertex, texture_coords));
-		glVertexArrayAttribBinding(loadedData.vao, vboTextureIndex, vboBindingPoint);
+		SetupVertexFormat(loadedData.vao, loadedData.vbo);
 
 		glCreateBuffers(1, &loadedData.ebo);
 		glNamedBufferStorage(loadedData.ebo, sizeof(GLuint) * mesh.indices.size(), mesh.indices.data(), GL_DYNAMIC_STORAGE_BIT);
 		glVertexArrayElementBuffer(loadedData.vao, loadedData.ebo);
+		loadedData.baseVertex = 0;
+		loadedData.firstIndex = 0;
 
 		return loadedData;
 	}
@@ -67,7 +53,7 @@ namespace {
 		glTextureParameteri(glTexture, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
 		glTextureParameteri(glTexture, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
 		glTextureParameteri(glTexture, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-		glTextureParameteri(glTexture, GL_TEXTURE_MAG_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+		glTextureParameteri(glTexture, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 
 		glTextureStorage2D(glTexture, 3, sizedInternalFormat, texture.width, texture.height);
 		glTextureSubImage2D(glTexture, 0, 0, 0, texture.width, texture.height, internalFormat, GL_UNSIGNED_BYTE, texture.data);
@@ -165,6 +151,21 @@ namespace {
 		return buffer;
 	}
 
+	// Uploads size bytes to the start of the buffer, reallocating it first if it holds less than
+	// that. Grows geometrically, so a growing scene reallocates the buffer a handful of times.
+	void UploadToBuffer(GLuint buffer, size_t& capacity, const void* data, size_t size)
+	{
+		if (size > capacity)
+		{
+			capacity = std::max(size, capacity * 2);
+			glNamedBufferData(buffer, capacity, nullptr, GL_DYNAMIC_DRAW);
+		}
+		if (size > 0)
+		{
+			glNamedBufferSubData(buffer, 0, size, data);
+		}
+	}
+
 	void InitGL()
 	{
 		glEnable(GL_CULL_FACE);
@@ -174,8 +175,18 @@ namespace {
 	}
 } // namespace
 
-Renderer::Renderer() {
-    InitShaders();
+// Shader storage binding of the instance model matrices, see the default vertex shader.
+static constexpr GLuint kInstanceBufferBinding = 1;
+
+Renderer::Renderer() = default;
+
+void Renderer::InitIfNeeded() {
+	if (initialized_) {
+		return;
+	}
+	initialized_ = true;
+	InitShaders();
+	InitInstanceBuffer();
 	InitGL();
 }
 
@@ -186,54 +197,200 @@ void Renderer::InitShaders() {
 	glUseProgram(default_shader_program_);
 }
 
+void Renderer::InitInstanceBuffer() {
+	glCreateBuffers(1, &instance_buffer_);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, kInstanceBufferBinding, instance_buffer_);
+}
+
+void Renderer::EnableMultiDrawIndirect() {
+	if (shared_geometry_ != nullptr) {
+		return;
+	}
+	InitIfNeeded();
+	if (!id_to_render_data_.empty()) {
+		throw std::runtime_error("Multi-draw indirect must be enabled before models are loaded.");
+	}
+	shared_geometry_ = std::make_unique<SharedGeometryBuffer>();
+	glCreateBuffers(1, &indirect_buffer_);
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, indirect_buffer_);
+}
+
 void Renderer::LoadModel(const graphics::Model& model)
 {
+    InitIfNeeded();
     RenderModelData modelData;
     modelData.meshInstances = model.mesh_instances;
+    modelData.bounds = model.bounds;
     for (const graphics::Mesh& mesh : model.meshes)
     {
-        RenderMeshData meshData = LoadMesh(mesh);
+        RenderMeshData meshData;
+        if (shared_geometry_ != nullptr)
+        {
+            // The shared buffers are replaced as they grow, so only the vertex array is kept; its
+            // buffer names would go stale.
+            SharedMeshRange range = shared_geometry_->Add(mesh);
+            meshData.vao = shared_geometry_->GetVertexArray();
+            meshData.vbo = 0;
+            meshData.ebo = 0;
+            meshData.baseVertex = range.base_vertex;
+            meshData.firstIndex = range.first_index;
+        }
+        else
+        {
+            meshData = LoadMesh(mesh);
+        }
         meshData.indicesSize = mesh.indices.size();
+        meshData.id = next_mesh_id_++;
         modelData.meshDatas.push_back(meshData);
     }
     for (const graphics::Material& material : model.materials)
     {
         RenderMaterialData materialData = LoadMaterial(material);
+        materialData.id = next_material_id_++;
         modelData.materialDatas.push_back(materialData);
     }
     id_to_render_data_[model.id] = modelData;
+    ++model_generation_;
+}
+
+const graphics::BoundingVolume* Renderer::FindModelBounds(size_t model_id) const {
+	auto it = id_to_render_data_.find(model_id);
+	return it != id_to_render_data_.end() ? &it->second.bounds : nullptr;
 }
 
-void Renderer::Draw(const std::vector <Drawable>& drawables, ecs::EntityID active_camera_id) {
-	attributes::Camera& active_camera_attr = core::ecs::ECSManager::GetInstance().GetAttribute<attributes::Camera>(active_camera_id);
+void Renderer::DrawFrame(ecs::EntityID active_camera_id) {
+	InitIfNeeded();
+	ecs::ECSManager& ecs_manager = ecs::ECSManager::GetInstance();
+	const attributes::Camera& active_camera_attr = ecs_manager.GetAttribute<const attributes::Camera>(active_camera_id);
     glUniformMatrix4fv(1, 1, GL_FALSE, &active_camera_attr.view_matrix[0][0]);
     glUniformMatrix4fv(2, 1, GL_FALSE, &active_camera_attr.projection_matrix[0][0]);
-	attributes::Transform& camera_transform = core::ecs::ECSManager::GetInstance().GetAttribute<attributes::Transform>(active_camera_id);
-    glUniform3fv(4, 1, glm::value_ptr(camera_transform.position));
+	// Cameras placed in a hierarchy take their position from their world matrix, as in the
+	// CameraSystem.
+	glm::vec3 camera_position;
+	if (ecs_manager.HasAttribute<attributes::WorldMatrix>(active_camera_id)) {
+		camera_position = glm::vec3(ecs_manager.GetAttribute<const attributes::WorldMatrix>(
+				active_camera_id).matrix[3]);
+	} else {
+		camera_position = ecs_manager.GetAttribute<const attributes::Transform>(
+				active_camera_id).position;
+	}
+    glUniform3fv(4, 1, glm::value_ptr(camera_position));
 
-    for (const Drawable& drawable : drawables)
+    queue_.Build(id_to_render_data_, active_camera_attr);
+    UploadInstanceMatrices();
+    if (shared_geometry_ != nullptr)
     {
-        RenderModelData modelData = id_to_render_data_[drawable.model_id];
-        const std::vector <graphics::Model::MeshInstance>& meshInstances = modelData.meshInstances;
-        const std::vector <RenderMeshData>& meshDatas = modelData.meshDatas;
-        const std::vector <RenderMaterialData>& materialDatas = modelData.materialDatas;
-
-        for (const graphics::Model::MeshInstance& meshInstance : meshInstances)
-        {
-            glm::mat4 modelMatrix = meshInstance.transformation_matrix * drawable.model_matrix;
-            glUniformMatrix4fv(0, 1, GL_FALSE, &modelMatrix[0][0]);
-            const RenderMeshData& meshData = meshDatas[meshInstance.mesh_index];
-            const RenderMaterialData& materialData = materialDatas[meshInstance.material_index];
-
-            glUniform4fv(5, 1, glm::value_ptr(materialData.baseColor));
-            glUniform1i(6, materialData.textureMask);
-
-            glBindVertexArray(meshData.vao);
-            glBindTextureUnit(0, materialData.diffuseTexture);
-            glBindTextureUnit(1, materialData.normalMap);
-            glDrawElements(GL_TRIANGLES, meshData.indicesSize, GL_UNSIGNED_INT, 0);
-        }    
+        SubmitCommandsIndirect();
+    }
+    else
+    {
+        SubmitCommands();
     }
+    // Keeps the capacity, so the next frame submits without allocating.
+    queue_.Clear();
+}
+
+void Renderer::SubmitCommands() {
+	frame_stats_ = RenderStats{};
+	BoundState bound;
+	for (const RenderCommand& command : queue_.GetCommandList().GetCommands()) {
+		const RenderQueue::InstancedDraw& draw = queue_.GetInstancedDraws()[command.draw_index];
+		BindShader(RenderSortKey::GetShader(command.key), bound);
+		BindMaterial(*draw.material_data, bound);
+		BindVertexArray(draw.mesh_data->vao, bound);
+
+		glDrawElementsInstancedBaseVertexBaseInstance(
+				GL_TRIANGLES, draw.mesh_data->indicesSize, GL_UNSIGNED_INT,
+				reinterpret_cast<const void*>(draw.mesh_data->firstIndex * sizeof(GLuint)),
+				draw.instance_count, draw.mesh_data->baseVertex, draw.first_instance);
+		++frame_stats_.draw_calls;
+		frame_stats_.instances += draw.instance_count;
+	}
+}
+
+void Renderer::SubmitCommandsIndirect() {
+	frame_stats_ = RenderStats{};
+	indirect_commands_.clear();
+	indirect_batches_.clear();
+	// Commands sharing a shader and a material are contiguous once sorted, and every mesh lives in
+	// the shared buffers, so each such run is a single multi-draw.
+	for (const RenderCommand& command : queue_.GetCommandList().GetCommands()) {
+		const RenderQueue::InstancedDraw& draw = queue_.GetInstancedDraws()[command.draw_index];
+		uint32_t shader = RenderSortKey::GetShader(command.key);
+		if (indirect_batches_.empty() || indirect_batches_.back().shader != shader ||
+			indirect_batches_.back().material_data != draw.material_data) {
+			indirect_batches_.push_back({shader, draw.material_data, indirect_commands_.size(), 0});
+		}
+		indirect_commands_.push_back({static_cast<GLuint>(draw.mesh_data->indicesSize),
+									  static_cast<GLuint>(draw.instance_count),
+									  draw.mesh_data->firstIndex, draw.mesh_data->baseVertex,
+									  draw.first_instance});
+		++indirect_batches_.back().command_count;
+		frame_stats_.instances += draw.instance_count;
+	}
+	UploadToBuffer(indirect_buffer_, indirect_buffer_capacity_, indirect_commands_.data(),
+				   indirect_commands_.size() * sizeof(DrawElementsIndirectCommand));
+
+	BoundState bound;
+	BindVertexArray(shared_geometry_->GetVertexArray(), bound);
+	for (const IndirectBatch& batch : indirect_batches_) {
+		BindShader(batch.shader, bound);
+		BindMaterial(*batch.material_data, bound);
+		glMultiDrawElementsIndirect(
+				GL_TRIANGLES, GL_UNSIGNED_INT,
+				reinterpret_cast<const void*>(batch.first_command *
+											  sizeof(DrawElementsIndirectCommand)),
+				static_cast<GLsizei>(batch.command_count), 0);
+		++frame_stats_.draw_calls;
+	}
+}
+
+void Renderer::BindShader(uint32_t shader, BoundState& bound) {
+	if (bound.valid_shader && bound.shader == shader) {
+		return;
+	}
+	// Only the default shader exists so far.
+	glUseProgram(default_shader_program_);
+	bound.shader = shader;
+	bound.valid_shader = true;
+	++frame_stats_.state_changes;
+}
+
+void Renderer::BindMaterial(const RenderMaterialData& material_data, BoundState& bound) {
+	if (!bound.valid_material || bound.material != material_data.id) {
+		glUniform4fv(5, 1, glm::value_ptr(material_data.baseColor));
+		glUniform1i(6, material_data.textureMask);
+		bound.material = material_data.id;
+		bound.valid_material = true;
+		++frame_stats_.state_changes;
+	}
+	if (!bound.valid_textures || bound.diffuse_texture != material_data.diffuseTexture) {
+		glBindTextureUnit(0, material_data.diffuseTexture);
+		bound.diffuse_texture = material_data.diffuseTexture;
+		++frame_stats_.state_changes;
+	}
+	if (!bound.valid_textures || bound.normal_map != material_data.normalMap) {
+		glBindTextureUnit(1, material_data.normalMap);
+		bound.normal_map = material_data.normalMap;
+		++frame_stats_.state_changes;
+	}
+	bound.valid_textures = true;
+}
+
+void Renderer::BindVertexArray(GLuint vao, BoundState& bound) {
+	if (bound.valid_vao && bound.vao == vao) {
+		return;
+	}
+	glBindVertexArray(vao);
+	bound.vao = vao;
+	bound.valid_vao = true;
+	++frame_stats_.state_changes;
+}
+
+void Renderer::UploadInstanceMatrices() {
+	const std::vector<glm::mat4>& instance_matrices = queue_.GetInstanceMatrices();
+	UploadToBuffer(instance_buffer_, instance_buffer_capacity_, instance_matrices.data(),
+				   instance_matrices.size() * sizeof(glm::mat4));
 }
 
 } // namespace core::render
\ No newline at end of file
@@ -1,16 +1,33 @@
 #ifndef CORE_RENDER_RENDERER_H
 #define CORE_RENDER_RENDERER_H
 
+#include <memory>
 #include <vector>
 #include <unordered_map>
 
 #include "drawable.h"
+#include "render_command_list.h"
 #include "render_model_data.h"
+#include "render_queue.h"
+#include "shared_geometry_buffer.h"
+#include "core/graphics/bounding_volume.h"
 #include "core/graphics/model.h"
+#include "core/attributes/camera.h"
 #include "core/ecs/entity.h"
 
 namespace core::render {
 
+// Counters of the last frame drawn by the Renderer.
+struct RenderStats {
+	// Draw calls issued.
+	size_t draw_calls = 0;
+	// Instances drawn by those draw calls.
+	size_t instances = 0;
+	// Binds and uniform updates issued: shader programs, vertex arrays, textures and material
+	// uniforms. Binds skipped because the state was already set are not counted.
+	size_t state_changes = 0;
+};
+
 class Renderer {
 public:
 	static Renderer& GetInstance() {
@@ -18,18 +35,112 @@ public:
 		return instance;
 	}
 	
+	// Loads the meshes of every model loaded from now on into a single shared vertex and index
+	// buffer, and draws each frame with one glMultiDrawElementsIndirect per material, from
+	// indirect commands built on the CPU. Must be called before the first model is loaded,
+	// otherwise throws an exception.
+	void EnableMultiDrawIndirect();
+	inline bool IsMultiDrawIndirectEnabled() const { return shared_geometry_ != nullptr; }
+
 	void LoadModel(const graphics::Model& model);
 	void UnloadModel(size_t model_id) { 
 		// TODO 
 	};
-	void Draw(const std::vector<Drawable>& drawables, ecs::EntityID active_camera_id);
+	// Returns the bounds of a loaded model, in model space, or nullptr if the model is not loaded.
+	// Safe to call from several threads while no model is being loaded.
+	const graphics::BoundingVolume* FindModelBounds(size_t model_id) const;
+	// Number of models loaded so far. Changes whenever a model is loaded, so that data derived
+	// from the loaded models can tell it is stale.
+	inline size_t GetModelGeneration() const { return model_generation_; }
+
+	// Queues a drawable for the current frame. Queued drawables are drawn by DrawFrame.
+	inline void Submit(const Drawable& drawable) { queue_.Submit(drawable); }
+	// Makes room for count more drawables in the current frame, so that submitting them does not
+	// reallocate. The queue keeps its capacity between frames.
+	inline void ReserveDrawables(size_t count) { queue_.Reserve(count); }
+	// Draws every drawable queued since the last call as seen from the given camera, and empties
+	// the queue. Per-frame state, such as the camera uniforms, is set once for the whole queue.
+	// Drawables of the same model are drawn together: every mesh instance of the model is one
+	// instanced draw call, with the model matrices of all its instances read from the instance
+	// buffer. The draw calls are recorded into a command list sorted by RenderSortKey, and binds
+	// already in place from the previous draw call are skipped.
+	void DrawFrame(ecs::EntityID active_camera_id);
+	// Returns the queue of the current frame, holding the drawables submitted so far.
+	inline RenderQueue& GetQueue() { return queue_; }
+	// Returns the counters of the last frame drawn.
+	inline const RenderStats& GetFrameStats() const { return frame_stats_; }
 	
 private:
+	// Layout of the commands read by glMultiDrawElementsIndirect.
+	struct DrawElementsIndirectCommand {
+		GLuint count;
+		GLuint instance_count;
+		GLuint first_index;
+		GLint base_vertex;
+		GLuint base_instance;
+	};
+	static_assert(sizeof(DrawElementsIndirectCommand) == 5 * sizeof(GLuint),
+				  "Indirect commands must be tightly packed.");
+	// Run of indirect commands drawn with the same shader and material.
+	struct IndirectBatch {
+		uint32_t shader;
+		const RenderMaterialData* material_data;
+		size_t first_command;
+		size_t command_count;
+	};
+	// State set by the previous draw call of the frame. Nothing is assumed to be bound at the start
+	// of the frame.
+	struct BoundState {
+		bool valid_shader = false;
+		bool valid_material = false;
+		bool valid_textures = false;
+		bool valid_vao = false;
+		uint32_t shader = 0;
+		uint32_t material = 0;
+		GLuint diffuse_texture = 0;
+		GLuint normal_map = 0;
+		GLuint vao = 0;
+	};
+
 	void InitShaders();
+	void InitInstanceBuffer();
 	Renderer();
 
+	// Creates the shaders and GL objects of the renderer on first use, so that the renderer can
+	// be created and queue drawables without a GL context.
+	void InitIfNeeded();
+	// Issues the draw calls in command list order, skipping redundant binds.
+	void SubmitCommands();
+	// Same as SubmitCommands, with one multi-draw per run of commands sharing shader and material.
+	void SubmitCommandsIndirect();
+	// Bind the state unless bound already holds it, and count the state changes.
+	void BindShader(uint32_t shader, BoundState& bound);
+	void BindMaterial(const RenderMaterialData& material_data, BoundState& bound);
+	void BindVertexArray(GLuint vao, BoundState& bound);
+	// Uploads the model matrices of the instanced draws, growing the instance buffer if needed.
+	void UploadInstanceMatrices();
+
 private:
 	std::unordered_map <size_t, RenderModelData> id_to_render_data_;
+	size_t model_generation_ = 0;
+	// Drawables submitted for the current frame, and the draw calls built from them.
+	RenderQueue queue_;
+	bool initialized_ = false;
+	// Shader storage buffer holding the instance matrices of the queue on the GPU, and its size in
+	// bytes.
+	GLuint instance_buffer_;
+	size_t instance_buffer_capacity_ = 0;
+	RenderStats frame_stats_;
+	// Shared geometry and indirect commands of the multi-draw indirect path. Null while it is
+	// disabled.
+	std::unique_ptr<SharedGeometryBuffer> shared_geometry_;
+	std::vector<DrawElementsIndirectCommand> indirect_commands_;
+	std::vector<IndirectBatch> indirect_batches_;
+	GLuint indirect_buffer_ = 0;
+	size_t indirect_buffer_capacity_ = 0;
+	// Identifiers handed to loaded meshes and materials, used in the sort keys.
+	uint32_t next_mesh_id_ = 0;
+	uint32_t next_material_id_ = 0;
 
 	
 	GLuint default_shader_program_;
@@ -0,0 +1,101 @@
+#include "shared_geometry_buffer.h"
+
+#include <algorithm>
+#include <cstddef>
+
+#include <glad/glad.h>
+
+#include "core/graphics/mesh.h"
+#include "core/graphics/vertex.h"
+
+namespace core::render {
+
+namespace {
+
+// Initial capacity of the shared buffers, in bytes.
+static constexpr size_t kInitialVertexCapacity = 1 << 20;
+static constexpr size_t kInitialIndexCapacity = 1 << 18;
+// Binding point of the vertex buffer in the vertex arrays.
+static constexpr GLuint kVertexBufferBinding = 0;
+} // namespace
+
+void SetupVertexFormat(GLuint vao, GLuint vbo) {
+	glVertexArrayVertexBuffer(vao, kVertexBufferBinding, vbo, 0, sizeof(graphics::Vertex));
+
+	GLuint position_index = 0;
+	glEnableVertexArrayAttrib(vao, position_index);
+	glVertexArrayAttribFormat(vao, position_index, 4, GL_FLOAT, false, 0);
+	glVertexArrayAttribBinding(vao, position_index, kVertexBufferBinding);
+
+	GLuint tangent_index = 1;
+	glEnableVertexArrayAttrib(vao, tangent_index);
+	glVertexArrayAttribFormat(vao, tangent_index, 4, GL_FLOAT, false,
+							  offsetof(graphics::Vertex, tangent));
+	glVertexArrayAttribBinding(vao, tangent_index, kVertexBufferBinding);
+
+	GLuint normal_index = 2;
+	glEnableVertexArrayAttrib(vao, normal_index);
+	glVertexArrayAttribFormat(vao, normal_index, 4, GL_FLOAT, false,
+							  offsetof(graphics::Vertex, normal));
+	glVertexArrayAttribBinding(vao, normal_index, kVertexBufferBinding);
+
+	GLuint texture_index = 3;
+	glEnableVertexArrayAttrib(vao, texture_index);
+	glVertexArrayAttribFormat(vao, texture_index, 2, GL_FLOAT, false,
+							  offsetof(graphics::Vertex, texture_coords));
+	glVertexArrayAttribBinding(vao, texture_index, kVertexBufferBinding);
+}
+
+SharedGeometryBuffer::SharedGeometryBuffer() {
+	glCreateVertexArrays(1, &vao_);
+	glCreateBuffers(1, &vbo_);
+	glCreateBuffers(1, &ebo_);
+	vertex_capacity_ = kInitialVertexCapacity;
+	index_capacity_ = kInitialIndexCapacity;
+	glNamedBufferStorage(vbo_, vertex_capacity_, nullptr, GL_DYNAMIC_STORAGE_BIT);
+	glNamedBufferStorage(ebo_, index_capacity_, nullptr, GL_DYNAMIC_STORAGE_BIT);
+	SetupVertexFormat(vao_, vbo_);
+	glVertexArrayElementBuffer(vao_, ebo_);
+}
+
+SharedMeshRange SharedGeometryBuffer::Add(const graphics::Mesh& mesh) {
+	size_t vertex_bytes = sizeof(graphics::Vertex) * mesh.vertices.size();
+	size_t index_bytes = sizeof(GLuint) * mesh.indices.size();
+	GLuint old_vbo = vbo_;
+	GLuint old_ebo = ebo_;
+	Reserve(vbo_, vertex_capacity_, vertex_size_, vertex_size_ + vertex_bytes);
+	Reserve(ebo_, index_capacity_, index_size_, index_size_ + index_bytes);
+	if (vbo_ != old_vbo) {
+		glVertexArrayVertexBuffer(vao_, kVertexBufferBinding, vbo_, 0, sizeof(graphics::Vertex));
+	}
+	if (ebo_ != old_ebo) {
+		glVertexArrayElementBuffer(vao_, ebo_);
+	}
+
+	SharedMeshRange range{static_cast<GLint>(vertex_size_ / sizeof(graphics::Vertex)),
+						  static_cast<GLuint>(index_size_ / sizeof(GLuint))};
+	glNamedBufferSubData(vbo_, vertex_size_, vertex_bytes, mesh.vertices.data());
+	glNamedBufferSubData(ebo_, index_size_, index_bytes, mesh.indices.data());
+	vertex_size_ += vertex_bytes;
+	index_size_ += index_bytes;
+	return range;
+}
+
+void SharedGeometryBuffer::Reserve(GLuint& buffer, size_t& capacity, size_t used,
+								   size_t required) {
+	if (required <= capacity) {
+		return;
+	}
+	// Buffer storage is immutable, so grow into a new buffer.
+	size_t new_capacity = std::max(required, capacity * 2);
+	GLuint new_buffer;
+	glCreateBuffers(1, &new_buffer);
+	glNamedBufferStorage(new_buffer, new_capacity, nullptr, GL_DYNAMIC_STORAGE_BIT);
+	if (used > 0) {
+		glCopyNamedBufferSubData(buffer, new_buffer, 0, 0, used);
+	}
+	glDeleteBuffers(1, &buffer);
+	buffer = new_buffer;
+	capacity = new_capacity;
+}
+} // namespace core::render
@@ -0,0 +1,57 @@
+#ifndef CORE_RENDER_SHARED_GEOMETRY_BUFFER_H
+#define CORE_RENDER_SHARED_GEOMETRY_BUFFER_H
+
+#include <cstddef>
+
+#include <glad/glad.h>
+
+#include "core/graphics/mesh.h"
+
+namespace core::render {
+
+// Sets up the attributes of graphics::Vertex on the given vertex array, reading from vbo.
+void SetupVertexFormat(GLuint vao, GLuint vbo);
+
+// Where a mesh landed in the shared buffers.
+struct SharedMeshRange {
+	// Index of the first vertex of the mesh, added to its indices when drawing.
+	GLint base_vertex;
+	// Position of the first index of the mesh in the index buffer.
+	GLuint first_index;
+};
+
+// Single vertex buffer, index buffer and vertex array holding every static mesh, so that meshes
+// can be drawn back to back, or in a single multi-draw, without switching vertex arrays. Meshes
+// are appended and never freed. When a buffer is full, it is replaced by one twice as large and
+// the existing data is copied over on the GPU. Like the other GL objects of the renderer, the
+// buffers are released along with the context.
+class SharedGeometryBuffer {
+public:
+	SharedGeometryBuffer();
+	SharedGeometryBuffer(const SharedGeometryBuffer&) = delete;
+	SharedGeometryBuffer& operator=(const SharedGeometryBuffer&) = delete;
+
+	// Appends the vertices and indices of the mesh and returns where they are stored.
+	SharedMeshRange Add(const graphics::Mesh& mesh);
+
+	inline GLuint GetVertexArray() const { return vao_; }
+	inline GLuint GetVertexBuffer() const { return vbo_; }
+	inline GLuint GetIndexBuffer() const { return ebo_; }
+
+private:
+	// Makes sure the buffer holds at least required bytes, keeping the first used bytes.
+	void Reserve(GLuint& buffer, size_t& capacity, size_t used, size_t required);
+
+private:
+	GLuint vao_;
+	GLuint vbo_;
+	GLuint ebo_;
+	// Capacity and used size of the buffers, in bytes.
+	size_t vertex_capacity_ = 0;
+	size_t vertex_size_ = 0;
+	size_t index_capacity_ = 0;
+	size_t index_size_ = 0;
+};
+} // namespace core::render
+
+#endif // CORE_RENDER_SHARED_GEOMETRY_BUFFER_H
@@ -0,0 +1,101 @@
+#include "bounds_system.h"
+
+#include <algorithm>
+#include <limits>
+
+#include <glm/glm.hpp>
+
+#include "core/attributes/bounds.h"
+#include "core/attributes/static_mesh.h"
+#include "core/attributes/world_matrix.h"
+#include "core/graphics/bounding_volume.h"
+#include "core/render/renderer.h"
+
+namespace core::systems {
+
+namespace {
+
+// Transforms the model space bounding sphere of the model into world space.
+void ComputeBounds(const render::Renderer& renderer, const attributes::WorldMatrix& world_matrix,
+				   const attributes::StaticMesh& static_mesh, attributes::Bounds& bounds) {
+	const glm::mat4& matrix = world_matrix.matrix;
+	const graphics::BoundingVolume* model_bounds = renderer.FindModelBounds(static_mesh.model_id);
+	if (model_bounds == nullptr) {
+		bounds.center = glm::vec3(matrix[3]);
+		bounds.radius = std::numeric_limits<float>::infinity();
+		return;
+	}
+	bounds.center = glm::vec3(matrix * glm::vec4(model_bounds->center, 1.0f));
+	float max_scale = std::max({glm::length(glm::vec3(matrix[0])),
+								glm::length(glm::vec3(matrix[1])),
+								glm::length(glm::vec3(matrix[2]))});
+	bounds.radius = model_bounds->radius * max_scale;
+}
+} // namespace
+
+void BoundsSystem::Start() {
+	// Initialization if needed
+}
+
+void BoundsSystem::StartArchetype(ecs::Archetype& archetype) {
+	// Initialization per archetype if needed
+}
+
+void BoundsSystem::Tick(float delta_time) {
+	size_t model_generation = render::Renderer::GetInstance().GetModelGeneration();
+	models_changed_ = model_generation != model_generation_;
+	model_generation_ = model_generation;
+}
+
+void BoundsSystem::TickArchetype(ecs::Archetype& archetype, float delta_time) {
+	archetype.ForEachChunk([&](const ecs::ArchetypeChunk& chunk) {
+		TickChunk(archetype, chunk, delta_time);
+	});
+}
+
+void BoundsSystem::TickChunk(ecs::Archetype& archetype, const ecs::ArchetypeChunk& chunk,
+							 float delta_time) {
+	// Bounds only depend on the world matrix and the model, so chunks where neither was written
+	// since the last run are up to date, unless a model they use was loaded since.
+	size_t world_matrix_column = archetype.GetColumnIndex(
+			ecs::GetAttributeTypeId<attributes::WorldMatrix>());
+	size_t static_mesh_column = archetype.GetColumnIndex(
+			ecs::GetAttributeTypeId<attributes::StaticMesh>());
+	if (!models_changed_ &&
+		archetype.GetChangedTick(chunk.index, world_matrix_column) <= GetLastRunTick() &&
+		archetype.GetChangedTick(chunk.index, static_mesh_column) <= GetLastRunTick()) {
+		return;
+	}
+
+	const render::Renderer& renderer = render::Renderer::GetInstance();
+	attributes::Bounds* bounds = archetype.TryGetColumn<attributes::Bounds>(
+			chunk, ecs::GetAttributeTypeId<attributes::Bounds>());
+	if (bounds == nullptr) {
+		fallback_query_.ForEach(archetype, chunk, [&renderer](
+				ecs::EntityID entity_id, const attributes::WorldMatrix& world_matrix,
+				const attributes::StaticMesh& static_mesh, attributes::Bounds& entity_bounds) {
+			ComputeBounds(renderer, world_matrix, static_mesh, entity_bounds);
+		});
+		return;
+	}
+	const attributes::WorldMatrix* world_matrices =
+			archetype.GetColumn<const attributes::WorldMatrix>(
+					chunk, ecs::GetAttributeTypeId<attributes::WorldMatrix>());
+	const attributes::StaticMesh* static_meshes = archetype.GetColumn<const attributes::StaticMesh>(
+			chunk, ecs::GetAttributeTypeId<attributes::StaticMesh>());
+	for (size_t i = 0; i < chunk.size; ++i) {
+		ComputeBounds(renderer, world_matrices[i], static_meshes[i], bounds[i]);
+	}
+}
+
+ecs::SystemAccess BoundsSystem::GetAccess() const {
+	// Chunks are independent, so they are split into separate jobs. Models are only loaded
+	// outside of the systems update, so reading the model bounds from the renderer is safe.
+	ecs::SystemAccess access;
+	access.reads = ecs::Signature<attributes::WorldMatrix, attributes::StaticMesh>();
+	access.writes = ecs::Signature<attributes::Bounds>();
+	access.main_thread_only = false;
+	access.per_chunk = true;
+	return access;
+}
+} // namespace core::systems
@@ -0,0 +1,41 @@
+#ifndef CORE_SYSTEMS_BOUNDS_SYSTEM_H
+#define CORE_SYSTEMS_BOUNDS_SYSTEM_H
+
+#include "core/attributes/bounds.h"
+#include "core/attributes/static_mesh.h"
+#include "core/attributes/world_matrix.h"
+#include "core/ecs/archetype.h"
+#include "core/ecs/ecs_manager.h"
+#include "core/ecs/query.h"
+#include "core/ecs/system.h"
+
+namespace core::systems {
+
+// Keeps the Bounds of every entity in sync with its WorldMatrix and StaticMesh, transforming the
+// bounding sphere of the model into world space. Chunks whose world matrices and meshes were not
+// written since the last run are skipped, unless the Renderer loaded models since. Must run after
+// the systems writing world matrices. Entities whose model is not loaded by the Renderer get an
+// unbounded sphere, so they are never culled, until their model is loaded.
+class BoundsSystem : public ecs::System {
+public:
+	void Start() override;
+	void StartArchetype(ecs::Archetype& archetype) override;
+	void Tick(float delta_time) override;
+	void TickArchetype(ecs::Archetype& archetype, float delta_time) override;
+	void TickChunk(ecs::Archetype& archetype, const ecs::ArchetypeChunk& chunk,
+				   float delta_time) override;
+	ecs::SystemAccess GetAccess() const override;
+
+private:
+	ecs::ECSManager& ecs_manager_ = ecs::ECSManager::GetInstance();
+	// Per entity updates of the chunks whose columns are not contiguous.
+	ecs::Query<const attributes::WorldMatrix, const attributes::StaticMesh, attributes::Bounds>
+			fallback_query_;
+	// Model generation of the Renderer at the last run, and whether it changed since the run
+	// before. Set by Tick, read by the chunks.
+	size_t model_generation_ = 0;
+	bool models_changed_ = false;
+};
+} // namespace core::systems
+
+#endif // CORE_SYSTEMS_BOUNDS_SYSTEM_H
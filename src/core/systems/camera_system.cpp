@@ -5,6 +5,7 @@
 
 #include "core/attributes/camera.h"
 #include "core/attributes/transform.h"
+#include "core/attributes/world_matrix.h"
 
 
 namespace core::systems {
@@ -22,16 +23,20 @@ void CameraSystem::Tick(float delta_time) {
 }
 
 void CameraSystem::TickArchetype(ecs::Archetype& archetype, float delta_time) {
-	archetype.ForEach([this, delta_time, &archetype](ecs::EntityID entity_id, size_t index) {
-		attributes::Camera& camera = ecs_manager_.GetAttribute<attributes::Camera>(entity_id);
-		attributes::Transform& transform = ecs_manager_.GetAttribute<attributes::Transform>(entity_id);
-
+	auto query = ecs_manager_.GetQuery<attributes::Camera, const attributes::Transform,
+									   ecs::Optional<const attributes::WorldMatrix>>();
+	query.ForEach(archetype, [this](ecs::EntityID entity_id, attributes::Camera& camera,
+									const attributes::Transform& transform,
+									const attributes::WorldMatrix* world_matrix) {
+		// Cameras placed in a hierarchy take their position from their world matrix.
+		glm::vec3 position = world_matrix != nullptr ? glm::vec3(world_matrix->matrix[3])
+													 : transform.position;
 		// Update view matrix based on transform
-		if (camera.look_at != 0) {
-			attributes::Transform& target_transform = ecs_manager_.GetAttribute<attributes::Transform>(camera.look_at);
-			camera.view_matrix = glm::lookAt(transform.position, target_transform.position, glm::vec3(0.0f, 1.0f, 0.0f));
+		if (ecs_manager_.IsAlive(camera.look_at)) {
+			const attributes::Transform& target_transform = ecs_manager_.GetAttribute<const attributes::Transform>(camera.look_at);
+			camera.view_matrix = glm::lookAt(position, target_transform.position, glm::vec3(0.0f, 1.0f, 0.0f));
 		} else {
-			glm::mat4 translation = glm::translate(glm::mat4(1.0f), -transform.position);
+			glm::mat4 translation = glm::translate(glm::mat4(1.0f), -position);
 			glm::mat4 rotation = glm::yawPitchRoll(glm::radians(-transform.rotation.y), glm::radians(-transform.rotation.x), glm::radians(-transform.rotation.z));
 			camera.view_matrix = rotation * translation;
 		}
@@ -41,4 +46,12 @@ void CameraSystem::TickArchetype(ecs::Archetype& archetype, float delta_time) {
 		camera.projection_matrix = glm::perspective(glm::radians(camera.fov), aspect_ratio, camera.near_plane, camera.far_plane);
 	});
 }
+
+ecs::SystemAccess CameraSystem::GetAccess() const {
+	ecs::SystemAccess access;
+	access.reads = ecs::Signature<attributes::Transform, attributes::WorldMatrix>();
+	access.writes = ecs::Signature<attributes::Camera>();
+	access.main_thread_only = false;
+	return access;
+}
 } // namespace core::systems
@@ -13,6 +13,7 @@ public:
 	void StartArchetype(ecs::Archetype& archetype) override;
 	void Tick(float delta_time) override;
 	void TickArchetype(ecs::Archetype& archetype, float delta_time) override;
+	ecs::SystemAccess GetAccess() const override;
 
 private:
 	ecs::ECSManager& ecs_manager_ = ecs::ECSManager::GetInstance();
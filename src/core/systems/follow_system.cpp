@@ -3,9 +3,6 @@
 #include "core/attributes/transform.h"
 #include "core/attributes/follow.h"
 
-
-#include <iostream>
-
 namespace core::systems {
 
 void FollowSystem::Start() {
@@ -21,21 +18,27 @@ void FollowSystem::Tick(float delta_time) {
 }
 
 void FollowSystem::TickArchetype(ecs::Archetype& archetype, float delta_time) {
-	archetype.ForEach([this, delta_time, &archetype](ecs::EntityID entity_id, size_t index) {
-		std::cout << "Ticking FollowSystem for entity " << entity_id << std::endl;
-		attributes::Follow& follow = ecs_manager_.GetAttribute<attributes::Follow>(entity_id);
-		attributes::Transform& transform = ecs_manager_.GetAttribute<attributes::Transform>(entity_id);
-		std::cout << "Following entity " << follow.target_entity << std::endl;
-		attributes::Transform& target_transform = ecs_manager_.GetAttribute<attributes::Transform>(follow.target_entity);
-		std::cout << "CRASHED" << std::endl;
+	auto query = ecs_manager_.GetQuery<const attributes::Follow, attributes::Transform>();
+	query.ForEach(archetype, [this](ecs::EntityID entity_id, const attributes::Follow& follow,
+									attributes::Transform& transform) {
+		if (!ecs_manager_.IsAlive(follow.target_entity)) {
+			return;
+		}
+		const attributes::Transform& target_transform = ecs_manager_.GetAttribute<const attributes::Transform>(follow.target_entity);
 
 		transform.position = target_transform.position + follow.offset;
 
 		if (follow.match_rotation) {
 			transform.rotation = target_transform.rotation;
 		}
-		std::cout << "Updated position to (" << transform.position.x << ", "
-				  << transform.position.y << ", " << transform.position.z << ")\n";
 	});
-} 
-} // namespace core::systems
\ No newline at end of file
+}
+
+ecs::SystemAccess FollowSystem::GetAccess() const {
+	ecs::SystemAccess access;
+	access.reads = ecs::Signature<attributes::Follow>();
+	access.writes = ecs::Signature<attributes::Transform>();
+	access.main_thread_only = false;
+	return access;
+}
+} // namespace core::systems
@@ -0,0 +1,32 @@
+#include "hierarchy_system.h"
+
+#include "core/attributes/hierarchy.h"
+#include "core/attributes/transform.h"
+#include "core/attributes/world_matrix.h"
+
+namespace core::systems {
+
+void HierarchySystem::Start() {
+	// Initialization if needed
+}
+
+void HierarchySystem::StartArchetype(ecs::Archetype& archetype) {
+	// Initialization per archetype if needed
+}
+
+void HierarchySystem::Tick(float delta_time) {
+	hierarchy_manager_.PropagateTransforms();
+}
+
+void HierarchySystem::TickArchetype(ecs::Archetype& archetype, float delta_time) {
+	// Propagated for all archetypes at once in Tick.
+}
+
+ecs::SystemAccess HierarchySystem::GetAccess() const {
+	ecs::SystemAccess access;
+	access.reads = ecs::Signature<attributes::Transform, attributes::Hierarchy>();
+	access.writes = ecs::Signature<attributes::WorldMatrix>();
+	access.main_thread_only = false;
+	return access;
+}
+} // namespace core::systems
@@ -0,0 +1,27 @@
+#ifndef CORE_SYSTEMS_HIERARCHY_SYSTEM_H
+#define CORE_SYSTEMS_HIERARCHY_SYSTEM_H
+
+#include "core/ecs/archetype.h"
+#include "core/ecs/ecs_manager.h"
+#include "core/ecs/system.h"
+#include "core/managers/hierarchy_manager.h"
+
+namespace core::systems {
+
+// Keeps the WorldMatrix of the entities with a Hierarchy attribute in sync with their Transform
+// and the world matrix of their parent. The whole hierarchy is propagated once per update by the
+// HierarchyManager, so there is nothing to do per archetype.
+class HierarchySystem : public ecs::System {
+public:
+	void Start() override;
+	void StartArchetype(ecs::Archetype& archetype) override;
+	void Tick(float delta_time) override;
+	void TickArchetype(ecs::Archetype& archetype, float delta_time) override;
+	ecs::SystemAccess GetAccess() const override;
+
+private:
+	managers::HierarchyManager& hierarchy_manager_ = managers::HierarchyManager::GetInstance();
+};
+} // namespace core::systems
+
+#endif // CORE_SYSTEMS_HIERARCHY_SYSTEM_H
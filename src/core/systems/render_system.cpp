@@ -1,12 +1,18 @@
 #include "render_system.h"
 
+#include <cstddef>
+#include <cstdint>
+
+#include "core/attributes/bounds.h"
+#include "core/attributes/camera.h"
 #include "core/attributes/static_mesh.h"
-#include "core/attributes/transform.h"
+#include "core/attributes/world_matrix.h"
 #include "core/render/drawable.h"
 #include "core/render/renderer.h"
 #include "core/ecs/archetype.h"
 #include "core/ecs/types.h"
 #include "core/managers/scene_manager.h"
+#include "core/math/frustum_culling.h"
 
 namespace core::systems {
 
@@ -19,23 +25,89 @@ void RenderSystem::StartArchetype(ecs::Archetype& archetype) {
 }
 
 void RenderSystem::Tick(float delta_time) {
-	// Tick
+	// Size the frame queue once for every drawable entity.
+	auto query = ecs_manager_.GetQuery<const attributes::WorldMatrix, const attributes::StaticMesh>();
+	size_t drawable_count = 0;
+	for (ecs::Archetype* archetype :
+		 ecs_manager_.GetArchetypeManager().QueryArchetypes(query.GetTerms())) {
+		drawable_count += archetype->GetEntityCount();
+	}
+	render::Renderer::GetInstance().ReserveDrawables(drawable_count);
+
+	// Camera matrices are up to date, the CameraSystem runs before the render phase.
+	ecs::EntityID camera_id = managers::SceneManager::GetInstance().GetMainCamera();
+	cull_ = ecs_manager_.HasAttribute<attributes::Camera>(camera_id);
+	if (cull_) {
+		const attributes::Camera& camera = ecs_manager_.GetAttribute<const attributes::Camera>(
+				camera_id);
+		frustum_ = math::ExtractFrustum(camera.projection_matrix * camera.view_matrix);
+	}
 }
 
 void RenderSystem::TickArchetype(ecs::Archetype& archetype, float delta_time) {
-	archetype.ForEach([this, delta_time](ecs::EntityID entity_id, size_t index) {
-		attributes::Transform& transform = ecs_manager_.GetAttribute<attributes::Transform>(entity_id);
-		attributes::StaticMesh& static_mesh = ecs_manager_.GetAttribute<attributes::StaticMesh>(entity_id);
-
+	// Drawables are only queued here; the renderer draws the whole frame at once, see
+	// Renderer::DrawFrame.
+	render::Renderer& renderer = render::Renderer::GetInstance();
+	auto submit = [&renderer](const attributes::WorldMatrix& world_matrix,
+							  const attributes::StaticMesh& static_mesh) {
 		render::Drawable drawable;
 		drawable.model_id = static_mesh.model_id;
-		drawable.model_matrix = transform.GetModelMatrix();
+		drawable.model_matrix = world_matrix.matrix;
+		renderer.Submit(drawable);
+	};
 
-		render::Renderer& renderer = render::Renderer::GetInstance();
+	bool has_bounds = archetype.GetSignature().test(ecs::GetAttributeTypeId<attributes::Bounds>());
+	if (!cull_ || !has_bounds) {
+		auto query = ecs_manager_.GetQuery<const attributes::WorldMatrix,
+										   const attributes::StaticMesh>();
+		query.ForEach(archetype, [&submit](ecs::EntityID entity_id,
+										   const attributes::WorldMatrix& world_matrix,
+										   const attributes::StaticMesh& static_mesh) {
+			submit(world_matrix, static_mesh);
+		});
+		return;
+	}
 
-		// TODO: Remove hardcoded value
-
-		renderer.Draw({drawable}, managers::SceneManager::GetInstance().GetMainCamera());
+	// Test the bounds of a whole chunk at once, then submit the visible entities.
+	visible_indices_.resize(archetype.GetEntitiesPerChunk());
+	archetype.ForEachChunk([&](const ecs::ArchetypeChunk& chunk) {
+		const attributes::Bounds* bounds = archetype.TryGetColumn<const attributes::Bounds>(
+				chunk, ecs::GetAttributeTypeId<attributes::Bounds>());
+		if (bounds == nullptr) {
+			// Columns are not contiguous, test the entities one by one.
+			fallback_query_.ForEach(archetype, chunk, [this, &submit](
+					ecs::EntityID entity_id, const attributes::WorldMatrix& world_matrix,
+					const attributes::StaticMesh& static_mesh,
+					const attributes::Bounds& entity_bounds) {
+				if (math::IsSphereVisible(frustum_, entity_bounds)) {
+					submit(world_matrix, static_mesh);
+				}
+			});
+			return;
+		}
+		size_t visible_count = math::CullSpheres(frustum_, bounds, chunk.size,
+												 visible_indices_.data());
+		if (visible_count == 0) {
+			return;
+		}
+		const attributes::WorldMatrix* world_matrices =
+				archetype.GetColumn<const attributes::WorldMatrix>(
+						chunk, ecs::GetAttributeTypeId<attributes::WorldMatrix>());
+		const attributes::StaticMesh* static_meshes =
+				archetype.GetColumn<const attributes::StaticMesh>(
+						chunk, ecs::GetAttributeTypeId<attributes::StaticMesh>());
+		for (size_t i = 0; i < visible_count; ++i) {
+			uint32_t index = visible_indices_[i];
+			submit(world_matrices[index], static_meshes[index]);
+		}
 	});
 }
+
+ecs::SystemAccess RenderSystem::GetAccess() const {
+	// Fills the frame queue of the renderer, so it stays on the main thread.
+	ecs::SystemAccess access;
+	access.reads = ecs::Signature<attributes::WorldMatrix, attributes::StaticMesh,
+								  attributes::Bounds, attributes::Camera>();
+	return access;
+}
 } // namespace core::systems
@@ -1,21 +1,42 @@
 #ifndef CORE_SYSTEMS_RENDER_SYSTEM_H
 #define CORE_SYSTEMS_RENDER_SYSTEM_H
 
+#include <cstdint>
+#include <vector>
+
+#include "core/attributes/bounds.h"
+#include "core/attributes/static_mesh.h"
+#include "core/attributes/world_matrix.h"
 #include "core/ecs/archetype.h"
 #include "core/ecs/ecs_manager.h"
+#include "core/ecs/query.h"
 #include "core/ecs/system.h"
+#include "core/math/frustum_culling.h"
 
 namespace core::systems {
 
+// Queues the drawables of every entity with a WorldMatrix and a StaticMesh into the Renderer.
+// Entities with Bounds are first tested against the frustum of the main camera, and skipped when
+// they are outside of it.
 class RenderSystem : public ecs::System {
 public:
 	void Start() override;
 	void StartArchetype(ecs::Archetype& archetype) override;
 	void Tick(float delta_time) override;
 	void TickArchetype(ecs::Archetype& archetype, float delta_time) override;
+	ecs::SystemAccess GetAccess() const override;
 
 private:
 	ecs::ECSManager& ecs_manager_ = ecs::ECSManager::GetInstance();
+	// Frustum of the main camera for the current frame. Culling is disabled while there is no
+	// main camera.
+	math::Frustum frustum_;
+	bool cull_ = false;
+	// Per entity culling of the chunks whose columns are not contiguous.
+	ecs::Query<const attributes::WorldMatrix, const attributes::StaticMesh,
+			   const attributes::Bounds> fallback_query_;
+	// Indices of the visible entities of the chunk being submitted.
+	std::vector<uint32_t> visible_indices_;
 };
 } // namespace core::systems
 
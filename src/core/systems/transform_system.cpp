@@ -0,0 +1,65 @@
+#include "transform_system.h"
+
+#include "core/attributes/hierarchy.h"
+#include "core/attributes/transform.h"
+#include "core/attributes/world_matrix.h"
+#include "core/math/transform_kernels.h"
+
+namespace core::systems {
+
+void TransformSystem::Start() {
+	// Initialization if needed
+}
+
+void TransformSystem::StartArchetype(ecs::Archetype& archetype) {
+	// Initialization per archetype if needed
+}
+
+void TransformSystem::Tick(float delta_time) {
+	// Tick
+}
+
+void TransformSystem::TickArchetype(ecs::Archetype& archetype, float delta_time) {
+	archetype.ForEachChunk([&](const ecs::ArchetypeChunk& chunk) {
+		TickChunk(archetype, chunk, delta_time);
+	});
+}
+
+void TransformSystem::TickChunk(ecs::Archetype& archetype, const ecs::ArchetypeChunk& chunk,
+								float delta_time) {
+	// World matrices of hierarchy entities depend on their parents, see HierarchySystem.
+	if (archetype.GetSignature().test(ecs::GetAttributeTypeId<attributes::Hierarchy>())) {
+		return;
+	}
+	// Chunks whose transforms were not written since the last run are up to date.
+	size_t transform_column = archetype.GetColumnIndex(
+			ecs::GetAttributeTypeId<attributes::Transform>());
+	if (archetype.GetChangedTick(chunk.index, transform_column) <= GetLastRunTick()) {
+		return;
+	}
+	const attributes::Transform* transforms = archetype.TryGetColumn<const attributes::Transform>(
+			chunk, ecs::GetAttributeTypeId<attributes::Transform>());
+	if (transforms == nullptr) {
+		fallback_query_.ForEach(archetype, chunk, [](ecs::EntityID entity_id,
+													 const attributes::Transform& transform,
+													 attributes::WorldMatrix& world_matrix) {
+			world_matrix.matrix = transform.GetModelMatrix();
+		});
+		return;
+	}
+	// Recomputing the whole chunk in batches is cheaper than picking out changed entities.
+	attributes::WorldMatrix* world_matrices = archetype.GetColumn<attributes::WorldMatrix>(
+			chunk, ecs::GetAttributeTypeId<attributes::WorldMatrix>());
+	math::ComputeWorldMatrices(transforms, world_matrices, chunk.size);
+}
+
+ecs::SystemAccess TransformSystem::GetAccess() const {
+	// Chunks are independent, so they are split into separate jobs.
+	ecs::SystemAccess access;
+	access.reads = ecs::Signature<attributes::Transform>();
+	access.writes = ecs::Signature<attributes::WorldMatrix>();
+	access.main_thread_only = false;
+	access.per_chunk = true;
+	return access;
+}
+} // namespace core::systems
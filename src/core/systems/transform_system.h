@@ -0,0 +1,33 @@
+#ifndef CORE_SYSTEMS_TRANSFORM_SYSTEM_H
+#define CORE_SYSTEMS_TRANSFORM_SYSTEM_H
+
+#include "core/attributes/transform.h"
+#include "core/attributes/world_matrix.h"
+#include "core/ecs/archetype.h"
+#include "core/ecs/ecs_manager.h"
+#include "core/ecs/query.h"
+#include "core/ecs/system.h"
+
+namespace core::systems {
+
+// Keeps the WorldMatrix of every entity in sync with its Transform. Chunks whose transforms were
+// not written since the last run are skipped, the others are recomputed with the batched
+// transform kernel. Entities with a Hierarchy attribute are left to the HierarchySystem.
+class TransformSystem : public ecs::System {
+public:
+	void Start() override;
+	void StartArchetype(ecs::Archetype& archetype) override;
+	void Tick(float delta_time) override;
+	void TickArchetype(ecs::Archetype& archetype, float delta_time) override;
+	void TickChunk(ecs::Archetype& archetype, const ecs::ArchetypeChunk& chunk,
+				   float delta_time) override;
+	ecs::SystemAccess GetAccess() const override;
+
+private:
+	ecs::ECSManager& ecs_manager_ = ecs::ECSManager::GetInstance();
+	// Per entity updates of the chunks whose columns are not contiguous.
+	ecs::Query<const attributes::Transform, attributes::WorldMatrix> fallback_query_;
+};
+} // namespace core::systems
+
+#endif // CORE_SYSTEMS_TRANSFORM_SYSTEM_H
@@ -3,16 +3,21 @@
 #include "core/ecs/ecs_manager.h"
 #include "core/ecs/types.h"
 #include "core/attributes/transform.h"
+#include "core/attributes/world_matrix.h"
+#include "core/attributes/bounds.h"
 #include "core/attributes/camera.h"
+#include "core/systems/bounds_system.h"
 #include "core/systems/camera_system.h"
 #include "core/systems/render_system.h"
+#include "core/systems/transform_system.h"
 #include "core/render/renderer.h"
 #include "core/platform/window.h"
 #include "core/assetloader/asset_loader_manager.h"
 #include "core/attributes/static_mesh.h"
 #include "core/time/apptime.h"
-#include "core/attributes/follow.h"
-#include "core/systems/follow_system.h"
+#include "core/attributes/hierarchy.h"
+#include "core/systems/hierarchy_system.h"
+#include "core/managers/hierarchy_manager.h"
 #include "core/managers/scene_manager.h"
 
 #include "projects/Trains/managers/map_manager.h"
@@ -56,32 +61,41 @@ graphics::Mesh CreateSquare(float size, glm::vec3 origin) {
 
 void RegisterAttributesAndSystems() {
 	core::ecs::ECSManager& ecs_manager = core::ecs::ECSManager::GetInstance();
-	ecs_manager.RegisterAttribute<core::attributes::Transform>();
-	ecs_manager.RegisterAttribute<core::attributes::Camera>();
-	ecs_manager.RegisterAttribute<core::attributes::StaticMesh>();
-	ecs_manager.RegisterAttribute<trains::attributes::Train>();
-	ecs_manager.RegisterAttribute<core::attributes::Follow>();
-
-	core::ecs::ArchetypeSignature camera_signature;
-	camera_signature.set(0); // Transform
-	camera_signature.set(1); // Camera
-	ecs_manager.RegisterSystem<core::systems::CameraSystem>(camera_signature);
-
-	core::ecs::ArchetypeSignature render_signature;
-	render_signature.set(0); // Transform
-	render_signature.set(2); // StaticMesh
-	ecs_manager.RegisterSystem<core::systems::RenderSystem>(render_signature);
-
-	core::ecs::ArchetypeSignature train_signature;
-	train_signature.set(0); // Transform
-	train_signature.set(2); // StaticMesh
-	train_signature.set(3); // Train
-	ecs_manager.RegisterSystem<trains::systems::TrainSystem>(train_signature);
-
-	core::ecs::ArchetypeSignature follow_signature;
-	follow_signature.set(0); // Transform
-	follow_signature.set(4); // Follow
-	ecs_manager.RegisterSystem<core::systems::FollowSystem>(follow_signature);
+	ecs_manager.RegisterAttribute<core::attributes::Transform>("Transform");
+	ecs_manager.RegisterAttribute<core::attributes::Camera>("Camera");
+	ecs_manager.RegisterAttribute<core::attributes::StaticMesh>("StaticMesh");
+	ecs_manager.RegisterAttribute<core::attributes::WorldMatrix>("WorldMatrix");
+	ecs_manager.RegisterAttribute<trains::attributes::Train>("Train");
+	ecs_manager.RegisterAttribute<core::attributes::Hierarchy>("Hierarchy");
+	ecs_manager.RegisterAttribute<core::attributes::Bounds>("Bounds");
+
+	ecs_manager.RegisterSystem<trains::systems::TrainSystem>(
+			core::ecs::Signature<core::attributes::Transform, core::attributes::StaticMesh,
+								 trains::attributes::Train>(),
+			core::ecs::SystemPhase::kUpdate);
+	ecs_manager.RegisterSystem<core::systems::HierarchySystem>(
+			core::ecs::Signature<core::attributes::Hierarchy>(),
+			core::ecs::SystemPhase::kPostUpdate);
+	ecs_manager.RegisterSystem<core::systems::CameraSystem>(
+			core::ecs::Signature<core::attributes::Transform, core::attributes::Camera>(),
+			core::ecs::SystemPhase::kPostUpdate);
+	ecs_manager.RegisterSystem<core::systems::TransformSystem>(
+			core::ecs::Signature<core::attributes::Transform, core::attributes::WorldMatrix>(),
+			core::ecs::SystemPhase::kPostUpdate);
+	ecs_manager.RegisterSystem<core::systems::BoundsSystem>(
+			core::ecs::Signature<core::attributes::WorldMatrix, core::attributes::StaticMesh,
+								 core::attributes::Bounds>(),
+			core::ecs::SystemPhase::kPostUpdate);
+	ecs_manager.RegisterSystem<core::systems::RenderSystem>(
+			core::ecs::Signature<core::attributes::WorldMatrix, core::attributes::StaticMesh>(),
+			core::ecs::SystemPhase::kRender);
+
+	// The camera is a child of the train, so it has to see this frame's world matrices.
+	ecs_manager.SetSystemOrder<core::systems::HierarchySystem, core::systems::CameraSystem>();
+	ecs_manager.SetSystemOrder<core::systems::TransformSystem, core::systems::CameraSystem>();
+	// Bounds follow the world matrices of this frame, so culling matches what is drawn.
+	ecs_manager.SetSystemOrder<core::systems::HierarchySystem, core::systems::BoundsSystem>();
+	ecs_manager.SetSystemOrder<core::systems::TransformSystem, core::systems::BoundsSystem>();
 }
 
 int main() {
@@ -91,6 +105,8 @@ int main() {
 
 	core::assetloader::AssetLoaderManager& asset_loader_ = core::assetloader::AssetLoaderManager::GetInstance();
 	core::render::Renderer& renderer_ = core::render::Renderer::GetInstance();
+	// The map is a few models repeated many times, drawn with a handful of multi-draws.
+	renderer_.EnableMultiDrawIndirect();
 	auto model_res = asset_loader_.GetModelByPath("Train/Debug/debug_train/debug_train.obj");
 	size_t model_id;
 	if (model_res.has_value()) {
@@ -124,6 +140,10 @@ int main() {
 	core::attributes::StaticMesh train_mesh;
 	train_mesh.model_id = model_id;
 	ecs_manager.AddAttribute<core::attributes::StaticMesh>(train.id, train_mesh);
+	core::attributes::WorldMatrix train_world_matrix;
+	ecs_manager.AddAttribute<core::attributes::WorldMatrix>(train.id, train_world_matrix);
+	core::attributes::Bounds train_bounds;
+	ecs_manager.AddAttribute<core::attributes::Bounds>(train.id, train_bounds);
 	trains::attributes::Train train_attr;
 	train_attr.current_tile_coord = starting_tile_coords;
 	train_attr.next_tile_coord = starting_tile_coords;
@@ -133,18 +153,18 @@ int main() {
 
 	core::ecs::Entity entity = ecs_manager.CreateEntity();
 	core::attributes::Transform transform;
-	transform.position = glm::vec3(0.0f, 700.0f, 0.0f);
+	// Relative to the train, whose space is scaled by 10.
+	transform.position = glm::vec3(0.0f, 5.0f, 8.0f);
 	transform.rotation = glm::vec3(-90.0f, 0.0f, 0.0f);
 	ecs_manager.AddAttribute<core::attributes::Transform>(entity.id, transform);
 	core::attributes::Camera camera;
 	camera.look_at = train.id;
 	ecs_manager.AddAttribute<core::attributes::Camera>(entity.id, camera);
+	core::attributes::WorldMatrix camera_world_matrix;
+	ecs_manager.AddAttribute<core::attributes::WorldMatrix>(entity.id, camera_world_matrix);
 	std::cout << "Created camera entity with ID: " << entity.id << std::endl;
-	core::attributes::Follow follow;
-	follow.target_entity = train.id;
-	follow.offset = glm::vec3(0.0f, 50.0f, 80.0f);
-	follow.match_rotation = true;
-	ecs_manager.AddAttribute<core::attributes::Follow>(entity.id, follow);
+	// The camera follows the train as its child.
+	core::managers::HierarchyManager::GetInstance().SetParent(entity.id, train.id);
 
 	core::managers::SceneManager& scene_manager = core::managers::SceneManager::GetInstance();
 	scene_manager.SetMainCamera(entity.id);
@@ -156,6 +176,8 @@ int main() {
 		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
 		ecs_manager.UpdateSystems(Time::GetInstance().GetDeltaTime());
+		// Draws everything the render systems queued this frame.
+		renderer_.DrawFrame(scene_manager.GetMainCamera());
 
         glfwSwapBuffers(window.GetInstance());
         glfwPollEvents();
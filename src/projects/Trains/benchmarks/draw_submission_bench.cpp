@@ -0,0 +1,135 @@
+// Times the CPU side of drawing a frame of a radius-50 Trains map: the RenderSystem submitting
+// every tile to the renderer's queue, then the queue building its instanced draws and sorted
+// commands. Neither step touches GL, so the benchmark runs without a window or context.
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <unordered_map>
+#include <vector>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "core/attributes/camera.h"
+#include "core/attributes/static_mesh.h"
+#include "core/attributes/transform.h"
+#include "core/attributes/world_matrix.h"
+#include "core/ecs/archetype.h"
+#include "core/ecs/ecs_manager.h"
+#include "core/ecs/entity.h"
+#include "core/render/render_model_data.h"
+#include "core/render/render_queue.h"
+#include "core/render/renderer.h"
+#include "core/systems/render_system.h"
+#include "projects/Trains/managers/map_manager.h"
+
+namespace {
+
+constexpr int kMapRadius = 50;
+constexpr size_t kFrames = 200;
+constexpr size_t kTileModel = 0;
+
+// Same tiles as MapManager::GenerateBase. The manager itself loads its tile models from the
+// resource folder, which needs a GL context, so the layout is rebuilt here.
+void GenerateBase(int radius) {
+	std::vector<TileCoord> coords;
+	for (int q = -radius; q <= radius; ++q) {
+		int r1 = std::max(-radius, -q - radius);
+		int r2 = std::min(radius, -q + radius);
+		for (int r = r1; r <= r2; ++r) {
+			coords.push_back({q, r});
+		}
+	}
+	core::ecs::ECSManager::GetInstance().CreateEntities<core::attributes::Transform,
+														 core::attributes::WorldMatrix,
+														 core::attributes::StaticMesh>(
+			coords.size(),
+			[&](const core::ecs::Entity&, size_t index, core::attributes::Transform& transform,
+				core::attributes::WorldMatrix& world_matrix,
+				core::attributes::StaticMesh& static_mesh) {
+		transform.position = coords[index].ToWorldPosition();
+		transform.scale = glm::vec3(10.0f, 10.0f, 10.0f);
+		world_matrix.matrix = transform.GetModelMatrix();
+		static_mesh.model_id = kTileModel;
+	});
+}
+
+// Stand-in for the render data of a tile model with one mesh and one material. Only the fields
+// read while building the queue matter.
+core::render::RenderModelData MakeTileModelData() {
+	core::render::RenderModelData model_data;
+	model_data.meshInstances.push_back({0, 0, glm::mat4(1.0f)});
+	core::render::RenderMeshData mesh_data{};
+	core::render::RenderMaterialData material_data{};
+	model_data.meshDatas.push_back(mesh_data);
+	model_data.materialDatas.push_back(material_data);
+	return model_data;
+}
+
+struct Timings {
+	double total = 0.0;
+	double best = 1e30;
+
+	void Add(double microseconds) {
+		total += microseconds;
+		best = std::min(best, microseconds);
+	}
+};
+} // namespace
+
+int main() {
+	core::ecs::ECSManager& ecs_manager = core::ecs::ECSManager::GetInstance();
+	ecs_manager.RegisterAttribute<core::attributes::Transform>("Transform");
+	ecs_manager.RegisterAttribute<core::attributes::WorldMatrix>("WorldMatrix");
+	ecs_manager.RegisterAttribute<core::attributes::StaticMesh>("StaticMesh");
+	ecs_manager.RegisterAttribute<core::attributes::Camera>("Camera");
+	GenerateBase(kMapRadius);
+
+	std::unordered_map<size_t, core::render::RenderModelData> models;
+	models[kTileModel] = MakeTileModelData();
+	core::attributes::Camera camera;
+	camera.view_matrix = glm::lookAt(glm::vec3(0.0f, 300.0f, 300.0f), glm::vec3(0.0f),
+									 glm::vec3(0.0f, 1.0f, 0.0f));
+	camera.projection_matrix = glm::perspective(glm::radians(camera.fov), 16.0f / 9.0f,
+												camera.near_plane, camera.far_plane);
+
+	// Without a main camera the RenderSystem does not cull, so every tile is submitted.
+	core::systems::RenderSystem render_system;
+	auto query = ecs_manager.GetQuery<const core::attributes::WorldMatrix,
+									  const core::attributes::StaticMesh>();
+	std::vector<core::ecs::Archetype*> archetypes =
+			ecs_manager.GetArchetypeManager().QueryArchetypes(query.GetTerms());
+	core::render::RenderQueue& queue = core::render::Renderer::GetInstance().GetQueue();
+
+	Timings submission;
+	Timings build;
+	size_t drawables = 0;
+	for (size_t frame = 0; frame <= kFrames; ++frame) {
+		auto start = std::chrono::steady_clock::now();
+		render_system.Tick(0.0f);
+		for (core::ecs::Archetype* archetype : archetypes) {
+			render_system.TickArchetype(*archetype, 0.0f);
+		}
+		auto submitted = std::chrono::steady_clock::now();
+		drawables = queue.GetDrawableCount();
+		queue.Build(models, camera);
+		auto built = std::chrono::steady_clock::now();
+		queue.Clear();
+		// The first frame grows the buffers and is not counted.
+		if (frame > 0) {
+			submission.Add(std::chrono::duration<double, std::micro>(submitted - start).count());
+			build.Add(std::chrono::duration<double, std::micro>(built - submitted).count());
+		}
+	}
+
+	std::printf("Radius %d map, %zu drawables, %zu instanced draws, %zu frames.\n", kMapRadius,
+				drawables, queue.GetInstancedDraws().size(), kFrames);
+	std::printf("%-28s %10s %10s\n", "microseconds per frame", "mean", "best");
+	std::printf("%-28s %10.1f %10.1f\n", "submission (RenderSystem)", submission.total / kFrames,
+				submission.best);
+	std::printf("%-28s %10.1f %10.1f\n", "queue build (draws + sort)", build.total / kFrames,
+				build.best);
+	return 0;
+}
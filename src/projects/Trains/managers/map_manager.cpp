@@ -8,8 +8,10 @@
 #include <chrono>
 
 #include "core/ecs/ecs_manager.h"
+#include "core/attributes/bounds.h"
 #include "core/attributes/transform.h"
 #include "core/attributes/static_mesh.h"
+#include "core/attributes/world_matrix.h"
 #include "core/assetloader/asset_loader_manager.h"
 #include "core/render/renderer.h"
 #include "core/graphics/model.h"
@@ -173,8 +175,8 @@ void MapManager::PlaceRails() {
 			auto it_current = coords_to_tiles_.find(current);
 			auto it_neighbor = coords_to_tiles_.find(neighbor);
 
-			Transform& current_transform = ecs_manager_.GetAttribute<core::attributes::Transform>(it_current->second.id);
-			Transform& neighbor_transform = ecs_manager_.GetAttribute<core::attributes::Transform>(it_neighbor->second.id);
+			const Transform& current_transform = ecs_manager_.GetAttribute<const core::attributes::Transform>(it_current->second.id);
+			const Transform& neighbor_transform = ecs_manager_.GetAttribute<const core::attributes::Transform>(it_neighbor->second.id);
 			rail_transform.position = (neighbor_transform.position + current_transform.position) / 2.0f;
 			rail_transform.position.y = 10.0f;
 			rail_transform.scale = glm::vec3(10.0f, 10.0f, 10.0f);
@@ -183,6 +185,10 @@ void MapManager::PlaceRails() {
 			GeoPos towards = GetGeoPosBetween(from, to);
 			rail_transform.rotation.y = GetRotationByGeoPos(towards);
 			ecs_manager_.AddAttribute<core::attributes::Transform>(rail_entity.id, rail_transform);
+			core::attributes::WorldMatrix rail_world_matrix;
+			ecs_manager_.AddAttribute<core::attributes::WorldMatrix>(rail_entity.id, rail_world_matrix);
+			core::attributes::Bounds rail_bounds;
+			ecs_manager_.AddAttribute<core::attributes::Bounds>(rail_entity.id, rail_bounds);
 		}
 	}
 }
@@ -302,27 +308,32 @@ void MapManager::GenerateRiver(int radius) {
 }
 
 void MapManager::GenerateBase(int radius) {
-	Transform transform;
-	transform.scale = glm::vec3(10.0f, 10.0f, 10.0f);
-
+	std::vector<TileCoord> coords;
+	coords.reserve(3 * radius * (radius + 1) + 1);
 	for (int q = -radius; q <= radius; ++q) {
 		int r1 = std::max(-radius, -q - radius);
 		int r2 = std::min(radius, -q + radius);
 		for (int r = r1; r <= r2; ++r) {
-			TileCoord coord{q, r};
-			glm::vec3 world_pos = coord.ToWorldPosition();
-
-			Entity tile_entity = ecs_manager_.CreateEntity();
-			transform.position = world_pos;
-			ecs_manager_.AddAttribute<Transform>(tile_entity.id, transform);
-			StaticMesh static_mesh;
-			static_mesh.model_id = tile_models_["debug_tile_empty"];
-			ecs_manager_.AddAttribute<StaticMesh>(tile_entity.id, static_mesh);
-
-			coords_to_tiles_.insert({coord, tile_entity});
-			free_tiles_.insert(coord);
+			coords.push_back({q, r});
 		}
 	}
+
+	size_t empty_tile_model = tile_models_["debug_tile_empty"];
+	std::vector<Entity> tile_entities = ecs_manager_.CreateEntities<Transform, WorldMatrix, StaticMesh, Bounds>(
+			coords.size(),
+			[&](const Entity& tile_entity, size_t index, Transform& transform,
+				WorldMatrix& world_matrix, StaticMesh& static_mesh, Bounds&) {
+		transform.position = coords[index].ToWorldPosition();
+		transform.scale = glm::vec3(10.0f, 10.0f, 10.0f);
+		static_mesh.model_id = empty_tile_model;
+	});
+
+	coords_to_tiles_.reserve(coords.size());
+	free_tiles_.reserve(coords.size());
+	for (size_t i = 0; i < coords.size(); ++i) {
+		coords_to_tiles_.insert({coords[i], tile_entities[i]});
+		free_tiles_.insert(coords[i]);
+	}
 }
 
 void MapManager::GenerateMap(int radius) {
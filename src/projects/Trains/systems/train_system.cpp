@@ -34,12 +34,11 @@ void TrainSystem::Start() {
 }
 
 void TrainSystem::StartArchetype(core::ecs::Archetype& archetype) {
-	archetype.ForEach([this, &archetype](core::ecs::EntityID entity_id, size_t index) {
-		trains::attributes::Train& train = ecs_manager_.GetAttribute<trains::attributes::Train>(entity_id);
-		core::attributes::Transform& transform = ecs_manager_.GetAttribute<core::attributes::Transform>(entity_id);
-		
+	auto query = ecs_manager_.GetQuery<const trains::attributes::Train, core::attributes::Transform>();
+	query.ForEach(archetype, [this](core::ecs::EntityID entity_id, const trains::attributes::Train& train,
+									core::attributes::Transform& transform) {
 		core::ecs::Entity& current_tile_entity = map_manager_.GetTileEntityAt(train.current_tile_coord);
-		core::attributes::Transform& current_tile_transform = ecs_manager_.GetAttribute<core::attributes::Transform>(current_tile_entity.id);
+		const core::attributes::Transform& current_tile_transform = ecs_manager_.GetAttribute<const core::attributes::Transform>(current_tile_entity.id);
 
 		transform.position.x = current_tile_transform.position.x;
 		transform.position.z = current_tile_transform.position.z;
@@ -51,12 +50,12 @@ void TrainSystem::Tick(float delta_time) {
 }
 
 void TrainSystem::TickArchetype(core::ecs::Archetype& archetype, float delta_time) {
-	archetype.ForEach([this, delta_time, &archetype](core::ecs::EntityID entity_id, size_t index) {
-		trains::attributes::Train& train = ecs_manager_.GetAttribute<trains::attributes::Train>(entity_id);
-		core::attributes::Transform& transform = ecs_manager_.GetAttribute<core::attributes::Transform>(entity_id);
-
+	// Trains only read the map and the tiles, so their chunks can be moved in parallel.
+	auto query = ecs_manager_.GetQuery<trains::attributes::Train, core::attributes::Transform>();
+	query.ForEachParallel(archetype, [this, delta_time](core::ecs::EntityID entity_id, trains::attributes::Train& train,
+														core::attributes::Transform& transform) {
 		core::ecs::Entity& next_tile_entity = map_manager_.GetTileEntityAt(train.next_tile_coord);
-		core::attributes::Transform& next_tile_transform = ecs_manager_.GetAttribute<core::attributes::Transform>(next_tile_entity.id);
+		const core::attributes::Transform& next_tile_transform = ecs_manager_.GetAttribute<const core::attributes::Transform>(next_tile_entity.id);
 
 		glm::vec2 currentXZ(transform.position.x, transform.position.z);
 		glm::vec2 targetXZ(next_tile_transform.position.x, next_tile_transform.position.z);
@@ -69,6 +68,7 @@ void TrainSystem::TickArchetype(core::ecs::Archetype& archetype, float delta_tim
 			transform.position.z = targetXZ.y;
 
 			train.current_tile_coord = train.next_tile_coord;
+			ecs_manager_.Emit(TileReachedEvent{entity_id, train.current_tile_coord});
 
 			auto next_tiles_opt = map_manager_.GetNextTrackTiles(train.current_tile_coord);
 			if (next_tiles_opt.has_value() && !next_tiles_opt->empty()) {
@@ -96,4 +96,11 @@ void TrainSystem::TickArchetype(core::ecs::Archetype& archetype, float delta_tim
 		}
 	});
 }
-} // namespace trains::systems
\ No newline at end of file
+
+core::ecs::SystemAccess TrainSystem::GetAccess() const {
+	core::ecs::SystemAccess access;
+	access.writes = core::ecs::Signature<trains::attributes::Train, core::attributes::Transform>();
+	access.main_thread_only = false;
+	return access;
+}
+} // namespace trains::systems
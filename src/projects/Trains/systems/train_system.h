@@ -9,12 +9,20 @@
 
 namespace trains::systems {
 
+// Emitted by the TrainSystem when a train reaches the center of a tile, e.g. to react to trains
+// arriving at stations without polling every train. Dispatched at the end of the update phase.
+struct TileReachedEvent {
+	core::ecs::EntityID train;
+	TileCoord tile;
+};
+
 class TrainSystem : public core::ecs::System {
 public:
 	void Start() override;
 	void StartArchetype(core::ecs::Archetype& archetype) override;
 	void Tick(float delta_time) override;
 	void TickArchetype(core::ecs::Archetype& archetype, float delta_time) override;
+	core::ecs::SystemAccess GetAccess() const override;
 
 public:
 	core::ecs::ECSManager& ecs_manager_ = core::ecs::ECSManager::GetInstance();
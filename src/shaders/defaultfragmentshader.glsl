@@ -1,5 +1,4 @@
 #version 460 core 
-layout (location = 0) uniform mat4 modelMatrix; 
 layout (location = 7) uniform int lightsNum; 
 layout (location = 4) uniform vec3 cameraPos; 
 layout (location = 5) uniform vec4 color;
@@ -4,7 +4,11 @@ layout (location = 1) in vec4 inTangent;
 layout (location = 2) in vec4 inNormal; 
 layout (location = 3) in vec2 inTextureCoords; 
 
-layout (location = 0) uniform mat4 modelMatrix; 
+// Model matrices of the instances of the current draw, starting at gl_BaseInstance.
+layout (binding = 1, std430) readonly buffer InstanceBuffer
+{
+    mat4 instanceModelMatrices[];
+};
 layout (location = 1) uniform mat4 viewMatrix; 
 layout (location = 2) uniform mat4 projectionMatrix; 
 layout (location = 3) uniform vec3 lightPos; 
@@ -17,6 +21,7 @@ layout (location = 4) out vec3 bitangent;
 
 void main() 
 { 
+   mat4 modelMatrix = instanceModelMatrices[gl_BaseInstance + gl_InstanceID];
    gl_Position = projectionMatrix * viewMatrix * modelMatrix * inPosition; 
    textureCoords = vec2(inTextureCoords.x, 1 - inTextureCoords.y); 
    normal = normalize(mat3(transpose(inverse(modelMatrix))) * inNormal.xyz); 
@@ -0,0 +1,27 @@
+#ifndef TESTS_CHILD_PROCESS_H
+#define TESTS_CHILD_PROCESS_H
+
+#include <cstdlib>
+#include <string>
+
+#if !defined(_WIN32)
+#include <sys/wait.h>
+#endif
+
+namespace tests {
+
+// Runs executable with the given arguments in a child process started with std::system, and
+// returns its exit code, or -1 if it did not exit normally. Used by tests that need a fresh
+// process per step, as the managers they exercise are singletons.
+inline int RunChildProcess(const char* executable, const std::string& arguments) {
+	std::string command = std::string("\"") + executable + "\" " + arguments;
+	int status = std::system(command.c_str());
+#if defined(_WIN32)
+	return status;
+#else
+	return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+#endif
+}
+} // namespace tests
+
+#endif // TESTS_CHILD_PROCESS_H
@@ -0,0 +1,87 @@
+// Checks that entity handles stay stale once their entity is destroyed, however many times the
+// index is reused afterwards, and that entities created while systems run get fresh indices.
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+
+#include "core/ecs/entity.h"
+#include "core/ecs/entity_manager.h"
+#include "core/ecs/types.h"
+
+namespace {
+
+using core::ecs::Entity;
+using core::ecs::EntityID;
+using core::ecs::EntityManager;
+
+// Destroys a handle, then churns its index through every remaining generation. The free list
+// hands the index back on the next create, so each iteration reuses the same slot.
+bool ChurnOneSlot() {
+	EntityManager entity_manager;
+	EntityID stale = entity_manager.CreateEntity()->id;
+	uint32_t index = core::ecs::ToEntityIndex(stale);
+	entity_manager.DestroyEntity(stale);
+
+	size_t reuse_count = 0;
+	for (size_t i = 0; i <= core::ecs::kEntityGenerationMask + 1; ++i) {
+		Entity entity = entity_manager.CreateEntity().value();
+		if (core::ecs::ToEntityIndex(entity.id) == index) {
+			++reuse_count;
+		}
+		if (entity_manager.IsAlive(stale)) {
+			std::printf("FAILED: the stale handle is alive again after %zu reuses.\n", i + 1);
+			return false;
+		}
+		entity_manager.DestroyEntity(entity.id);
+	}
+	// Generation 0 was the stale handle, so the index was reused for every other generation and
+	// then retired.
+	if (reuse_count != core::ecs::kEntityGenerationMask) {
+		std::printf("FAILED: the index was reused %zu times, %u expected.\n", reuse_count,
+					core::ecs::kEntityGenerationMask);
+		return false;
+	}
+	if (entity_manager.GetRecordEntity(index) != core::ecs::kNullEntity) {
+		std::printf("FAILED: the exhausted index was not retired.\n");
+		return false;
+	}
+	Entity entity = entity_manager.CreateEntity().value();
+	if (core::ecs::ToEntityIndex(entity.id) == index || entity_manager.IsAlive(stale)) {
+		std::printf("FAILED: the retired index was handed out again.\n");
+		return false;
+	}
+	std::printf("Reused one index %zu times, then retired it.\n", reuse_count);
+	return true;
+}
+
+// Fresh entities, as created while systems run, never take a destroyed index.
+bool CreateFresh() {
+	EntityManager entity_manager;
+	EntityID destroyed = entity_manager.CreateEntity()->id;
+	entity_manager.DestroyEntity(destroyed);
+	Entity fresh = entity_manager.CreateFreshEntity().value();
+	if (core::ecs::ToEntityIndex(fresh.id) == core::ecs::ToEntityIndex(destroyed) ||
+		entity_manager.GetFreeCount() != 1) {
+		std::printf("FAILED: a fresh entity took a destroyed index.\n");
+		return false;
+	}
+	// The destroyed index is reused by the next regular creation.
+	Entity recycled = entity_manager.CreateEntity().value();
+	if (core::ecs::ToEntityIndex(recycled.id) != core::ecs::ToEntityIndex(destroyed) ||
+		entity_manager.IsAlive(destroyed)) {
+		std::printf("FAILED: the destroyed index was not reused after the fresh entity.\n");
+		return false;
+	}
+	return true;
+}
+} // namespace
+
+int main() {
+	bool passed = ChurnOneSlot();
+	passed = CreateFresh() && passed;
+	if (passed) {
+		std::printf("Passed.\n");
+	}
+	return passed ? 0 : 1;
+}
@@ -0,0 +1,102 @@
+// Checks that CullSpheres, which tests several spheres at a time, finds the same visible spheres
+// as CullSpheresScalar, for counts that leave every possible remainder after the full batches.
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <limits>
+#include <random>
+#include <vector>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "core/attributes/bounds.h"
+#include "core/math/frustum_culling.h"
+
+namespace {
+
+// Random spheres around the camera, some far outside the frustum and some crossing its planes.
+std::vector<core::attributes::Bounds> MakeSpheres(size_t count, std::mt19937& random) {
+	std::uniform_real_distribution<float> position(-150.0f, 150.0f);
+	std::uniform_real_distribution<float> radius(0.0f, 5.0f);
+	std::vector<core::attributes::Bounds> spheres(count);
+	for (core::attributes::Bounds& sphere : spheres) {
+		sphere.center = glm::vec3(position(random), position(random) * 0.1f, position(random));
+		sphere.radius = radius(random);
+	}
+	return spheres;
+}
+
+// Returns whether both versions agree on the spheres, and prints the first difference.
+bool Compare(const core::math::Frustum& frustum,
+			 const std::vector<core::attributes::Bounds>& spheres) {
+	std::vector<uint32_t> visible(spheres.size());
+	std::vector<uint32_t> expected(spheres.size());
+	size_t visible_count = core::math::CullSpheres(frustum, spheres.data(), spheres.size(),
+												   visible.data());
+	size_t expected_count = core::math::CullSpheresScalar(frustum, spheres.data(), spheres.size(),
+														  expected.data());
+	if (visible_count != expected_count) {
+		std::printf("FAILED: %zu spheres: %zu visible, %zu expected.\n", spheres.size(),
+					visible_count, expected_count);
+		return false;
+	}
+	for (size_t i = 0; i < visible_count; ++i) {
+		if (visible[i] != expected[i]) {
+			std::printf("FAILED: %zu spheres: visible index %zu is %u, %u expected.\n",
+						spheres.size(), i, visible[i], expected[i]);
+			return false;
+		}
+	}
+	std::printf("%zu spheres: %zu visible.\n", spheres.size(), visible_count);
+	return true;
+}
+} // namespace
+
+int main() {
+	glm::mat4 view_projection =
+			glm::perspective(glm::radians(60.0f), 16.0f / 9.0f, 0.1f, 100.0f) *
+			glm::lookAt(glm::vec3(0.0f, 10.0f, 0.0f), glm::vec3(10.0f, 0.0f, 5.0f),
+						glm::vec3(0.0f, 1.0f, 0.0f));
+	core::math::Frustum frustum = core::math::ExtractFrustum(view_projection);
+
+	std::mt19937 random(1);
+	bool passed = true;
+	// Every remainder of the 4 (SSE) and 8 (AVX) sphere batches, and no full batch at all.
+	for (size_t count : {0, 1, 3, 4, 5, 7, 8, 9, 13, 15, 16, 17, 64, 1001}) {
+		std::vector<core::attributes::Bounds> spheres = MakeSpheres(count, random);
+		// Unbounded spheres, as given to entities whose model is not loaded, are always visible,
+		// in a batch and in the remainder.
+		if (count > 2) {
+			spheres[1].center = glm::vec3(-1000.0f);
+			spheres[1].radius = std::numeric_limits<float>::infinity();
+			spheres.back().center = glm::vec3(1000.0f);
+			spheres.back().radius = std::numeric_limits<float>::infinity();
+		}
+		passed = Compare(frustum, spheres) && passed;
+	}
+
+	// Spheres clearly inside and clearly outside, in a batch and in the remainder.
+	core::attributes::Bounds inside;
+	inside.center = glm::vec3(10.0f, 0.0f, 5.0f);
+	inside.radius = 0.1f;
+	core::attributes::Bounds outside;
+	outside.center = glm::vec3(-10.0f, 20.0f, -5.0f);
+	outside.radius = 0.1f;
+	std::vector<core::attributes::Bounds> spheres(9, outside);
+	spheres[2] = inside;
+	spheres[8] = inside;
+	std::vector<uint32_t> visible(spheres.size());
+	size_t visible_count = core::math::CullSpheres(frustum, spheres.data(), spheres.size(),
+												   visible.data());
+	if (visible_count != 2 || visible[0] != 2 || visible[1] != 8) {
+		std::printf("FAILED: %zu of the known spheres visible, 2 expected.\n", visible_count);
+		passed = false;
+	}
+
+	if (passed) {
+		std::printf("Passed.\n");
+	}
+	return passed ? 0 : 1;
+}
@@ -0,0 +1,299 @@
+// Draws the same scene through the per-mesh vertex array path and the shared buffer multi-draw
+// indirect path of the Renderer, and checks that both produce the same image without GL errors.
+// The scene includes a mesh large enough to regrow the shared buffers, and meshes loaded before
+// and after it, so base vertices, first indices and the copy on regrowth are all exercised.
+//
+// The Renderer is a singleton and the path must be chosen before loading models, so each path
+// runs in a child process started with "<path> <output file>". Needs an OpenGL 4.6 context, for
+// example from Mesa llvmpipe. Exits with kSkipped when no context can be created.
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "core/attributes/camera.h"
+#include "core/attributes/transform.h"
+#include "core/attributes/world_matrix.h"
+#include "core/ecs/ecs_manager.h"
+#include "core/ecs/entity.h"
+#include "core/graphics/material.h"
+#include "core/graphics/mesh.h"
+#include "core/graphics/model.h"
+#include "core/graphics/vertex.h"
+#include "core/render/drawable.h"
+#include "core/render/renderer.h"
+#include "tests/child_process.h"
+
+namespace {
+
+constexpr int kSkipped = 77;
+constexpr int kWidth = 256;
+constexpr int kHeight = 256;
+// Vertices per side of the grid mesh. 160 * 160 vertices and their indices do not fit in the
+// initial shared buffers.
+constexpr int kGridSize = 160;
+
+// Written by a child process for the parent to compare.
+struct FrameResult {
+	uint64_t instances;
+	uint32_t gl_error;
+	std::vector<uint8_t> pixels;
+};
+
+core::graphics::Vertex MakeVertex(float x, float y) {
+	core::graphics::Vertex vertex{};
+	vertex.position = glm::vec4(x, y, 0.0f, 1.0f);
+	vertex.normal = glm::vec4(0.0f, 0.0f, 1.0f, 0.0f);
+	vertex.tangent = glm::vec4(1.0f, 0.0f, 0.0f, 0.0f);
+	vertex.texture_coords = glm::vec2(x, y);
+	return vertex;
+}
+
+// Square of side 1 centered on the origin, facing +z, split into (cells * cells) quads.
+core::graphics::Mesh MakeGridMesh(int cells) {
+	core::graphics::Mesh mesh{};
+	for (int y = 0; y <= cells; ++y) {
+		for (int x = 0; x <= cells; ++x) {
+			mesh.vertices.push_back(MakeVertex(static_cast<float>(x) / cells - 0.5f,
+											   static_cast<float>(y) / cells - 0.5f));
+		}
+	}
+	for (int y = 0; y < cells; ++y) {
+		for (int x = 0; x < cells; ++x) {
+			unsigned int corner = y * (cells + 1) + x;
+			unsigned int above = corner + cells + 1;
+			mesh.indices.insert(mesh.indices.end(),
+								{corner, corner + 1, above + 1, above + 1, above, corner});
+		}
+	}
+	mesh.vertices_count = static_cast<unsigned int>(mesh.vertices.size());
+	mesh.faces_count = static_cast<unsigned int>(mesh.indices.size() / 3);
+	return mesh;
+}
+
+core::graphics::Mesh MakeTriangleMesh() {
+	core::graphics::Mesh mesh{};
+	mesh.vertices = {MakeVertex(-0.5f, -0.5f), MakeVertex(0.5f, -0.5f), MakeVertex(0.0f, 0.5f)};
+	mesh.indices = {0, 1, 2};
+	mesh.vertices_count = 3;
+	mesh.faces_count = 1;
+	return mesh;
+}
+
+// Material with a plain 4 x 4 texture of the given color.
+core::graphics::Material MakeMaterial(glm::vec4 color, std::vector<uint8_t>& texels) {
+	texels.assign(4 * 4 * 4, 255);
+	core::graphics::Texture texture{};
+	texture.width = 4;
+	texture.height = 4;
+	texture.channels = 4;
+	texture.data = texels.data();
+	core::graphics::Material material{};
+	material.diffuse_texture = texture;
+	material.normal_map = texture;
+	material.base_color = color;
+	material.texture_mask = 0;
+	return material;
+}
+
+core::graphics::Model MakeModel(size_t id, std::vector<core::graphics::Mesh> meshes,
+						  std::vector<core::graphics::Material> materials) {
+	core::graphics::Model model{};
+	model.id = id;
+	for (size_t i = 0; i < meshes.size(); ++i) {
+		model.mesh_instances.push_back({static_cast<int>(i),
+										static_cast<int>(i % materials.size()), glm::mat4(1.0f)});
+	}
+	model.meshes = std::move(meshes);
+	model.materials = std::move(materials);
+	return model;
+}
+
+void Submit(core::render::Renderer& renderer, size_t model_id, glm::vec3 position, float scale) {
+	core::render::Drawable drawable;
+	drawable.model_id = model_id;
+	drawable.model_matrix = glm::scale(glm::translate(glm::mat4(1.0f), position),
+									   glm::vec3(scale));
+	renderer.Submit(drawable);
+}
+
+// Draws the scene through one path and writes the result to output_path.
+int RenderScene(bool multi_draw_indirect, const char* output_path) {
+	if (!glfwInit()) {
+		return kSkipped;
+	}
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 6);
+	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+	glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+	GLFWwindow* window = glfwCreateWindow(kWidth, kHeight, "multi_draw_indirect_test", nullptr,
+										  nullptr);
+	if (window == nullptr) {
+		glfwTerminate();
+		return kSkipped;
+	}
+	glfwMakeContextCurrent(window);
+	if (!gladLoadGLLoader(reinterpret_cast<GLADloadproc>(glfwGetProcAddress))) {
+		glfwTerminate();
+		return kSkipped;
+	}
+
+	// Draw into a framebuffer object, the default framebuffer of a hidden window may not own its
+	// pixels.
+	GLuint framebuffer;
+	GLuint color_buffer;
+	GLuint depth_buffer;
+	glCreateFramebuffers(1, &framebuffer);
+	glCreateRenderbuffers(1, &color_buffer);
+	glCreateRenderbuffers(1, &depth_buffer);
+	glNamedRenderbufferStorage(color_buffer, GL_RGBA8, kWidth, kHeight);
+	glNamedRenderbufferStorage(depth_buffer, GL_DEPTH_COMPONENT24, kWidth, kHeight);
+	glNamedFramebufferRenderbuffer(framebuffer, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER,
+								   color_buffer);
+	glNamedFramebufferRenderbuffer(framebuffer, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER,
+								   depth_buffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+	glViewport(0, 0, kWidth, kHeight);
+
+	core::ecs::ECSManager& ecs_manager = core::ecs::ECSManager::GetInstance();
+	ecs_manager.RegisterAttribute<core::attributes::Transform>("Transform");
+	ecs_manager.RegisterAttribute<core::attributes::WorldMatrix>("WorldMatrix");
+	ecs_manager.RegisterAttribute<core::attributes::Camera>("Camera");
+	core::ecs::Entity camera_entity = ecs_manager.CreateEntity();
+	core::attributes::Transform camera_transform;
+	camera_transform.position = glm::vec3(0.0f, 0.0f, 10.0f);
+	ecs_manager.AddAttribute<core::attributes::Transform>(camera_entity.id, camera_transform);
+	core::attributes::WorldMatrix camera_world_matrix;
+	camera_world_matrix.matrix = camera_transform.GetModelMatrix();
+	ecs_manager.AddAttribute<core::attributes::WorldMatrix>(camera_entity.id,
+															camera_world_matrix);
+	core::attributes::Camera camera;
+	camera.view_matrix = glm::lookAt(camera_transform.position, glm::vec3(0.0f),
+									 glm::vec3(0.0f, 1.0f, 0.0f));
+	camera.projection_matrix = glm::perspective(glm::radians(camera.fov), 1.0f,
+												camera.near_plane, camera.far_plane);
+	ecs_manager.AddAttribute<core::attributes::Camera>(camera_entity.id, camera);
+
+	core::render::Renderer& renderer = core::render::Renderer::GetInstance();
+	if (multi_draw_indirect) {
+		renderer.EnableMultiDrawIndirect();
+	}
+	std::vector<uint8_t> red_texels;
+	std::vector<uint8_t> green_texels;
+	std::vector<uint8_t> blue_texels;
+	core::graphics::Material red = MakeMaterial(glm::vec4(1.0f, 0.0f, 0.0f, 1.0f), red_texels);
+	core::graphics::Material green = MakeMaterial(glm::vec4(0.0f, 1.0f, 0.0f, 1.0f), green_texels);
+	core::graphics::Material blue = MakeMaterial(glm::vec4(0.0f, 0.0f, 1.0f, 1.0f), blue_texels);
+	// Loaded in this order, the grid lands after the quad and regrows both shared buffers, and the
+	// last model lands after the grid.
+	renderer.LoadModel(MakeModel(1, {MakeGridMesh(1)}, {red}));
+	renderer.LoadModel(MakeModel(2, {MakeGridMesh(kGridSize - 1)}, {green}));
+	renderer.LoadModel(MakeModel(3, {MakeTriangleMesh(), MakeGridMesh(2)}, {blue, red}));
+
+	Submit(renderer, 1, glm::vec3(-2.0f, 2.0f, 0.0f), 1.5f);
+	Submit(renderer, 1, glm::vec3(2.0f, 2.0f, -1.0f), 1.5f);
+	Submit(renderer, 2, glm::vec3(0.0f, 0.0f, -2.0f), 3.0f);
+	Submit(renderer, 3, glm::vec3(-2.0f, -2.0f, 0.5f), 1.5f);
+	Submit(renderer, 3, glm::vec3(2.0f, -2.0f, 1.0f), 1.0f);
+	Submit(renderer, 3, glm::vec3(0.0f, 2.5f, 1.5f), 1.0f);
+
+	glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+	renderer.DrawFrame(camera_entity.id);
+	glFinish();
+
+	FrameResult result;
+	result.instances = renderer.GetFrameStats().instances;
+	result.pixels.resize(kWidth * kHeight * 4);
+	glReadPixels(0, 0, kWidth, kHeight, GL_RGBA, GL_UNSIGNED_BYTE, result.pixels.data());
+	result.gl_error = glGetError();
+
+	std::ofstream output(output_path, std::ios::binary);
+	output.write(reinterpret_cast<const char*>(&result.instances), sizeof(result.instances));
+	output.write(reinterpret_cast<const char*>(&result.gl_error), sizeof(result.gl_error));
+	output.write(reinterpret_cast<const char*>(result.pixels.data()), result.pixels.size());
+	// The GL objects go with the context, see Renderer.
+	glfwDestroyWindow(window);
+	glfwTerminate();
+	return output ? 0 : 1;
+}
+
+bool ReadResult(const std::string& path, FrameResult& result) {
+	std::ifstream input(path, std::ios::binary);
+	result.pixels.resize(kWidth * kHeight * 4);
+	input.read(reinterpret_cast<char*>(&result.instances), sizeof(result.instances));
+	input.read(reinterpret_cast<char*>(&result.gl_error), sizeof(result.gl_error));
+	input.read(reinterpret_cast<char*>(result.pixels.data()), result.pixels.size());
+	return static_cast<bool>(input);
+}
+
+// Runs both paths in child processes and compares their results.
+int CompareModes(const char* executable) {
+	const char* modes[2] = {"direct", "indirect"};
+	FrameResult results[2];
+	for (int i = 0; i < 2; ++i) {
+		std::string output_path = std::string("multi_draw_indirect_test_") + modes[i] + ".bin";
+		int exit_code = tests::RunChildProcess(executable,
+											   std::string(modes[i]) + " " + output_path);
+		if (exit_code == kSkipped) {
+			std::printf("Skipped: no OpenGL 4.6 context available.\n");
+			return kSkipped;
+		}
+		if (exit_code != 0 || !ReadResult(output_path, results[i])) {
+			std::printf("FAILED: the %s path did not produce a frame.\n", modes[i]);
+			return 1;
+		}
+	}
+
+	bool passed = true;
+	for (int i = 0; i < 2; ++i) {
+		if (results[i].gl_error != GL_NO_ERROR) {
+			std::printf("FAILED: the %s path left GL error 0x%x.\n", modes[i],
+						results[i].gl_error);
+			passed = false;
+		}
+	}
+	if (results[0].instances != results[1].instances) {
+		std::printf("FAILED: %llu instances drawn directly, %llu indirectly.\n",
+					static_cast<unsigned long long>(results[0].instances),
+					static_cast<unsigned long long>(results[1].instances));
+		passed = false;
+	}
+	size_t covered = 0;
+	size_t different = 0;
+	for (size_t i = 0; i < results[0].pixels.size(); i += 4) {
+		covered += std::memcmp(&results[0].pixels[i], "\0\0\0\xff", 4) != 0;
+		different += std::memcmp(&results[0].pixels[i], &results[1].pixels[i], 4) != 0;
+	}
+	if (covered == 0) {
+		std::printf("FAILED: the scene drew nothing.\n");
+		passed = false;
+	}
+	if (different != 0) {
+		std::printf("FAILED: %zu of %d pixels differ between the paths.\n", different,
+					kWidth * kHeight);
+		passed = false;
+	}
+	if (passed) {
+		std::printf("Passed: %llu instances, %zu pixels covered, identical images.\n",
+					static_cast<unsigned long long>(results[0].instances), covered);
+	}
+	return passed ? 0 : 1;
+}
+} // namespace
+
+int main(int argc, char** argv) {
+	if (argc == 3) {
+		return RenderScene(std::strcmp(argv[1], "indirect") == 0, argv[2]);
+	}
+	return CompareModes(argv[0]);
+}
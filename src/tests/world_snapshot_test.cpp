@@ -0,0 +1,276 @@
+// Saves a world with ECSManager::SaveWorld and loads it back with LoadWorld, checking that the
+// entities, their attributes and the free list of the entity table survive the round trip, and
+// that truncated or corrupted snapshots are rejected without touching the world.
+//
+// The ECSManager is a singleton and only loads into an empty world, so saving and loading run in
+// separate child processes started with "save <file>" and "load <file>".
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <exception>
+#include <fstream>
+#include <iterator>
+#include <span>
+#include <string>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "core/attributes/camera.h"
+#include "core/attributes/transform.h"
+#include "core/attributes/world_matrix.h"
+#include "core/ecs/ecs_manager.h"
+#include "core/ecs/entity.h"
+#include "core/ecs/types.h"
+#include "core/ecs/world_snapshot.h"
+#include "tests/child_process.h"
+
+namespace {
+
+using core::attributes::Camera;
+using core::attributes::Transform;
+using core::attributes::WorldMatrix;
+using core::ecs::EntityID;
+
+constexpr size_t kEntityCount = 1000;
+constexpr size_t kCameraCount = 3;
+// Entities destroyed before saving, in this order. Their indices form the free list.
+constexpr uint32_t kDestroyed[] = {5, 7};
+// Entity that loses its WorldMatrix, and entity that gains a Camera, before saving.
+constexpr uint32_t kMovedOut = 10;
+constexpr uint32_t kMovedIn = 11;
+
+// Handle of the entity created at the given position by a fresh world.
+EntityID Handle(uint32_t index) { return core::ecs::MakeEntityID(index, 0); }
+
+glm::vec3 ExpectedPosition(uint32_t index) {
+	return glm::vec3(static_cast<float>(index), 2.0f * index, 3.0f);
+}
+
+bool Check(bool condition, const char* message) {
+	if (!condition) {
+		std::printf("FAILED: %s\n", message);
+	}
+	return condition;
+}
+
+int SaveWorld(const char* path) {
+	core::ecs::ECSManager& ecs_manager = core::ecs::ECSManager::GetInstance();
+	ecs_manager.RegisterAttribute<Transform>("Transform");
+	ecs_manager.RegisterAttribute<WorldMatrix>("WorldMatrix");
+	ecs_manager.RegisterAttribute<Camera>("Camera");
+
+	std::vector<core::ecs::Entity> entities = ecs_manager.CreateEntities<Transform, WorldMatrix>(
+			kEntityCount, [](const core::ecs::Entity&, size_t index, Transform& transform,
+							 WorldMatrix& world_matrix) {
+		transform.position = ExpectedPosition(static_cast<uint32_t>(index));
+		world_matrix.matrix[3][0] = static_cast<float>(index);
+	});
+	// Cameras look at the first entities, so the saved handles must stay valid.
+	ecs_manager.CreateEntities<Camera>(kCameraCount, [&](const core::ecs::Entity&,
+														 size_t index, Camera& camera) {
+		camera.look_at = entities[index].id;
+		camera.fov = 10.0f + index;
+	});
+	for (uint32_t index : kDestroyed) {
+		ecs_manager.DestroyEntity(entities[index].id);
+	}
+	ecs_manager.RemoveAttribute<WorldMatrix>(entities[kMovedOut].id);
+	Camera camera;
+	camera.fov = 90.0f;
+	ecs_manager.AddAttribute<Camera>(entities[kMovedIn].id, camera);
+	ecs_manager.SaveWorld(path);
+	return 0;
+}
+
+std::vector<char> ReadFile(const char* path) {
+	std::ifstream file(path, std::ios::binary);
+	return std::vector<char>(std::istreambuf_iterator<char>(file), {});
+}
+
+void WriteFile(const std::string& path, std::span<const char> data) {
+	std::ofstream file(path, std::ios::binary | std::ios::trunc);
+	file.write(data.data(), data.size());
+}
+
+// Writes a damaged copy of the snapshot and checks that loading it throws.
+bool CheckRejected(const std::string& path, std::span<const char> data, const char* damage) {
+	WriteFile(path, data);
+	try {
+		core::ecs::ECSManager::GetInstance().LoadWorld(path);
+	} catch (const std::exception& exception) {
+		std::printf("Rejected a snapshot with %s: %s\n", damage, exception.what());
+		return true;
+	}
+	std::printf("FAILED: loaded a snapshot with %s.\n", damage);
+	return false;
+}
+
+bool CheckDamagedSnapshots(const char* path) {
+	std::vector<char> data = ReadFile(path);
+	core::ecs::WorldSnapshotHeader header;
+	std::memcpy(&header, data.data(), sizeof(header));
+	std::string damaged_path = std::string(path) + ".damaged";
+	bool passed = true;
+
+	passed = CheckRejected(damaged_path, std::span<const char>(data).first(data.size() / 2),
+						   "its second half cut off") && passed;
+	passed = CheckRejected(damaged_path, std::span<const char>(data).first(sizeof(header) - 1),
+						   "a truncated header") && passed;
+
+	std::vector<char> damaged = data;
+	damaged[0] = 'X';
+	passed = CheckRejected(damaged_path, damaged, "a wrong magic") && passed;
+
+	damaged = data;
+	damaged[header.names_offset] ^= 0x20;
+	passed = CheckRejected(damaged_path, damaged, "an unknown attribute name") && passed;
+
+	// Point the first saved entity of the first archetype at a record of another entity.
+	damaged = data;
+	core::ecs::WorldSnapshotArchetype archetype;
+	std::memcpy(&archetype, data.data() + header.archetypes_offset, sizeof(archetype));
+	EntityID unknown = core::ecs::MakeEntityID(kDestroyed[0], 7);
+	std::memcpy(damaged.data() + archetype.entities_offset, &unknown, sizeof(unknown));
+	passed = CheckRejected(damaged_path, damaged, "an unknown entity") && passed;
+
+	// Damage the columns and entities of an archetype with several attributes and entities, but
+	// not all of the saved attributes.
+	uint64_t all_attributes = (uint64_t{1} << header.attribute_count) - 1;
+	bool columns_damaged = false;
+	for (size_t i = 0; i < header.archetype_count && !columns_damaged; ++i) {
+		std::memcpy(&archetype, data.data() + header.archetypes_offset + i * sizeof(archetype),
+					sizeof(archetype));
+		if (archetype.column_count < 2 || archetype.entity_count < 2 ||
+			archetype.attributes == all_attributes) {
+			continue;
+		}
+		size_t columns_offset = header.columns_offset +
+								archetype.first_column * sizeof(core::ecs::WorldSnapshotColumn);
+		core::ecs::WorldSnapshotColumn column;
+		std::memcpy(&column, data.data() + columns_offset, sizeof(column));
+
+		damaged = data;
+		uint32_t missing = static_cast<uint32_t>(std::countr_one(archetype.attributes));
+		std::memcpy(damaged.data() + columns_offset, &missing, sizeof(missing));
+		passed = CheckRejected(damaged_path, damaged, "a column of a missing attribute") && passed;
+
+		damaged = data;
+		std::memcpy(damaged.data() + columns_offset + sizeof(column), &column.attribute,
+					sizeof(column.attribute));
+		passed = CheckRejected(damaged_path, damaged, "an attribute in two columns") && passed;
+
+		damaged = data;
+		std::memcpy(damaged.data() + archetype.entities_offset + sizeof(EntityID),
+					data.data() + archetype.entities_offset, sizeof(EntityID));
+		passed = CheckRejected(damaged_path, damaged, "an entity listed twice") && passed;
+		columns_damaged = true;
+	}
+	passed = Check(columns_damaged, "no archetype to damage the columns of.") && passed;
+
+	std::remove(damaged_path.c_str());
+	return passed;
+}
+
+int LoadWorld(const char* path) {
+	core::ecs::ECSManager& ecs_manager = core::ecs::ECSManager::GetInstance();
+	// Registered in another order than when saving, so the attribute type identifiers differ and
+	// the schema has to be matched by name.
+	ecs_manager.RegisterAttribute<Camera>("Camera");
+	ecs_manager.RegisterAttribute<WorldMatrix>("WorldMatrix");
+	ecs_manager.RegisterAttribute<Transform>("Transform");
+	size_t added_cameras = 0;
+	ecs_manager.Observe<Camera>(core::ecs::AttributeEvent::kAdd,
+								[&](std::span<const EntityID> entities) {
+		added_cameras += entities.size();
+	});
+
+	// Damaged snapshots leave the world empty, so the intact one still loads afterwards.
+	bool passed = CheckDamagedSnapshots(path);
+	ecs_manager.LoadWorld(path);
+	ecs_manager.DispatchEvents();
+
+	size_t transform_count = 0;
+	bool values_match = true;
+	ecs_manager.ForEach<Transform, WorldMatrix>([&](EntityID entity, Transform& transform,
+													WorldMatrix& world_matrix) {
+		uint32_t index = core::ecs::ToEntityIndex(entity);
+		values_match = values_match && transform.position == ExpectedPosition(index) &&
+					   world_matrix.matrix[3][0] == static_cast<float>(index);
+		++transform_count;
+	});
+	passed = Check(values_match, "transforms or world matrices changed.") && passed;
+	passed = Check(transform_count == kEntityCount - std::size(kDestroyed) - 1,
+				   "wrong number of entities with a world matrix.") && passed;
+
+	for (uint32_t index : kDestroyed) {
+		passed = Check(!ecs_manager.IsAlive(Handle(index)), "a destroyed entity is alive.") &&
+				 passed;
+	}
+	passed = Check(ecs_manager.IsAlive(Handle(kMovedOut)) &&
+				   !ecs_manager.HasAttribute<WorldMatrix>(Handle(kMovedOut)) &&
+				   ecs_manager.GetAttribute<const Transform>(Handle(kMovedOut)).position ==
+						   ExpectedPosition(kMovedOut),
+				   "the entity that lost its world matrix changed.") && passed;
+	passed = Check(ecs_manager.HasAttribute<Camera>(Handle(kMovedIn)) &&
+				   ecs_manager.GetAttribute<const Camera>(Handle(kMovedIn)).fov == 90.0f &&
+				   ecs_manager.GetAttribute<const Transform>(Handle(kMovedIn)).position ==
+						   ExpectedPosition(kMovedIn),
+				   "the entity that gained a camera changed.") && passed;
+
+	size_t camera_count = 0;
+	bool targets_valid = true;
+	ecs_manager.ForEach<Camera>([&](EntityID entity, Camera& camera) {
+		if (entity == Handle(kMovedIn)) {
+			return;
+		}
+		targets_valid = targets_valid && ecs_manager.IsAlive(camera.look_at) &&
+						ecs_manager.GetAttribute<const Transform>(camera.look_at).position ==
+								ExpectedPosition(core::ecs::ToEntityIndex(camera.look_at));
+		++camera_count;
+	});
+	passed = Check(camera_count == kCameraCount && targets_valid,
+				   "camera targets do not resolve.") && passed;
+	passed = Check(added_cameras == kCameraCount + 1, "kAdd observers missed cameras.") && passed;
+
+	// The free list is restored: the last destroyed index comes back first, one generation up.
+	EntityID recycled = ecs_manager.CreateEntity().id;
+	passed = Check(recycled == core::ecs::MakeEntityID(kDestroyed[1], 1),
+				   "the free list was not restored.") && passed;
+
+	if (passed) {
+		// The entity that lost its world matrix is the only one outside both loops.
+		std::printf("Loaded %zu entities.\n", transform_count + camera_count + 1);
+	}
+	return passed ? 0 : 1;
+}
+
+int RoundTrip(const char* executable) {
+	std::string path = "world_snapshot_test.bin";
+	for (const char* mode : {"save", "load"}) {
+		if (tests::RunChildProcess(executable, std::string(mode) + " " + path) != 0) {
+			std::printf("FAILED: the %s step failed.\n", mode);
+			std::remove(path.c_str());
+			return 1;
+		}
+	}
+	std::remove(path.c_str());
+	std::printf("Passed.\n");
+	return 0;
+}
+} // namespace
+
+int main(int argc, char** argv) {
+	if (argc == 3) {
+		try {
+			return std::strcmp(argv[1], "save") == 0 ? SaveWorld(argv[2]) : LoadWorld(argv[2]);
+		} catch (const std::exception& exception) {
+			std::printf("FAILED: %s\n", exception.what());
+			return 1;
+		}
+	}
+	return RoundTrip(argv[0]);
+}